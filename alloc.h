@@ -0,0 +1,171 @@
+/* SPDX-License-Identifier: Unlicense */
+/**
+ * @file alloc.h
+ * @brief Allocation accounting API for short tests.
+ */
+#if !defined(hg_Reedkiln_alloc_h_)
+#define hg_Reedkiln_alloc_h_
+
+#include "reedkiln.h"
+#if (defined Reedkiln_AllocMain)
+#  include <stdlib.h>
+#endif /*Reedkiln_AllocMain*/
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /*__cplusplus*/
+
+
+/** @brief Budget value for no limit. */
+#define Reedkiln_AllocAny ((reedkiln_size)-1)
+
+/**
+ * @brief Allocation counts for a test.
+ */
+struct reedkiln_allocs {
+  /** @brief Number of allocations. */
+  reedkiln_size allocs;
+  /** @brief Bytes requested across all allocations. */
+  reedkiln_size bytes;
+  /** @brief Bytes allocated and not yet freed. */
+  reedkiln_size live_bytes;
+  /** @brief Most bytes live at once. */
+  reedkiln_size peak_bytes;
+};
+
+/**
+ * @brief Get the allocation counts so far for the running test.
+ * @param[out] out counts to fill
+ * @return zero on success, nonzero if no allocation hooks are installed
+ * @note Only allocations made while the test callback runs count,
+ *   not those of its box's setup, reset or teardown.
+ */
+int reedkiln_alloc_count(struct reedkiln_allocs* out);
+/**
+ * @brief Set the allocation budget for the running test.
+ * @param allocs most allocations the test may make
+ * @param bytes most bytes the test may request in total
+ * @return zero on success, nonzero if no allocation hooks are installed
+ * @note The budget is checked when the test callback returns, and a
+ *   test over budget fails. Use `Reedkiln_AllocAny` for no limit.
+ */
+int reedkiln_alloc_budget(reedkiln_size allocs, reedkiln_size bytes);
+
+/**
+ * @brief Record an allocation for the running test.
+ * @param p new block
+ * @param n size requested for the block
+ * @note Called by the hooks that `Reedkiln_AllocMain` installs.
+ */
+void reedkiln_alloc_hook_add(void* p, reedkiln_size n);
+/**
+ * @brief Record that a block is about to be freed.
+ * @param p block to free
+ * @note Called by the hooks that `Reedkiln_AllocMain` installs.
+ */
+void reedkiln_alloc_hook_remove(void* p);
+
+
+#if (defined Reedkiln_AllocMain) && (defined __GLIBC__)
+/*
+ * Define Reedkiln_AllocMain in exactly one source file of the test
+ * program before including this header to install the hooks. With
+ * glibc, the hooks replace the C allocator, which C++ `new` also uses.
+ */
+#  if (defined __cplusplus)
+#    define Reedkiln_AllocThrow __THROW
+#  else
+#    define Reedkiln_AllocThrow
+#  endif /*__cplusplus*/
+extern void* __libc_malloc(size_t n);
+extern void* __libc_calloc(size_t count, size_t n);
+extern void* __libc_realloc(void* p, size_t n);
+extern void __libc_free(void* p);
+
+void* malloc(size_t n) Reedkiln_AllocThrow {
+  void* const p = __libc_malloc(n);
+  if (p != NULL)
+    reedkiln_alloc_hook_add(p, n);
+  return p;
+}
+
+void* calloc(size_t count, size_t n) Reedkiln_AllocThrow {
+  void* const p = __libc_calloc(count, n);
+  if (p != NULL) {
+    /* saturate instead of letting the product wrap */
+    reedkiln_alloc_hook_add(p, (n != 0u && count > ((size_t)-1)/n)
+      ? Reedkiln_AllocAny : count*n);
+  }
+  return p;
+}
+
+void* realloc(void* p, size_t n) Reedkiln_AllocThrow {
+  void* out;
+  /* forget the old block first, as another thread may get it next */
+  if (p != NULL)
+    reedkiln_alloc_hook_remove(p);
+  out = __libc_realloc(p, n);
+  if (out != NULL)
+    reedkiln_alloc_hook_add(out, n);
+  return out;
+}
+
+void free(void* p) Reedkiln_AllocThrow {
+  if (p != NULL)
+    reedkiln_alloc_hook_remove(p);
+  __libc_free(p);
+}
+#  undef Reedkiln_AllocThrow
+#endif /*Reedkiln_AllocMain && __GLIBC__*/
+
+#if defined(__cplusplus)
+};
+#endif /*__cplusplus*/
+
+#if (defined Reedkiln_AllocMain) && (!defined __GLIBC__) \
+  && (defined __cplusplus)
+/*
+ * Without glibc, only C++ `new` and `delete` are replaced.
+ */
+#include <cstdlib>
+#include <new>
+
+void* operator new(std::size_t n) {
+  void* const p = std::malloc(n > 0u ? n : 1u);
+  if (p == NULL)
+    throw std::bad_alloc();
+  reedkiln_alloc_hook_add(p, n);
+  return p;
+}
+void* operator new[](std::size_t n) {
+  return ::operator new(n);
+}
+void* operator new(std::size_t n, std::nothrow_t const&) Reedkiln_Noexcept {
+  void* const p = std::malloc(n > 0u ? n : 1u);
+  if (p != NULL)
+    reedkiln_alloc_hook_add(p, n);
+  return p;
+}
+void* operator new[](std::size_t n, std::nothrow_t const& nt)
+  Reedkiln_Noexcept
+{
+  return ::operator new(n, nt);
+}
+void operator delete(void* p) Reedkiln_Noexcept {
+  if (p != NULL) {
+    reedkiln_alloc_hook_remove(p);
+    std::free(p);
+  }
+}
+void operator delete[](void* p) Reedkiln_Noexcept {
+  ::operator delete(p);
+}
+void operator delete(void* p, std::nothrow_t const&) Reedkiln_Noexcept {
+  ::operator delete(p);
+}
+void operator delete[](void* p, std::nothrow_t const&) Reedkiln_Noexcept {
+  ::operator delete(p);
+}
+#endif /*Reedkiln_AllocMain && __cplusplus*/
+
+#endif /*hg_Reedkiln_alloc_h_*/
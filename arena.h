@@ -0,0 +1,131 @@
+/* SPDX-License-Identifier: Unlicense */
+/**
+ * @file arena.h
+ * @brief Arena-backed boxes for C++ tests.
+ */
+#if !defined(hg_Reedkiln_arena_h_)
+#define hg_Reedkiln_arena_h_
+
+#include "reedkiln.h"
+
+#if (defined __cplusplus) && (defined __has_include) \
+  && ((__cplusplus >= 201703L) \
+    || ((defined _MSVC_LANG) && (_MSVC_LANG >= 201703L)))
+#  if __has_include(<memory_resource>)
+#    define Reedkiln_UseArena 1
+#  endif
+#endif /*__cplusplus*/
+
+#if (defined Reedkiln_UseArena)
+
+#include <cstddef>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+
+namespace reedkiln {
+  /**
+   * @brief Box that builds its item in an arena.
+   * @tparam t item type, constructed from a `std::pmr::memory_resource*`
+   *   if it can be, or else default-constructed
+   * @tparam size bytes for the item's own allocations before the
+   *   arena falls back to the heap
+   * @note The item and its arena share one block of memory. Teardown
+   *   releases the arena all at once and keeps the block for the next
+   *   test on the same thread, so tests after the first do not touch
+   *   the heap unless they outgrow the block.
+   */
+  template <typename t, std::size_t size = 65536u>
+  struct arena_box {
+  private:
+    struct arena {
+      std::pmr::monotonic_buffer_resource resource;
+      arena(void* buffer, std::size_t n)
+        : resource(buffer, n, std::pmr::new_delete_resource())
+      {
+      }
+    };
+    /** @brief Spare block kept until the thread ends. */
+    struct spare {
+      void* block = nullptr;
+      ~spare() {
+        if (block != nullptr)
+          ::operator delete(block, std::align_val_t(align));
+      }
+    };
+    static constexpr std::size_t align =
+      (alignof(t) > alignof(std::max_align_t))
+      ? alignof(t) : alignof(std::max_align_t);
+    static constexpr std::size_t round_up(std::size_t n) {
+      return (n + align - 1u) / align * align;
+    }
+    static constexpr std::size_t item_offset = round_up(sizeof(arena));
+    static constexpr std::size_t buffer_offset =
+      item_offset + round_up(sizeof(t));
+
+    static spare& thread_spare() {
+      static thread_local spare s;
+      return s;
+    }
+    static unsigned char* block_of(void* p) {
+      return static_cast<unsigned char*>(p) - item_offset;
+    }
+    static arena* arena_of(void* p) {
+      return std::launder(reinterpret_cast<arena*>(block_of(p)));
+    }
+    static void give_back(unsigned char* block) Reedkiln_Noexcept {
+      spare& s = thread_spare();
+      if (s.block == nullptr)
+        s.block = block;
+      else ::operator delete(block, std::align_val_t(align));
+    }
+  public:
+    using type = t;
+    static void* setup(void*) {
+      spare& s = thread_spare();
+      unsigned char* const block = static_cast<unsigned char*>(
+          (s.block != nullptr) ? s.block
+          : ::operator new(buffer_offset + size, std::align_val_t(align)));
+      arena* a;
+      s.block = nullptr;
+      a = ::new (block) arena(block + buffer_offset, size);
+      try {
+        if constexpr (std::is_constructible<t,
+            std::pmr::memory_resource*>::value)
+        {
+          return ::new (block + item_offset) t(&a->resource);
+        } else return ::new (block + item_offset) t();
+      } catch (...) {
+        a->~arena();
+        give_back(block);
+        throw;
+      }
+    }
+    static void teardown(void* p) Reedkiln_Noexcept {
+      unsigned char* const block = block_of(p);
+      static_cast<t*>(p)->~t();
+      arena_of(p)->~arena();
+      give_back(block);
+    }
+    /**
+     * @brief Get the arena behind a box item.
+     * @param p box item from this box
+     * @return the item's memory resource
+     */
+    static std::pmr::memory_resource* resource(void* p) {
+      return &arena_of(p)->resource;
+    }
+    static reedkiln_box const value;
+    static reedkiln_box const* const ptr;
+  };
+  template <typename t, std::size_t size>
+  reedkiln_box const arena_box<t, size>::value =
+    { &setup, &teardown, 0u, 0 };
+  template <typename t, std::size_t size>
+  reedkiln_box const* const arena_box<t, size>::ptr =
+    &arena_box<t, size>::value;
+};
+
+#endif /*Reedkiln_UseArena*/
+
+#endif /*hg_Reedkiln_arena_h_*/
@@ -47,6 +47,16 @@ reedkiln_size reedkiln_log_write(void const* buffer, reedkiln_size count);
  */
 reedkiln_size reedkiln_log_printf(Reedkiln_argPrintf char const* format, ...)
   Reedkiln_attrPrintf(1,2);
+/**
+ * @brief Configure how much log each test may keep.
+ * @param capacity maximum bytes to keep per test, or zero for the
+ *   default of 128 bytes; later writes are truncated
+ * @param spill log size in bytes past which storage moves from the heap
+ *   to a temporary file, or zero for the default of 1 MiB
+ * @note Called during a test, this applies to the rest of that test only.
+ *   Otherwise, this applies to all tests that start later.
+ */
+void reedkiln_log_configure(reedkiln_size capacity, reedkiln_size spill);
 
 
 #if defined(__cplusplus)
@@ -60,6 +70,13 @@ reedkiln_size reedkiln_log_printf(Reedkiln_argPrintf char const* format, ...)
 #include <locale>
 #include <cwchar>
 
+#if (defined Reedkiln_UseThreadLocal) || (__cplusplus >= 201103L)
+#  define Reedkiln_ThreadLocal thread_local
+#else
+/** @brief Storage class for each thread's log streams. */
+#  define Reedkiln_ThreadLocal
+#endif /*Reedkiln_UseThreadLocal*/
+
 namespace reedkiln {
   /**
    * @brief STL stream buffer implementation using Reedkiln's log.
@@ -201,26 +218,26 @@ namespace reedkiln {
 
   /**
    * @brief Get the narrow STL stream for the Reedkiln log.
-   * @return a reference to a std::ostream
+   * @return a reference to the calling thread's std::ostream
    */
   inline
   std::ostream& cxx_log() {
     using buf_type =
       cxx_logbuf<std::ostream::char_type, std::ostream::traits_type>;
-    static buf_type buf;
-    static std::ostream os(&buf);
+    static Reedkiln_ThreadLocal buf_type buf;
+    static Reedkiln_ThreadLocal std::ostream os(&buf);
     return os;
   }
   /**
    * @brief Get the wide STL stream for the Reedkiln log.
-   * @return a reference to a std::wostream
+   * @return a reference to the calling thread's std::wostream
    */
   inline
   std::wostream& cxx_wlog() {
     using buf_type =
       cxx_logbuf<std::wostream::char_type, std::wostream::traits_type>;
-    static buf_type buf;
-    static std::wostream os(&buf);
+    static Reedkiln_ThreadLocal buf_type buf;
+    static Reedkiln_ThreadLocal std::wostream os(&buf);
     return os;
   }
 };
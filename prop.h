@@ -0,0 +1,207 @@
+/* SPDX-License-Identifier: Unlicense */
+/**
+ * @file prop.h
+ * @brief Property-based testing API for short tests.
+ */
+#if !defined(hg_Reedkiln_prop_h_)
+#define hg_Reedkiln_prop_h_
+
+#include "reedkiln.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /*__cplusplus*/
+
+
+/**
+ * @brief Source of generated values for a property.
+ */
+struct reedkiln_gen;
+
+/**
+ * @brief Property callback.
+ * @param g source of generated values
+ * @param p user data from `reedkiln_prop_check`
+ * @return Reedkiln_OK if the property holds, Reedkiln_IGNORE to
+ *   discard the input, or Reedkiln_NOT_OK otherwise
+ * @note The property may also fail through `reedkiln_assert` and
+ *   `reedkiln_fail`. It should draw all of its input from `g`.
+ */
+typedef int (*reedkiln_prop_cb)(struct reedkiln_gen* g, void* p);
+
+/**
+ * @brief Check a property against generated inputs.
+ * @param cb property to check
+ * @param p user data for the property
+ * @param trials number of inputs to try, or zero for the default of 1000
+ * @return Reedkiln_OK if the property held for every input,
+ *   Reedkiln_NOT_OK otherwise
+ * @note On failure, the input is shrunk to a smaller one that still
+ *   fails, and the values drawn for it are written to the log. Inputs
+ *   come from the test's random stream, so the test's seed reproduces
+ *   them. Diagnostics and log writes are dropped except while
+ *   replaying the shrunk input.
+ */
+int reedkiln_prop_check
+  (reedkiln_prop_cb cb, void* p, unsigned long int trials);
+
+/**
+ * @brief Generate an unsigned integer.
+ * @param g source of generated values
+ * @param max largest value to generate
+ * @return a value from zero to `max`, shrinking toward zero
+ */
+unsigned long int reedkiln_gen_uint
+  (struct reedkiln_gen* g, unsigned long int max);
+/**
+ * @brief Generate a signed integer.
+ * @param g source of generated values
+ * @param lo smallest value to generate
+ * @param hi largest value to generate
+ * @return a value from `lo` to `hi`, shrinking toward the value in
+ *   range closest to zero
+ */
+long int reedkiln_gen_int(struct reedkiln_gen* g, long int lo, long int hi);
+/**
+ * @brief Generate a byte string.
+ * @param g source of generated values
+ * @param[out] b buffer to fill
+ * @param max size of the buffer
+ * @return the number of bytes generated, shrinking toward shorter
+ *   strings of smaller bytes
+ */
+reedkiln_size reedkiln_gen_bytes
+  (struct reedkiln_gen* g, void* b, reedkiln_size max);
+
+
+#if defined(__cplusplus)
+};
+#endif /*__cplusplus*/
+
+#if (defined __cplusplus) \
+  && ((defined Reedkiln_UseExpect) || (__cplusplus >= 201103L))
+
+#include <climits>
+#include <limits>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+namespace reedkiln {
+  /**
+   * @brief Generator for values of a type.
+   * @tparam t type to generate
+   * @note Specialize with a static `draw(reedkiln_gen*)` member
+   *   to add a type.
+   */
+  template <typename t, typename = void>
+  struct cxx_arbitrary;
+
+  template <>
+  struct cxx_arbitrary<bool> {
+    static bool draw(reedkiln_gen* g) {
+      return reedkiln_gen_uint(g, 1u) != 0u;
+    }
+  };
+
+  template <typename t>
+  struct cxx_arbitrary<t, typename std::enable_if<
+      std::is_integral<t>::value && std::is_unsigned<t>::value
+    >::type>
+  {
+    static t draw(reedkiln_gen* g) {
+      unsigned long int const max =
+        (std::numeric_limits<t>::max() > ULONG_MAX)
+        ? ULONG_MAX : static_cast<unsigned long int>(
+            std::numeric_limits<t>::max());
+      return static_cast<t>(reedkiln_gen_uint(g, max));
+    }
+  };
+
+  template <typename t>
+  struct cxx_arbitrary<t, typename std::enable_if<
+      std::is_integral<t>::value && std::is_signed<t>::value
+    >::type>
+  {
+    static t draw(reedkiln_gen* g) {
+      long int const lo =
+        (std::numeric_limits<t>::min() < LONG_MIN)
+        ? LONG_MIN : static_cast<long int>(std::numeric_limits<t>::min());
+      long int const hi =
+        (std::numeric_limits<t>::max() > LONG_MAX)
+        ? LONG_MAX : static_cast<long int>(std::numeric_limits<t>::max());
+      return static_cast<t>(reedkiln_gen_int(g, lo, hi));
+    }
+  };
+
+  template <>
+  struct cxx_arbitrary<std::string> {
+    /** @brief Longest string to generate. */
+    static constexpr std::size_t max_size = 64u;
+    static std::string draw(reedkiln_gen* g) {
+      char buf[max_size];
+      std::size_t const n = reedkiln_gen_bytes(g, buf, max_size);
+      return std::string(buf, n);
+    }
+  };
+
+  template <typename t>
+  struct cxx_arbitrary< std::vector<t> > {
+    /** @brief Longest vector to generate. */
+    static constexpr unsigned long int max_size = 32u;
+    static std::vector<t> draw(reedkiln_gen* g) {
+      unsigned long int const n = reedkiln_gen_uint(g, max_size);
+      unsigned long int i;
+      std::vector<t> out;
+      out.reserve(n);
+      for (i = 0u; i < n; ++i)
+        out.push_back(cxx_arbitrary<t>::draw(g));
+      return out;
+    }
+  };
+
+  template <std::size_t... i>
+  struct cxx_indices {};
+  template <std::size_t n, std::size_t... i>
+  struct cxx_make_indices : cxx_make_indices<n-1u, n-1u, i...> {};
+  template <std::size_t... i>
+  struct cxx_make_indices<0u, i...> {
+    using type = cxx_indices<i...>;
+  };
+
+  /**
+   * @brief Property over generated arguments.
+   * @tparam Args types of the arguments to generate
+   */
+  template <typename... Args>
+  struct property {
+  private:
+    using values = std::tuple<typename std::decay<Args>::type...>;
+    template <bool (*fn)(Args...), std::size_t... i>
+    static bool apply(values& v, cxx_indices<i...>) {
+      return (*fn)(std::get<i>(v)...);
+    }
+    template <bool (*fn)(Args...)>
+    static int trial(reedkiln_gen* g, void*) {
+      /* braced lists draw in order from left to right */
+      values v{ cxx_arbitrary<typename std::decay<Args>::type>::draw(g)... };
+      return apply<fn>(v, typename cxx_make_indices<sizeof...(Args)>::type())
+        ? Reedkiln_OK : Reedkiln_NOT_OK;
+    }
+  public:
+    /**
+     * @brief Test callback that checks a property.
+     * @tparam fn property, returning true if it holds
+     * @tparam trials number of inputs to try, or zero for the default
+     */
+    template <bool (*fn)(Args...), unsigned long int trials = 0u>
+    static int check(void* p) {
+      return reedkiln_prop_check(&trial<fn>, p, trials);
+    }
+  };
+};
+
+#endif /*__cplusplus*/
+
+#endif /*hg_Reedkiln_prop_h_*/
@@ -3,7 +3,18 @@
  * @file reedkiln.c
  * @brief Short test implementation.
  */
+/* ask for the POSIX and BSD declarations, even under strict C modes */
+#if (defined __unix__) || (defined __APPLE__)
+#  if !(defined _DEFAULT_SOURCE)
+#    define _DEFAULT_SOURCE 1
+#  endif /*_DEFAULT_SOURCE*/
+#  if (defined __APPLE__) && !(defined _DARWIN_C_SOURCE)
+#    define _DARWIN_C_SOURCE 1
+#  endif /*__APPLE__*/
+#endif /*__unix__, __APPLE__*/
 #include "reedkiln.h"
+#include "prop.h"
+#include "alloc.h"
 
 #if !defined(Reedkiln_Atomic)
 #  if defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L) \
@@ -26,6 +37,8 @@
 #  define Reedkiln_Atomic_Put(c,v) \
       atomic_store_explicit((c),(v),memory_order_release)
 #  define Reedkiln_Atomic_Get(c) atomic_load_explicit((c),memory_order_acquire)
+#  define Reedkiln_Atomic_Add(c,v) \
+      atomic_fetch_add_explicit((c),(v),memory_order_acq_rel)
 #else
 #  if (defined _MSC_VER)
 #    include <intrin.h>
@@ -33,9 +46,13 @@
 #    if (ULONG_MAX == UINT_MAX)
 #      define Reedkiln_Atomic_Xchg(c,v) \
           _InterlockedExchange((c), (v))
+#      define Reedkiln_Atomic_Add(c,v) \
+          _InterlockedExchangeAdd((c), (v))
 #    else
 #      define Reedkiln_Atomic_Xchg(c,v) \
           _InterlockedExchange16((c), (v))
+#      define Reedkiln_Atomic_Add(c,v) \
+          _InterlockedExchangeAdd16((c), (v))
 #    endif /*UINT_MAX*/
 #  else
 static unsigned int Reedkiln_Atomic_Xchg(unsigned int volatile* c, unsigned int v) {
@@ -43,6 +60,11 @@ static unsigned int Reedkiln_Atomic_Xchg(unsigned int volatile* c, unsigned int
   *c = v;
   return out;
 }
+static unsigned int Reedkiln_Atomic_Add(unsigned int volatile* c, unsigned int v) {
+  unsigned int const out = *c;
+  *c = out+v;
+  return out;
+}
 #  endif /*_MSC_VER*/
 #  define Reedkiln_Atomic_tag
 static void Reedkiln_Atomic_Put(unsigned int volatile* c, unsigned int v) {
@@ -62,6 +84,69 @@ static unsigned int Reedkiln_Atomic_Get(unsigned int const volatile* c) {
 #  define Reedkiln_Thread_local
 #endif /*Reedkiln_Threads*/
 
+#if !defined(Reedkiln_Fork)
+#  if ((defined __unix__) || (defined __APPLE__)) \
+       && (defined Reedkiln_Atomic)
+#    define Reedkiln_Fork
+#  endif /*__unix__, __APPLE__*/
+#endif
+#if defined(Reedkiln_Fork)
+#  include <unistd.h>
+#  include <sys/types.h>
+#  include <sys/mman.h>
+#  include <sys/wait.h>
+#  include <poll.h>
+#  include <signal.h>
+#  if (!defined MAP_ANONYMOUS) && (defined MAP_ANON)
+#    define MAP_ANONYMOUS MAP_ANON
+#  endif /*MAP_ANON*/
+#  if !(defined MAP_ANONYMOUS) || !(defined _POSIX_VERSION)
+#    undef Reedkiln_Fork
+#  endif /*MAP_ANONYMOUS, _POSIX_VERSION*/
+#endif /*Reedkiln_Fork*/
+#if !defined(Reedkiln_Spill)
+#  if (defined __unix__) || (defined __APPLE__)
+#    define Reedkiln_Spill
+#  endif /*__unix__, __APPLE__*/
+#endif
+#if defined(Reedkiln_Spill)
+#  include <unistd.h>
+#  include <sys/types.h>
+#  include <sys/mman.h>
+#  if (!defined MAP_ANONYMOUS) && (defined MAP_ANON)
+#    define MAP_ANONYMOUS MAP_ANON
+#  endif /*MAP_ANON*/
+#  if !(defined _POSIX_VERSION)
+#    undef Reedkiln_Spill
+#  endif /*_POSIX_VERSION*/
+#endif /*Reedkiln_Spill*/
+#if !defined(Reedkiln_SSE2)
+#  if (defined __SSE2__) || (defined _M_X64) \
+       || ((defined _M_IX86_FP) && (_M_IX86_FP >= 2))
+#    define Reedkiln_SSE2
+#  endif /*__SSE2__*/
+#endif
+#if defined(Reedkiln_SSE2)
+#  include <emmintrin.h>
+#endif /*Reedkiln_SSE2*/
+#if !defined(Reedkiln_Perf)
+#  if (defined __linux__) \
+       && ((defined _DEFAULT_SOURCE) || (defined _GNU_SOURCE))
+#    define Reedkiln_Perf
+#  endif /*__linux__*/
+#endif
+#if defined(Reedkiln_Perf)
+#  include <unistd.h>
+#  include <sys/ioctl.h>
+#  include <sys/syscall.h>
+#  include <linux/perf_event.h>
+#endif /*Reedkiln_Perf*/
+#if (defined _WIN32)
+#  include <windows.h>
+#elif (defined __unix__) || (defined __APPLE__)
+#  include <unistd.h>
+#endif /*_WIN32*/
+
 #include <stddef.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -75,6 +160,25 @@ static unsigned int Reedkiln_Atomic_Get(unsigned int const volatile* c) {
 #include <errno.h>
 
 struct reedkiln_logbuf;
+struct reedkiln_logseg;
+struct reedkiln_bench;
+struct reedkiln_timing;
+struct reedkiln_text;
+struct reedkiln_worker;
+struct reedkiln_outcome;
+struct reedkiln_run;
+struct reedkiln_prop_data;
+struct reedkiln_filter;
+struct reedkiln_pattern;
+struct reedkiln_durations;
+struct reedkiln_cache;
+struct reedkiln_alloc_rec;
+struct reedkiln_perf;
+struct reedkiln_report_file;
+struct reedkiln_journal;
+struct reedkiln_repeat;
+struct reedkiln_subresult;
+struct reedkiln_subgroup;
 
 #if defined(ULLONG_MAX)
 typedef unsigned long long reedkiln_intmax;
@@ -86,19 +190,242 @@ static size_t reedkiln_entry_count(struct reedkiln_entry const* t);
 static char const* reedkiln_entry_directive(struct reedkiln_entry const* t);
 static void reedkiln_srand(unsigned int s);
 static unsigned int reedkiln_rand_step(void);
+static unsigned int reedkiln_rand_split(unsigned int seed, unsigned int id);
+static unsigned int reedkiln_rand_mix(unsigned int x);
+static unsigned int reedkiln_rand_block(unsigned int const* key, size_t ctr);
+static void reedkiln_rand_put(unsigned char* out, unsigned int x);
+static void reedkiln_rand_fill
+  (unsigned int const* key, size_t ctr, unsigned char* p, size_t n);
+static void reedkiln_rand_fill_all
+  (unsigned int const* key, unsigned char* p, size_t n);
+static unsigned int reedkiln_cpu_count(void);
+static int reedkiln_gen_push(struct reedkiln_gen* g, unsigned long int v);
+static unsigned long int reedkiln_gen_draw
+  (struct reedkiln_gen* g, unsigned long int max);
+static int reedkiln_prop_redirect(void* d);
+static void reedkiln_prop_free(struct reedkiln_prop_data* data);
+static int reedkiln_prop_trial(struct reedkiln_prop_data* data);
+static int reedkiln_prop_shrink_try
+  (struct reedkiln_prop_data* data, size_t len, int shorter_tf);
+static void reedkiln_prop_shrink(struct reedkiln_prop_data* data);
 static int reedkiln_prefix_match(char const* name, char const* prefix);
+static int reedkiln_glob_match(char const* name, char const* glob);
+static int reedkiln_pattern_match
+  (char const* name, struct reedkiln_pattern const* pat);
+static int reedkiln_name_cmp(void const* a, void const* b);
+static int reedkiln_index_cmp(void const* a, void const* b);
+static size_t reedkiln_name_lower_bound
+  ( struct reedkiln_entry const* const* index, size_t n,
+    char const* prefix, size_t prefix_len);
+static struct reedkiln_entry* reedkiln_select
+  ( struct reedkiln_entry const* t, size_t n,
+    struct reedkiln_filter const* filter, size_t* out_count);
+static int reedkiln_duration_cmp(void const* a, void const* b);
+static int reedkiln_durations_load
+  (struct reedkiln_durations* d, char const* path);
+static struct reedkiln_duration* reedkiln_durations_find
+  (struct reedkiln_durations const* d, char const* name);
+static int reedkiln_durations_save
+  ( struct reedkiln_durations* d, struct reedkiln_run const* run,
+    char const* path);
+static void reedkiln_durations_free(struct reedkiln_durations* d);
+static int reedkiln_shard_cmp(void const* a, void const* b);
+static int reedkiln_cache_fingerprint
+  (struct reedkiln_cache* c, char const* text, char const* path);
+static int reedkiln_cached_cmp(void const* a, void const* b);
+static int reedkiln_cache_load(struct reedkiln_cache* c, char const* path);
+static struct reedkiln_cached* reedkiln_cache_find
+  (struct reedkiln_cache const* c, char const* name, unsigned int seed);
+static int reedkiln_cache_hit
+  (struct reedkiln_run const* run, struct reedkiln_entry const* test);
+static void reedkiln_cache_note
+  ( struct reedkiln_run const* run, size_t test_i,
+    struct reedkiln_outcome const* result);
+static int reedkiln_cache_save
+  ( struct reedkiln_cache* c, struct reedkiln_run const* run,
+    char const* path);
+static void reedkiln_cache_free(struct reedkiln_cache* c);
+static unsigned long int reedkiln_bin_get32(unsigned char const* b);
+static unsigned int reedkiln_journal_check
+  (unsigned int h, unsigned char const* data, size_t n);
+static unsigned int reedkiln_journal_names(struct reedkiln_run const* run);
+static int reedkiln_journal_write
+  ( FILE* f, unsigned int kind, size_t test_i,
+    unsigned char const* data, size_t n);
+static int reedkiln_journal_crashed
+  ( struct reedkiln_journal* j, struct reedkiln_run const* run,
+    unsigned char const* state);
+static int reedkiln_journal_open
+  (struct reedkiln_journal* j, struct reedkiln_run* run, char const* path);
+static int reedkiln_journal_hit(struct reedkiln_run const* run, size_t test_i);
+static void reedkiln_journal_mark
+  (struct reedkiln_run const* run, size_t test_i, unsigned int kind);
+static void reedkiln_journal_note
+  ( struct reedkiln_run const* run, size_t test_i, int failed_tf,
+    struct reedkiln_text const* text);
+static int reedkiln_journal_close
+  (struct reedkiln_journal* j, char const* path, size_t test_count);
+static void reedkiln_repeat_keep
+  ( struct reedkiln_run const* run, struct reedkiln_outcome* keep,
+    struct reedkiln_outcome const* result, struct reedkiln_worker* w);
+static int reedkiln_repeat_note
+  ( struct reedkiln_run const* run, size_t test_i,
+    struct reedkiln_outcome const* result, struct reedkiln_worker* w);
+static int reedkiln_repeat_next(struct reedkiln_run* run);
+static int reedkiln_repeat_finish(struct reedkiln_run* run);
+static void reedkiln_repeat_free(struct reedkiln_repeat* r, size_t count);
+static void reedkiln_shuffle(struct reedkiln_run* run);
+static size_t reedkiln_run_order(struct reedkiln_run const* run, size_t pos);
+static struct reedkiln_box const* reedkiln_run_next_box
+  (struct reedkiln_run const* run, size_t pos);
+static int reedkiln_order_main(struct reedkiln_run const* run, int* total_res);
+static size_t reedkiln_shard
+  ( struct reedkiln_entry* t, size_t n, unsigned long int index,
+    unsigned long int count, struct reedkiln_durations const* d);
 static int reedkiln_passthrough(reedkiln_cb cb, void* ptr);
 static void reedkiln_failfast(void);
 static int reedkiln_run_test(reedkiln_cb cb, void* p);
 static int reedkiln_setup_redirect(void* d);
 static int reedkiln_run_setup(reedkiln_setup_cb cb, void* p, void** out);
 static unsigned int reedkiln_default_seed(void);
+static unsigned int reedkiln_test_seed(unsigned int seed, char const* name);
+static unsigned int reedkiln_entry_seed
+  (struct reedkiln_run const* run, size_t test_i);
+static unsigned int reedkiln_name_hash(char const* name);
 static void reedkiln_print_bail(char const* reason);
-static unsigned int reedkiln_log_swap(void);
-static void reedkiln_log_reset(void);
+static struct reedkiln_worker* reedkiln_worker_get(void);
+static void reedkiln_worker_stray(void);
+static void reedkiln_worker_init
+  (struct reedkiln_worker* w, struct reedkiln_vtable const* vt);
+static int reedkiln_sink_fwrite(void* p, void const* data, reedkiln_size n);
+static int reedkiln_sink_fflush(void* p);
+static void reedkiln_out_send(void const* s, size_t n);
+static void reedkiln_out_flush(void);
+static void reedkiln_text_free(struct reedkiln_text* t);
+static int reedkiln_text_reserve(struct reedkiln_text* t, size_t n);
+static void reedkiln_out_write
+  (struct reedkiln_text* t, void const* s, size_t n);
+static void reedkiln_out_puts(struct reedkiln_text* t, char const* s);
+static void reedkiln_out_ulong(struct reedkiln_text* t, unsigned long int v);
+static void reedkiln_out_uintmax(struct reedkiln_text* t, reedkiln_intmax v);
+static char const* reedkiln_outcome_directive
+  (struct reedkiln_run const* run, size_t test_i, int res);
+static int reedkiln_entry_skips
+  (struct reedkiln_run const* run, size_t test_i);
+static void reedkiln_run_entry
+  ( struct reedkiln_run const* run, struct reedkiln_worker* w,
+    size_t pos, struct reedkiln_outcome* out);
+static void reedkiln_print_unrun
+  (struct reedkiln_run const* run, size_t test_i);
+static int reedkiln_print_result
+  ( struct reedkiln_run const* run, size_t test_i,
+    struct reedkiln_outcome const* result, struct reedkiln_worker* w);
+static void reedkiln_outcome_free(struct reedkiln_outcome* result);
+static void reedkiln_report_capture
+  (struct reedkiln_worker* w, struct reedkiln_outcome* result);
+static void reedkiln_report_plan(size_t count, unsigned int seed);
+static struct reedkiln_worker* reedkiln_subworker_new
+  (struct reedkiln_worker* parent);
+static void reedkiln_subworker_free(struct reedkiln_worker* sub);
+static void reedkiln_out_indent
+  (struct reedkiln_text* t, unsigned char const* data, size_t n);
+static void reedkiln_subtest_plan(struct reedkiln_worker* w);
+static void reedkiln_subtest_run
+  ( struct reedkiln_worker* sub, struct reedkiln_entry const* test,
+    void* p, unsigned int number, struct reedkiln_subresult* out);
+static void reedkiln_subtest_loop
+  (struct reedkiln_subgroup* group, struct reedkiln_worker* sub);
+static void reedkiln_report_test
+  ( struct reedkiln_run const* run, size_t test_i,
+    struct reedkiln_outcome const* result, struct reedkiln_worker* w);
+static void reedkiln_report_bail(struct reedkiln_outcome const* result);
+static void reedkiln_report_finish(void);
+static int reedkiln_report_open
+  (struct reedkiln_report_file* rf, char const* spec, char const* suite);
+static int reedkiln_report_close
+  (struct reedkiln_report_file* rf, unsigned int count, unsigned int base);
+static void reedkiln_xml_write(FILE* f, char const* s, size_t n);
+static void reedkiln_json_write(FILE* f, char const* s, size_t n);
+static void reedkiln_bin_u32(unsigned char* b, unsigned long int v);
+static void reedkiln_bin_record
+  ( FILE* f, unsigned int kind, unsigned char const* head, size_t head_len,
+    char const* s, size_t n);
+static void reedkiln_log_reset(struct reedkiln_worker* w);
+static void reedkiln_log_free(struct reedkiln_worker* w);
+static void reedkiln_fixture_release(struct reedkiln_worker* w);
+static unsigned int reedkiln_log_chunk_index(size_t pos);
+static size_t reedkiln_log_chunk_start(unsigned int k);
+static unsigned char* reedkiln_log_chunk
+  (struct reedkiln_logbuf* ptr, struct reedkiln_logseg* seg, unsigned int k);
+static int reedkiln_log_put
+  ( struct reedkiln_logbuf* ptr, struct reedkiln_logseg* seg,
+    void const* s, size_t n);
+static void reedkiln_out_double(struct reedkiln_text* t, double v);
+static double reedkiln_clock_ns(void);
+static double reedkiln_cpu_ns(int thread_tf);
+static void reedkiln_timing_mark
+  (struct reedkiln_worker const* w, double* mark);
+static void reedkiln_timing_add
+  ( struct reedkiln_worker const* w, double* wall_ms, double* cpu_ms,
+    double* mark);
+static void reedkiln_timing_render
+  (struct reedkiln_timing const* timing, struct reedkiln_text* t);
+static void reedkiln_alloc_start(void);
+static void reedkiln_alloc_stop(void);
+static void reedkiln_alloc_lock(void);
+static void reedkiln_alloc_unlock(void);
+static size_t reedkiln_alloc_slot(void const* p, size_t cap);
+static struct reedkiln_alloc_rec* reedkiln_alloc_find(void const* p);
+static int reedkiln_alloc_grow(void);
+static void reedkiln_alloc_begin(struct reedkiln_worker* w);
+static void reedkiln_alloc_end
+  (struct reedkiln_worker* w, struct reedkiln_allocs* out);
+static int reedkiln_alloc_over
+  (struct reedkiln_worker* w, struct reedkiln_allocs const* counts);
+static void reedkiln_alloc_render
+  (struct reedkiln_allocs const* counts, struct reedkiln_text* t);
+static int reedkiln_perf_open(struct reedkiln_worker* w);
+static void reedkiln_perf_close(struct reedkiln_worker* w);
+static void reedkiln_perf_begin(struct reedkiln_worker* w);
+static void reedkiln_perf_end
+  (struct reedkiln_worker* w, struct reedkiln_perf* out);
+static void reedkiln_perf_render
+  (struct reedkiln_perf const* perf, struct reedkiln_text* t);
+static void reedkiln_print_slowest
+  (struct reedkiln_run const* run, unsigned int n);
+static unsigned long int reedkiln_entry_timeout
+  (struct reedkiln_run const* run, size_t test_i);
+static int reedkiln_timeouts_used(struct reedkiln_run const* run);
+static void reedkiln_timeout_check(struct reedkiln_worker* w);
+static void reedkiln_timeout_note
+  (struct reedkiln_worker* w, unsigned long int timeout_ms);
+static int reedkiln_watchdog_start(void);
+static void reedkiln_watchdog_stop(void);
+static void reedkiln_watchdog_arm
+  ( struct reedkiln_worker* w, size_t test_i, char const* name,
+    unsigned long int timeout_ms);
+static unsigned int reedkiln_watchdog_disarm(struct reedkiln_worker* w);
+static void reedkiln_watchdog_leave(struct reedkiln_worker* w);
+static double reedkiln_sqrt(double x);
+static int reedkiln_bench_sample
+  ( struct reedkiln_worker* w, reedkiln_cb cb, void* p,
+    reedkiln_size n, double* ns);
+static int reedkiln_run_bench
+  ( struct reedkiln_run const* run, struct reedkiln_worker* w,
+    reedkiln_cb cb, void* p);
+static void reedkiln_bench_stats
+  (struct reedkiln_bench* bench, double* times, unsigned int n);
+static void reedkiln_bench_render
+  (struct reedkiln_bench const* bench, struct reedkiln_text* t);
+static void reedkiln_yaml_render
+  ( struct reedkiln_run const* run, struct reedkiln_worker* w,
+    struct reedkiln_outcome const* result, struct reedkiln_text* t);
 static unsigned int reedkiln_log_nextpos
   (struct reedkiln_logbuf* ptr, reedkiln_size n);
-static void reedkiln_log_escape(unsigned char const* data, size_t n, FILE* f);
+static size_t reedkiln_log_plain_run(unsigned char const* data, size_t n);
+static void reedkiln_log_escape
+  ( unsigned char const* data, size_t n, struct reedkiln_text* t,
+    int* was_digit);
 static int reedkiln_log_vsnprintf
   (unsigned char* output, size_t sz, char const* format, va_list ap);
 static int reedkiln_log_itox
@@ -141,22 +468,255 @@ enum reedkiln_const {
   /** @note Approximate base-2 maximum long double exponent */
   Reedkiln_DMaxExp = (LDBL_MAX_10_EXP) * 4,
   /** @note Bias for length modifier */
-  Reedkiln_Bias = 128u
+  Reedkiln_Bias = 128u,
+  /** @note Size of each worker's first log chunk and default capacity */
+  Reedkiln_LogSize = 128u,
+  /** @note Number of log chunks, each twice the size of the last */
+  Reedkiln_LogChunks = 24,
+  /** @note Number of threads per test with their own log segment */
+  Reedkiln_LogSegments = 16,
+  /** @note Number of timed samples per benchmark */
+  Reedkiln_BenchSamples = 10,
+  /** @note Milliseconds between watchdog checks */
+  Reedkiln_WatchPeriod = 10,
+  /** @note Least milliseconds a late test has to reach a check point */
+  Reedkiln_WatchGrace = 1000,
+  /** @note Default size of the output buffer */
+  Reedkiln_OutSize = 65536,
+  /** @note Bytes of random fill per helper thread */
+  Reedkiln_RandSplit = 4194304,
+  /** @note Max number of threads filling one random buffer */
+  Reedkiln_RandJobs = 8,
+  /** @note Max number of threads running one test's subtests */
+  Reedkiln_SubtestJobs = 16,
+  /** @note Default number of inputs per property check */
+  Reedkiln_PropTrials = 1000,
+  /** @note Max number of attempts to shrink a counterexample */
+  Reedkiln_PropShrinks = 10000,
+  /** @note Number of hardware performance counters per test */
+  Reedkiln_PerfCount = 5,
+  /** @note Max number of reporters alongside the TAP output */
+  Reedkiln_ReportMax = 8,
+  /** @note Journal record kind for a test about to run */
+  Reedkiln_JournalStart = 2,
+  /** @note Journal record kind for a test that returned */
+  Reedkiln_JournalFinish = 3,
+  /** @note Journal record kind for a run that ended without a crash */
+  Reedkiln_JournalClose = 4
 };
 
-static struct reedkiln_vtable reedkiln_vtable_c = {
-  &reedkiln_passthrough,
-  &reedkiln_failfast
-};
+/** @note Upper limit for benchmark iterations per sample */
+static reedkiln_size const reedkiln_bench_max = 1000000000u;
 
 struct reedkiln_jmp {
   unsigned int active;
   jmp_buf buf;
 };
 
+/**
+ * @brief Log storage limits.
+ */
+struct reedkiln_logconf {
+  /** @brief Bytes to keep for each test. */
+  unsigned int capacity;
+  /** @brief Log offset past which chunks live in a temporary file. */
+  unsigned int spill;
+};
+
+/**
+ * @brief One thread's share of a test log.
+ *
+ * A segment holds timestamped records in a list of chunks, each twice
+ * the size of the last. Chunks are allocated on first use and kept from
+ * one test to the next, except for chunks mapped from the temporary
+ * file, which are released when the log resets.
+ */
+struct reedkiln_logseg {
+  /** @brief Bytes of records written since the last reset. */
+  size_t len;
+  /** @brief Nonzero while a writer holds a shared segment. */
+  Reedkiln_Atomic_tag unsigned int lock;
+  unsigned char* chunk[Reedkiln_LogChunks];
+  /** @brief Start of each file mapping, or NULL for heap chunks. */
+  void* chunk_map[Reedkiln_LogChunks];
+  size_t chunk_map_len[Reedkiln_LogChunks];
+};
+
+/**
+ * @brief Header of each record in a log segment.
+ */
+struct reedkiln_logrec {
+  double stamp;
+  size_t len;
+};
+
+/**
+ * @brief Per-worker log: one segment for each thread that writes to it.
+ */
 struct reedkiln_logbuf {
+  /** @brief Bytes claimed by all writers during the current test. */
   Reedkiln_Atomic_tag unsigned int pos;
+  /** @brief First chunk of the first segment. */
   unsigned char* data;
+  struct reedkiln_logconf conf;
+  /** @brief Changed at each reset to retire thread registrations. */
+  Reedkiln_Atomic_tag unsigned int generation;
+  /** @brief Number of segments handed out since the last reset. */
+  Reedkiln_Atomic_tag unsigned int seg_count;
+  struct reedkiln_logseg seg[Reedkiln_LogSegments];
+  /** @brief Guards the temporary file. */
+  Reedkiln_Atomic_tag unsigned int spill_lock;
+  FILE* spill_file;
+  size_t spill_len;
+};
+
+/**
+ * @brief Thread's random stream.
+ */
+struct reedkiln_randtls {
+  struct reedkiln_worker* w;
+  unsigned int generation;
+  unsigned int state;
+};
+
+/**
+ * @brief Thread's registration with a log.
+ */
+struct reedkiln_logtls {
+  struct reedkiln_logbuf* log;
+  unsigned int generation;
+  unsigned int slot;
+};
+
+/**
+ * @brief Test name pattern from the command line.
+ */
+struct reedkiln_pattern {
+  char const* text;
+  /** @brief Whether to match as a plain prefix instead of a glob. */
+  int prefix_tf;
+};
+
+/**
+ * @brief Test selection from the command line.
+ */
+struct reedkiln_filter {
+  struct reedkiln_pattern* include;
+  size_t include_count;
+  struct reedkiln_pattern* exclude;
+  size_t exclude_count;
+};
+
+/**
+ * @brief Recorded wall time of one test.
+ */
+struct reedkiln_duration {
+  char* name;
+  double ms;
+};
+
+/**
+ * @brief Recorded wall times, sorted by name once loaded.
+ */
+struct reedkiln_durations {
+  struct reedkiln_duration* rec;
+  size_t count;
+  size_t cap;
+};
+
+/**
+ * @brief Test that passed in an earlier run.
+ */
+struct reedkiln_cached {
+  char* name;
+  unsigned int seed;
+  /** @brief Whether this run replaces the record. */
+  int drop_tf;
+};
+
+/**
+ * @brief Passing tests from earlier runs of the same binary.
+ */
+struct reedkiln_cache {
+  /** @brief Hash of the test binary or of a user fingerprint. */
+  char fingerprint[24];
+  /** @brief Records for this fingerprint, sorted by name and seed. */
+  struct reedkiln_cached* rec;
+  size_t count;
+  size_t cap;
+  /** @brief Whether to skip tests found in the cache. */
+  int use_tf;
+  /**
+   * @brief State of each test in this run: zero if not run,
+   *   one if passed, two otherwise.
+   */
+  unsigned char* state;
+};
+
+/**
+ * @brief Results kept so that a stopped run can resume.
+ */
+struct reedkiln_journal {
+  FILE* f;
+  /** @brief Whether a record failed to reach the journal. */
+  int error_tf;
+  /** @brief Number of tests with results, replayed or new. */
+  size_t done;
+  /** @brief Number of results replayed from an earlier run. */
+  size_t replay_count;
+  /** @brief TAP text of each replayed result, empty for the others. */
+  struct reedkiln_text* replay;
+  /** @brief Whether each replayed result counts as a failure. */
+  unsigned char* failed;
+};
+
+/**
+ * @brief Results of one test across repeated runs.
+ */
+struct reedkiln_repeat_stat {
+  /** @brief Number of runs that were not skipped. */
+  unsigned long int runs;
+  unsigned long int failures;
+  /** @brief Wall time in milliseconds, summed by Welford's method. */
+  double min_ms;
+  double max_ms;
+  double mean_ms;
+  double m2_ms;
+  /** @brief Iteration of the first failure, counting from 1. */
+  unsigned long int fail_iteration;
+  /** @brief Random seed of the run with the first failure. */
+  unsigned int fail_seed;
+};
+
+/**
+ * @brief State of a run that repeats the selected tests.
+ */
+struct reedkiln_repeat {
+  /** @brief Most iterations to run, or zero for no limit. */
+  unsigned long int count;
+  /** @brief Whether to stop after an iteration with a failure. */
+  int until_fail_tf;
+  /** @brief Current iteration, counting from 1. */
+  unsigned long int iteration;
+  /** @brief Random seed of the first iteration. */
+  unsigned int base_seed;
+  /** @brief Whether any iteration had a failure. */
+  int failed_tf;
+  /** @brief Whether a test bailed out. */
+  int bail_tf;
+  /** @brief Whether the summaries are printing. */
+  int final_tf;
+  struct reedkiln_repeat_stat* stats;
+  /** @brief First failure of each test, or else its latest result. */
+  struct reedkiln_outcome* keep;
+};
+
+/**
+ * @brief Test's place in the shard assignment.
+ */
+struct reedkiln_shard_item {
+  double ms;
+  size_t test_i;
 };
 
 struct reedkiln_setup_data {
@@ -165,56 +725,394 @@ struct reedkiln_setup_data {
   void* out;
 };
 
+/**
+ * @brief Benchmark timing state and summary.
+ */
+struct reedkiln_bench {
+  /** @brief Iterations per sample, or zero outside of a benchmark. */
+  reedkiln_size count;
+  unsigned int paused_tf;
+  double start_ns;
+  double elapsed_ns;
+  /** @brief Number of timed samples, or zero if not summarized. */
+  unsigned int samples;
+  reedkiln_size iterations;
+  double mean_ns;
+  double median_ns;
+  double stddev_ns;
+  unsigned int outliers;
+};
+
+/**
+ * @brief Time spent in each phase of a test.
+ */
+struct reedkiln_timing {
+  double setup_ms;
+  double test_ms;
+  double teardown_ms;
+  double setup_cpu_ms;
+  double test_cpu_ms;
+  double teardown_cpu_ms;
+};
+
+/**
+ * @brief Hardware counter values for a test callback.
+ */
+struct reedkiln_perf {
+  reedkiln_intmax value[Reedkiln_PerfCount];
+  /** @brief Bit set for each counter that has a value. */
+  unsigned int mask;
+};
+
+/**
+ * @brief Watchdog registration for a worker.
+ */
+struct reedkiln_watch {
+  /** @brief Deadline of the running test, or zero if unwatched. */
+  double deadline_ns;
+  /** @brief When the watchdog found the test past its deadline. */
+  double flagged_ns;
+  unsigned long int timeout_ms;
+  size_t test_i;
+  char const* name;
+  struct reedkiln_worker* next;
+  unsigned int linked_tf;
+};
+
+/**
+ * @brief Buffer in front of the output sink.
+ */
+struct reedkiln_outbuf {
+  struct reedkiln_sink sink;
+  unsigned char* data;
+  size_t len;
+  size_t cap;
+  /** @brief Buffer size to allocate on first use. */
+  size_t want;
+};
+
+/**
+ * @brief Growable byte buffer for deferred output.
+ */
+struct reedkiln_text {
+  unsigned char* data;
+  size_t len;
+  size_t cap;
+};
+
+struct reedkiln_gen {
+  /** @brief Choices made so far in this trial. */
+  unsigned long int* choice;
+  size_t len;
+  size_t cap;
+  /** @brief Choices to replay, or NULL to draw new ones. */
+  unsigned long int const* replay;
+  size_t replay_len;
+  /** @brief Description of the values drawn, or NULL. */
+  struct reedkiln_text* describe;
+  /** @brief Whether a choice could not be recorded. */
+  int overrun_tf;
+};
+
+/**
+ * @brief Search state for a property check.
+ */
+struct reedkiln_prop_data {
+  reedkiln_prop_cb cb;
+  void* p;
+  struct reedkiln_gen gen;
+  /** @brief Smallest failing choices found so far. */
+  unsigned long int* best;
+  size_t best_len;
+  /** @brief Candidate choices to try next. */
+  unsigned long int* cand;
+  /** @brief Number of shrink attempts left. */
+  unsigned int budget;
+  /** @brief Number of successful shrinks. */
+  unsigned int shrinks;
+  struct reedkiln_text text;
+  /** @brief Worker's quiet flag from before the check. */
+  unsigned int quiet_tf;
+};
+
+/**
+ * @brief Per-thread test state.
+ */
+struct reedkiln_worker {
+  Reedkiln_Atomic_tag unsigned int next_status;
+  unsigned int bail_tf;
+  /** @brief Whether to capture diagnostics for later printing. */
+  unsigned int capture_tf;
+  /** @brief Whether to measure per-thread instead of process CPU time. */
+  unsigned int thread_cpu_tf;
+  struct reedkiln_vtable vtable;
+  /** @brief Seed of the running test's first random stream. */
+  unsigned int rand_seed;
+  /** @brief Changed at each reseed to retire thread streams. */
+  Reedkiln_Atomic_tag unsigned int rand_generation;
+  /** @brief Number of random streams handed out since the last reseed. */
+  Reedkiln_Atomic_tag unsigned int rand_streams;
+  struct reedkiln_logbuf log;
+  unsigned char log_data[Reedkiln_LogSize];
+  /** @brief Capture for diagnostics, or NULL to print immediately. */
+  struct reedkiln_text* notes;
+  struct reedkiln_bench bench;
+  /**
+   * @brief One if the watchdog found the running test past its deadline,
+   *   two once the test has been failed for it.
+   */
+  Reedkiln_Atomic_tag unsigned int timeout_tf;
+  struct reedkiln_watch watch;
+  /** @brief Whether a test is running on this worker. */
+  unsigned int running_tf;
+  /** @brief Whether to drop diagnostics and log writes. */
+  unsigned int quiet_tf;
+  /** @brief Box of the item kept for the next test, or NULL. */
+  struct reedkiln_box const* fixture_box;
+  /** @brief Item kept for the next test with the same box. */
+  void* fixture_item;
+  /** @brief Whether to count allocations on this worker. */
+  Reedkiln_Atomic_tag unsigned int alloc_tf;
+  /** @brief Test whose allocations are being counted. */
+  unsigned int alloc_serial;
+  /** @brief Allocation counts for the running test. */
+  struct reedkiln_allocs allocs;
+  /** @brief Most allocations and bytes the running test may make. */
+  reedkiln_size alloc_budget[2];
+  /** @brief Next worker counting allocations. */
+  struct reedkiln_worker* alloc_next;
+  /** @brief Whether to read hardware counters around test callbacks. */
+  unsigned int perf_tf;
+  /** @brief Process that opened the counters, or zero if not open. */
+  long int perf_pid;
+  /** @brief Counter descriptors, or -1 for counters not available. */
+  int perf_fd[Reedkiln_PerfCount];
+  /** @brief Worker of the test running this subtest, or NULL. */
+  struct reedkiln_worker* parent;
+  /** @brief Name of the running test or subtest. */
+  char const* test_name;
+  /** @brief Number of subtests printed for the running test. */
+  unsigned int subtest_count;
+};
+
+struct reedkiln_outcome {
+  int res;
+  int skip_tf;
+  int bail_tf;
+  char const* direct_text;
+  /** @brief Random seed given to the test. */
+  unsigned int seed;
+  struct reedkiln_timing timing;
+  /** @brief Allocations made by the test callback. */
+  struct reedkiln_allocs allocs;
+  /** @brief Hardware counters read around the test callback. */
+  struct reedkiln_perf perf;
+  /** @brief Diagnostics to print before the result line. */
+  struct reedkiln_text notes;
+  /** @brief YAML block to print after the result line. */
+  struct reedkiln_text yaml;
+  /** @brief Unescaped log text for the reporters. */
+  struct reedkiln_text message;
+};
+
+struct reedkiln_run {
+  struct reedkiln_entry const* t;
+  size_t test_count;
+  void* p;
+  unsigned int rand_seed;
+  /** @brief Seed for every test, if `test_seed_tf` is set. */
+  unsigned int test_seed;
+  /** @brief Whether every test takes `test_seed` as its own. */
+  int test_seed_tf;
+  struct reedkiln_vtable initial_table;
+  /** @brief Target time in seconds for each benchmark. */
+  double bench_time;
+  /** @brief Whether to add timing to the YAML block. */
+  int timing_tf;
+  /** @brief Wall time of each printed test in milliseconds, or NULL. */
+  double* durations;
+  /** @brief Timeout for tests whose box sets none, or zero for none. */
+  unsigned long int timeout_ms;
+  /** @brief Results of earlier runs, or NULL. */
+  struct reedkiln_cache* cache;
+  /** @brief Whether to add allocation counts to the YAML block. */
+  int allocs_tf;
+  /** @brief Whether to add hardware counters to the YAML block. */
+  int perf_tf;
+  /** @brief Journal of printed results, or NULL. */
+  struct reedkiln_journal* journal;
+  /** @brief Repeat state, or NULL to run the tests once. */
+  struct reedkiln_repeat* repeat;
+  /** @brief Test index at each place in the run order, or NULL. */
+  size_t* order;
+};
+
 /* BEGIN failure path */
-static Reedkiln_Atomic_tag unsigned int reedkiln_next_status = Reedkiln_OK;
 static Reedkiln_Atomic_tag unsigned int reedkiln_bail_status = Reedkiln_OK;
+/* set once the alloc.h hooks see an allocation */
+static Reedkiln_Atomic_tag unsigned int reedkiln_alloc_hooked = 0u;
 
 static Reedkiln_Thread_local struct reedkiln_jmp reedkiln_next_jmp = {0};
 
+static struct reedkiln_worker reedkiln_worker_main = {
+  Reedkiln_OK, 0u, 0u, 0u,
+  { &reedkiln_passthrough, &reedkiln_failfast },
+  0u, 0u, 0u,
+  { 0, reedkiln_worker_main.log_data }
+};
+static Reedkiln_Thread_local struct reedkiln_worker* reedkiln_worker_tls
+  = NULL;
+/* nonzero while pool threads run the tests and the main worker is idle */
+static Reedkiln_Atomic_tag unsigned int reedkiln_worker_pool_tf = 0u;
+
+struct reedkiln_worker* reedkiln_worker_get(void) {
+  struct reedkiln_worker* const w = reedkiln_worker_tls;
+  if (w != NULL)
+    return w;
+  else if (Reedkiln_Atomic_Get(&reedkiln_worker_pool_tf))
+    reedkiln_worker_stray();
+  return &reedkiln_worker_main;
+}
+
+/**
+ * @brief Stop a thread that has no test state during a `-j` run.
+ * @note Such a thread would otherwise share the main worker with
+ *   every other stray thread, racing on its log and failure status.
+ *   Like the watchdog, this passes on the buffered output and closes
+ *   the reports before it ends the process.
+ */
+void reedkiln_worker_stray(void) {
+  fputs("reedkiln: a thread used the test state without `reedkiln_attach`"
+    " during a parallel run\n", stderr);
+  reedkiln_out_puts(NULL, "Bail out! a thread used the test state"
+    " without reedkiln_attach\n");
+  reedkiln_out_flush();
+  reedkiln_report_finish();
+  /* abort skips the stream buffers, so the reports need this */
+  (void)fflush(NULL);
+  abort();
+}
+
+void* reedkiln_current(void) {
+  return reedkiln_worker_get();
+}
+
+void reedkiln_attach(void* handle) {
+  reedkiln_worker_tls = (struct reedkiln_worker*)handle;
+  return;
+}
+
+void reedkiln_worker_init
+  (struct reedkiln_worker* w, struct reedkiln_vtable const* vt)
+{
+  Reedkiln_Atomic_Put(&w->next_status, Reedkiln_OK);
+  w->bail_tf = 0u;
+  w->capture_tf = 1u;
+  w->thread_cpu_tf = 1u;
+  w->vtable = *vt;
+  w->rand_seed = 0u;
+  Reedkiln_Atomic_Put(&w->rand_generation, 0u);
+  Reedkiln_Atomic_Put(&w->rand_streams, 0u);
+  memset(&w->log, 0, sizeof(w->log));
+  w->log.data = w->log_data;
+  w->notes = NULL;
+  memset(&w->bench, 0, sizeof(w->bench));
+  Reedkiln_Atomic_Put(&w->timeout_tf, 0u);
+  memset(&w->watch, 0, sizeof(w->watch));
+  w->quiet_tf = 0u;
+  w->fixture_box = NULL;
+  w->fixture_item = NULL;
+  Reedkiln_Atomic_Put(&w->alloc_tf, 0u);
+  w->alloc_serial = 0u;
+  memset(&w->allocs, 0, sizeof(w->allocs));
+  w->alloc_budget[0] = Reedkiln_AllocAny;
+  w->alloc_budget[1] = Reedkiln_AllocAny;
+  w->alloc_next = NULL;
+  w->perf_tf = 0u;
+  w->perf_pid = 0;
+  w->parent = NULL;
+  w->test_name = NULL;
+  w->subtest_count = 0u;
+  return;
+}
+
+/**
+ * @brief Tear down the item kept for the next test, if any.
+ * @param w worker holding the item
+ */
+void reedkiln_fixture_release(struct reedkiln_worker* w) {
+  struct reedkiln_box const* const box = w->fixture_box;
+  void* const item = w->fixture_item;
+  w->fixture_box = NULL;
+  w->fixture_item = NULL;
+  if (box != NULL && box->teardown != NULL)
+    (*box->teardown)(item);
+  return;
+}
+
 void reedkiln_fail(void) {
-  Reedkiln_Atomic_Put(&reedkiln_next_status, Reedkiln_NOT_OK);
-  (*reedkiln_vtable_c.fail_cb)();
+  struct reedkiln_worker* const w = reedkiln_worker_get();
+  Reedkiln_Atomic_Put(&w->next_status, Reedkiln_NOT_OK);
+  (*w->vtable.fail_cb)();
   abort()/* in case the above doesn't work */;
 }
 
 void reedkiln_assert_ex
   (int val, char const* text, char const* file, unsigned long int line)
 {
-  if (!val) {
-    fprintf(stdout, "## assert %s:%lu: %s\n", file, line, text);
+  reedkiln_timeout_check(reedkiln_worker_get());
+  if (!val && reedkiln_worker_get()->quiet_tf)
+    reedkiln_fail();
+  else if (!val) {
+    struct reedkiln_text* const notes = reedkiln_worker_get()->notes;
+    reedkiln_out_puts(notes, "## assert ");
+    reedkiln_out_puts(notes, file);
+    reedkiln_out_puts(notes, ":");
+    reedkiln_out_ulong(notes, line);
+    reedkiln_out_puts(notes, ": ");
+    reedkiln_out_puts(notes, text);
+    reedkiln_out_puts(notes, "\n");
     reedkiln_fail();
   }
   return;
 }
 
 void reedkiln_bail_out(char const* reason) {
-  Reedkiln_Atomic_Put(&reedkiln_next_status, Reedkiln_NOT_OK);
+  struct reedkiln_worker* const w = reedkiln_worker_get();
+  Reedkiln_Atomic_Put(&w->next_status, Reedkiln_NOT_OK);
+  w->bail_tf = 1u;
   Reedkiln_Atomic_Put(&reedkiln_bail_status, Reedkiln_NOT_OK);
   reedkiln_print_bail(reason);
-  (*reedkiln_vtable_c.fail_cb)();
+  (*w->vtable.fail_cb)();
   /* in case the above doesn't work */{
     abort();
   }
 }
 
 void reedkiln_print_bail(char const* reason) {
-  fputs("Bail out!", stdout);
+  struct reedkiln_text* const notes = reedkiln_worker_get()->notes;
+  reedkiln_out_puts(notes, "Bail out!");
   if (reason != NULL) {
-    fputc(' ', stdout);
-    fputs(reason, stdout);
+    reedkiln_out_puts(notes, " ");
+    reedkiln_out_puts(notes, reason);
   }
-  fputc('\n', stdout);
+  reedkiln_out_puts(notes, "\n");
   return;
 }
 
 int reedkiln_run_test(reedkiln_cb cb, void* p) {
+  struct reedkiln_worker* const w = reedkiln_worker_get();
+  /* keep the caller's state in case of a nested call */
+  struct reedkiln_jmp const outer = reedkiln_next_jmp;
+  unsigned int const outer_status = Reedkiln_Atomic_Get(&w->next_status);
   int res;
-  Reedkiln_Atomic_Put(&reedkiln_next_status, Reedkiln_OK);
-  res = (*reedkiln_vtable_c.catch_cb)(cb, p);
-  reedkiln_next_jmp.active = 0u;
-  return res == Reedkiln_OK
-    ? Reedkiln_Atomic_Get(&reedkiln_next_status)
-    : res;
+  Reedkiln_Atomic_Put(&w->next_status, Reedkiln_OK);
+  res = (*w->vtable.catch_cb)(cb, p);
+  if (res == Reedkiln_OK)
+    res = Reedkiln_Atomic_Get(&w->next_status);
+  reedkiln_next_jmp = outer;
+  Reedkiln_Atomic_Put(&w->next_status, outer_status);
+  return res;
 }
 
 int reedkiln_setup_redirect(void* d) {
@@ -237,27 +1135,61 @@ int reedkiln_run_setup(reedkiln_setup_cb cb, void* p, void** out) {
 /* END   failure path */
 
 /* BEGIN random stuff */
-static Reedkiln_Atomic_tag unsigned int reedkiln_rand_seed = 0u;
-
-
 unsigned int reedkiln_rand(void) {
+  reedkiln_timeout_check(reedkiln_worker_get());
   return reedkiln_rand_step();
 }
 
+static Reedkiln_Thread_local struct reedkiln_randtls reedkiln_rand_tls
+  = { NULL, 0u, 0u };
+
 unsigned int reedkiln_rand_step(void) {
   static unsigned int const mul = 48271u;
   static unsigned int const add = 9u;
-  unsigned int src = Reedkiln_Atomic_Get(&reedkiln_rand_seed);
-  unsigned int in, out;
-  do {
-    in = src;
-    out = in*mul+add;
-  } while ((src = Reedkiln_Atomic_Xchg(&reedkiln_rand_seed,out)) != in);
-  return out;
+  struct reedkiln_worker* const w = reedkiln_worker_get();
+  struct reedkiln_randtls* const tls = &reedkiln_rand_tls;
+  unsigned int const generation = Reedkiln_Atomic_Get(&w->rand_generation);
+  if (tls->w != w || tls->generation != generation) {
+    /* first draw from this thread since the last reseed */
+    unsigned int const id = Reedkiln_Atomic_Add(&w->rand_streams, 1u);
+    tls->w = w;
+    tls->generation = generation;
+    tls->state = reedkiln_rand_split(w->rand_seed, id);
+  }
+  tls->state = tls->state*mul+add;
+  return tls->state;
+}
+
+/**
+ * @brief Derive the starting state of a random stream.
+ * @param seed seed of stream zero
+ * @param id stream number
+ * @return a starting state
+ */
+unsigned int reedkiln_rand_split(unsigned int seed, unsigned int id) {
+  if (id == 0u)
+    return seed;
+  else return reedkiln_rand_mix(seed ^ reedkiln_rand_mix(id*0x9e3779b9u));
+}
+
+void reedkiln_rand_stream(unsigned int id) {
+  struct reedkiln_worker* const w = reedkiln_worker_get();
+  struct reedkiln_randtls* const tls = &reedkiln_rand_tls;
+  tls->w = w;
+  tls->generation = Reedkiln_Atomic_Get(&w->rand_generation);
+  tls->state = reedkiln_rand_split(w->rand_seed, id);
+  return;
 }
 
 void reedkiln_srand(unsigned int s) {
-  Reedkiln_Atomic_Put(&reedkiln_rand_seed, s);
+  struct reedkiln_worker* const w = reedkiln_worker_get();
+  w->rand_seed = s;
+  Reedkiln_Atomic_Put(&w->rand_streams, 0u);
+  Reedkiln_Atomic_Add(&w->rand_generation, 1u);
+  /* the test thread takes stream zero */
+  reedkiln_rand_stream(0u);
+  Reedkiln_Atomic_Put(&w->rand_streams, 1u);
+  return;
 }
 
 unsigned int reedkiln_default_seed(void) {
@@ -265,112 +1197,779 @@ unsigned int reedkiln_default_seed(void) {
   return (unsigned int)(src*0x87e5c341);
 }
 
-void reedkiln_memrand(void* b, reedkiln_size sz) {
-  size_t xsz = sz - (sz%sizeof(unsigned int));
-  size_t xi;
-  unsigned char* const p = (unsigned char*)b;
-  for (xi = 0u; xi < xsz; xi += sizeof(unsigned int)) {
-    unsigned int const next = reedkiln_rand();
-    memcpy(p+xi, &next, sizeof(unsigned int));
-  }
-  if (xsz < sz) {
-    size_t const rem = sz - xsz;
-    unsigned int const next = reedkiln_rand();
-    memcpy(p+xi, &next, rem);
-  }
-  return;
+/**
+ * @brief Derive a test's random seed from the run's seed.
+ * @param seed seed for the whole run
+ * @param name test name
+ * @return a seed that does not depend on the other tests
+ */
+unsigned int reedkiln_test_seed(unsigned int seed, char const* name) {
+  return reedkiln_rand_mix(seed ^ reedkiln_rand_mix(reedkiln_name_hash(name)));
 }
-/* END   random stuff */
 
-/* BEGIN log buffer */
-static unsigned char reedkiln_logbuf_default[256] = { 0 };
-static struct reedkiln_logbuf reedkiln_log_buffers[2] = {
-  { 0, reedkiln_logbuf_default },
-  { 0, reedkiln_logbuf_default+sizeof(reedkiln_logbuf_default)/2u }
-};
-static unsigned int reedkiln_log_size = sizeof(reedkiln_logbuf_default)/2u;
-static Reedkiln_Atomic_tag unsigned int reedkiln_log_index = 0u;
+/**
+ * @brief Get the random seed of a test in a run.
+ * @param run test run configuration
+ * @param test_i index of the test
+ * @return the seed from `--test-seed` if given, otherwise the seed
+ *   derived from the run's seed
+ */
+unsigned int reedkiln_entry_seed
+  (struct reedkiln_run const* run, size_t test_i)
+{
+  return run->test_seed_tf ? run->test_seed
+    : reedkiln_test_seed(run->rand_seed, run->t[test_i].name);
+}
+
+unsigned int reedkiln_name_hash(char const* name) {
+  /* FNV-1a */
+  unsigned int h = 0x811c9dc5u;
+  unsigned char const* p;
+  for (p = (unsigned char const*)name; *p != 0; ++p)
+    h = (h ^ *p) * 0x01000193u;
+  return h;
+}
+
+unsigned int reedkiln_cpu_count(void) {
+#if (defined _WIN32)
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return (info.dwNumberOfProcessors > 0) ? info.dwNumberOfProcessors : 1u;
+#elif (defined _SC_NPROCESSORS_ONLN)
+  long const count = sysconf(_SC_NPROCESSORS_ONLN);
+  return (count > 0) ? (unsigned int)count : 1u;
+#else
+  return 1u;
+#endif /*_WIN32*/
+}
+
+/**
+ * @brief Finish a 32-bit hash.
+ */
+unsigned int reedkiln_rand_mix(unsigned int x) {
+  x ^= x >> 16;
+  x *= 0x7feb352du;
+  x ^= x >> 15;
+  x *= 0x846ca68bu;
+  x ^= x >> 16;
+  return x;
+}
+
+/**
+ * @brief Compute one block of a counter-based random stream.
+ * @param key stream key
+ * @param ctr block index
+ * @return four random bytes
+ */
+unsigned int reedkiln_rand_block(unsigned int const* key, size_t ctr) {
+  unsigned int const hi = (unsigned int)((ctr >> 16) >> 16);
+  unsigned int const x = (unsigned int)ctr * 0x9e3779b9u + key[0];
+  return reedkiln_rand_mix(reedkiln_rand_mix(x) ^ (key[1] + hi*0x85ebca6bu));
+}
 
-void reedkiln_log_reset(void) {
-  unsigned int const swap_index = Reedkiln_Atomic_Get(&reedkiln_log_index)%2u;
-  struct reedkiln_logbuf* const ptr = reedkiln_log_buffers+swap_index;
-  Reedkiln_Atomic_Put(&ptr->pos, 0);
+/**
+ * @brief Store a block in little-endian order.
+ */
+void reedkiln_rand_put(unsigned char* out, unsigned int x) {
+  out[0] = (unsigned char)(x&255u);
+  out[1] = (unsigned char)((x>>8)&255u);
+  out[2] = (unsigned char)((x>>16)&255u);
+  out[3] = (unsigned char)((x>>24)&255u);
   return;
 }
 
-unsigned int reedkiln_log_swap(void) {
-  unsigned int const src = Reedkiln_Atomic_Get(&reedkiln_log_index);
-  Reedkiln_Atomic_Put(&reedkiln_log_index, src+1);
-  return src%2u;
+#if defined(Reedkiln_SSE2)
+static __m128i reedkiln_rand_mul(__m128i a, __m128i b) {
+  __m128i const even = _mm_mul_epu32(a, b);
+  __m128i const odd =
+    _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+  return _mm_unpacklo_epi32(
+      _mm_shuffle_epi32(even, _MM_SHUFFLE(0,0,2,0)),
+      _mm_shuffle_epi32(odd, _MM_SHUFFLE(0,0,2,0)));
 }
 
-unsigned int reedkiln_log_nextpos
-  (struct reedkiln_logbuf* ptr, reedkiln_size n)
+static __m128i reedkiln_rand_mix4(__m128i x) {
+  x = _mm_xor_si128(x, _mm_srli_epi32(x, 16));
+  x = reedkiln_rand_mul(x, _mm_set1_epi32(0x7feb352d));
+  x = _mm_xor_si128(x, _mm_srli_epi32(x, 15));
+  x = reedkiln_rand_mul(x, _mm_set1_epi32((int)0x846ca68bu));
+  x = _mm_xor_si128(x, _mm_srli_epi32(x, 16));
+  return x;
+}
+#endif /*Reedkiln_SSE2*/
+
+/**
+ * @brief Fill whole blocks of a counter-based random stream.
+ * @param key stream key
+ * @param ctr index of the first block
+ * @param[out] p destination for the blocks
+ * @param n number of blocks to write
+ */
+void reedkiln_rand_fill
+  (unsigned int const* key, size_t ctr, unsigned char* p, size_t n)
 {
-  unsigned int const top =
-     (n > reedkiln_log_size) ? 0 : (unsigned int)(reedkiln_log_size - n);
-  unsigned int src = Reedkiln_Atomic_Get(&ptr->pos);
-  unsigned int in, out;
-  do {
-    if (src >= reedkiln_log_size)
-      return UINT_MAX;
-    in = src;
-    out = (in >= top ? reedkiln_log_size : (unsigned)(in + n));
-  } while ((src = Reedkiln_Atomic_Xchg(&ptr->pos,out)) != in);
-  return in;
+  size_t i = 0u;
+#if defined(Reedkiln_SSE2)
+  /* x86 is little-endian, so each lane stores in stream order */
+  __m128i const golden = _mm_set1_epi32((int)0x9e3779b9u);
+  __m128i const k0 = _mm_set1_epi32((int)key[0]);
+  __m128i const step = _mm_set1_epi32(4);
+  while (n-i >= 4u) {
+    /* stay within one run of the block counter's low word */
+    unsigned int const lo = (unsigned int)(ctr+i);
+    unsigned int const hi = (unsigned int)(((ctr+i) >> 16) >> 16);
+    size_t span = (size_t)(0xffffffffu - lo) + 1u;
+    size_t end;
+    __m128i const k1 = _mm_set1_epi32((int)(key[1] + hi*0x85ebca6bu));
+    __m128i c = _mm_add_epi32(_mm_set1_epi32((int)lo),
+      _mm_set_epi32(3, 2, 1, 0));
+    if (span == 0u || span > n-i)
+      span = n-i;
+    if (span < 4u) {
+      for (end = i+span; i < end; ++i)
+        reedkiln_rand_put(p + i*4u, reedkiln_rand_block(key, ctr+i));
+      continue;
+    }
+    for (end = i + span - span%4u; i < end; i += 4u) {
+      __m128i x = _mm_add_epi32(reedkiln_rand_mul(c, golden), k0);
+      x = reedkiln_rand_mix4(_mm_xor_si128(reedkiln_rand_mix4(x), k1));
+      _mm_storeu_si128((__m128i*)(p + i*4u), x);
+      c = _mm_add_epi32(c, step);
+    }
+  }
+#endif /*Reedkiln_SSE2*/
+  for (; i < n; ++i)
+    reedkiln_rand_put(p + i*4u, reedkiln_rand_block(key, ctr+i));
+  return;
 }
 
-reedkiln_size reedkiln_log_write(void const* buffer, reedkiln_size count) {
-  unsigned int const n =
-    (count >= (UINT_MAX/2)) ? (UINT_MAX/2) : ((unsigned int)count);
-  unsigned char const* data = (unsigned char const*)buffer;
-  unsigned int const swap_index = Reedkiln_Atomic_Get(&reedkiln_log_index)%2u;
-  struct reedkiln_logbuf* const ptr = reedkiln_log_buffers+swap_index;
-  unsigned int const src = reedkiln_log_nextpos(ptr, count);
-  if (src == UINT_MAX)
-    return 0;
-  /* write (possibly truncated) content to log buffer */{
-    size_t const put_length =
-      (size_t)((reedkiln_log_size - src < n) ? reedkiln_log_size - src : n);
-    memcpy(ptr->data + src, buffer, put_length);
-    return put_length;
+#if defined(Reedkiln_Threads)
+struct reedkiln_rand_job {
+  unsigned int const* key;
+  size_t ctr;
+  unsigned char* p;
+  size_t n;
+  thrd_t thread;
+};
+
+static int reedkiln_rand_work(void* arg) {
+  struct reedkiln_rand_job* const job = (struct reedkiln_rand_job*)arg;
+  reedkiln_rand_fill(job->key, job->ctr, job->p, job->n);
+  return 0;
+}
+#endif /*Reedkiln_Threads*/
+
+/**
+ * @brief Fill whole blocks, across several threads for large buffers.
+ * @param key stream key
+ * @param[out] p destination for the blocks
+ * @param n number of blocks to write
+ */
+void reedkiln_rand_fill_all
+  (unsigned int const* key, unsigned char* p, size_t n)
+{
+#if defined(Reedkiln_Threads)
+  unsigned int const cpus = reedkiln_cpu_count();
+  size_t const per = Reedkiln_RandSplit/4u;
+  unsigned int jobs = (n/per < cpus) ? (unsigned int)(n/per) : cpus;
+  if (jobs > Reedkiln_RandJobs)
+    jobs = Reedkiln_RandJobs;
+  if (jobs > 1u) {
+    struct reedkiln_rand_job job[Reedkiln_RandJobs];
+    size_t const share = n/jobs;
+    unsigned int started;
+    size_t ctr = 0u;
+    /* the calling thread takes the last share */
+    for (started = 0u; started+1u < jobs; ++started) {
+      job[started].key = key;
+      job[started].ctr = ctr;
+      job[started].p = p + ctr*4u;
+      job[started].n = share;
+      if (thrd_create(&job[started].thread, reedkiln_rand_work, job+started)
+          != thrd_success)
+      {
+        break;
+      }
+      ctr += share;
+    }
+    reedkiln_rand_fill(key, ctr, p + ctr*4u, n-ctr);
+    while (started > 0u) {
+      started -= 1u;
+      thrd_join(job[started].thread, NULL);
+    }
+    return;
   }
+#endif /*Reedkiln_Threads*/
+  reedkiln_rand_fill(key, 0u, p, n);
+  return;
 }
 
-reedkiln_size reedkiln_log_printf(char const* format, ...) {
-  unsigned int count;
-  unsigned int const swap_index = Reedkiln_Atomic_Get(&reedkiln_log_index)%2u;
-  struct reedkiln_logbuf* const ptr = reedkiln_log_buffers+swap_index;
-  unsigned int src;
-  /* calculate size */{
-    va_list ap;
-    int len;
-    va_start(ap, format);
-    len = reedkiln_log_vsnprintf(NULL, 0, format, ap);
-    if (len == -1)
-      return 0;
-    va_end(ap);
-    count = len+1u;
+void reedkiln_memrand(void* b, reedkiln_size sz) {
+  unsigned char* const p = (unsigned char*)b;
+  size_t const blocks = sz/4u;
+  unsigned int key[2];
+  reedkiln_timeout_check(reedkiln_worker_get());
+  /* key a fresh stream from the seeded generator */
+  key[0] = reedkiln_rand_step();
+  key[1] = reedkiln_rand_step();
+  reedkiln_rand_fill_all(key, p, blocks);
+  if (blocks*4u < sz) {
+    unsigned char tail[4];
+    reedkiln_rand_put(tail, reedkiln_rand_block(key, blocks));
+    memcpy(p + blocks*4u, tail, sz - blocks*4u);
   }
-  /* allocate buffer */{
-    src = reedkiln_log_nextpos(ptr, count);
-    if (src == UINT_MAX)
-      return 0;
+  return;
+}
+/* END   random stuff */
+
+/* BEGIN output text */
+static struct reedkiln_outbuf reedkiln_outbuf = {
+  { &reedkiln_sink_fwrite, &reedkiln_sink_fflush, NULL },
+  NULL, 0u, 0u, Reedkiln_OutSize
+};
+
+int reedkiln_sink_fwrite(void* p, void const* data, reedkiln_size n) {
+  FILE* const f = (p != NULL) ? (FILE*)p : stdout;
+  return fwrite(data, 1, n, f) == n ? 0 : -1;
+}
+
+int reedkiln_sink_fflush(void* p) {
+  return fflush((p != NULL) ? (FILE*)p : stdout);
+}
+
+void reedkiln_set_sink
+  (struct reedkiln_sink const* sink, reedkiln_size buffer_size)
+{
+  struct reedkiln_outbuf* const out = &reedkiln_outbuf;
+  reedkiln_out_flush();
+  if (sink != NULL)
+    out->sink = *sink;
+  else {
+    out->sink.write_cb = &reedkiln_sink_fwrite;
+    out->sink.flush_cb = &reedkiln_sink_fflush;
+    out->sink.p = NULL;
   }
-  /* write (possibly truncated) content to log buffer */{
-    size_t const put_length = (size_t)((reedkiln_log_size - src < count)
-       ? reedkiln_log_size - src : count);
-    va_list ap;
-    va_start(ap, format);
-    (void)reedkiln_log_vsnprintf(ptr->data+src, put_length, format, ap);
-    va_end(ap);
-    return (unsigned int)put_length;
+  out->want = (buffer_size > 0u) ? buffer_size : Reedkiln_OutSize;
+  if (out->cap != out->want) {
+    free(out->data);
+    out->data = NULL;
+    out->cap = 0u;
   }
+  return;
 }
 
-struct reedkiln_log_attr reedkiln_log_adjust_type(char const** p) {
-  struct reedkiln_log_attr value = {Reedkiln_Bias};
-  /* skip over the initial % */
+/**
+ * @brief Add bytes to the output buffer.
+ * @param s bytes to send
+ * @param n number of bytes
+ */
+void reedkiln_out_send(void const* s, size_t n) {
+  struct reedkiln_outbuf* const out = &reedkiln_outbuf;
+  if (out->data == NULL && out->want > 0u) {
+    out->data = (unsigned char*)malloc(out->want);
+    out->cap = (out->data != NULL) ? out->want : 0u;
+  }
+  if (n > out->cap - out->len) {
+    if (out->len > 0u)
+      (void)(*out->sink.write_cb)(out->sink.p, out->data, out->len);
+    out->len = 0u;
+    if (n >= out->cap) {
+      (void)(*out->sink.write_cb)(out->sink.p, s, n);
+      return;
+    }
+  }
+  memcpy(out->data + out->len, s, n);
+  out->len += n;
+  return;
+}
+
+/**
+ * @brief Pass buffered output to the sink.
+ */
+void reedkiln_out_flush(void) {
+  struct reedkiln_outbuf* const out = &reedkiln_outbuf;
+  if (out->len > 0u)
+    (void)(*out->sink.write_cb)(out->sink.p, out->data, out->len);
+  out->len = 0u;
+  if (out->sink.flush_cb != NULL)
+    (void)(*out->sink.flush_cb)(out->sink.p);
+  return;
+}
+
+void reedkiln_text_free(struct reedkiln_text* t) {
+  free(t->data);
+  t->data = NULL;
+  t->len = 0u;
+  t->cap = 0u;
+  return;
+}
+
+int reedkiln_text_reserve(struct reedkiln_text* t, size_t n) {
+  if (n > t->cap - t->len) {
+    size_t new_cap = t->cap ? t->cap : 64u;
+    unsigned char* new_data;
+    while (new_cap - t->len < n) {
+      if (new_cap > ((size_t)-1)/2u)
+        return -1;
+      new_cap *= 2u;
+    }
+    new_data = (unsigned char*)realloc(t->data, new_cap);
+    if (new_data == NULL)
+      return -1;
+    t->data = new_data;
+    t->cap = new_cap;
+  }
+  return 0;
+}
+
+void reedkiln_out_write(struct reedkiln_text* t, void const* s, size_t n) {
+  if (t == NULL) {
+    reedkiln_out_send(s, n);
+  } else if (reedkiln_text_reserve(t, n) == 0) {
+    memcpy(t->data + t->len, s, n);
+    t->len += n;
+  }
+  return;
+}
+
+void reedkiln_out_puts(struct reedkiln_text* t, char const* s) {
+  reedkiln_out_write(t, s, strlen(s));
+  return;
+}
+
+void reedkiln_out_ulong(struct reedkiln_text* t, unsigned long int v) {
+  reedkiln_out_uintmax(t, v);
+  return;
+}
+
+void reedkiln_out_uintmax(struct reedkiln_text* t, reedkiln_intmax v) {
+  unsigned char digits[Reedkiln_ItoAMax];
+  int const len = reedkiln_log_itoa(digits, v);
+  int i;
+  /* reverse */for (i = 0; i < len/2; ++i) {
+    unsigned char const tmp = digits[i];
+    digits[i] = digits[len-i-1];
+    digits[len-i-1] = tmp;
+  }
+  reedkiln_out_write(t, digits, (size_t)len);
+  return;
+}
+
+void reedkiln_out_double(struct reedkiln_text* t, double v) {
+  char buf[64];
+  if (v < 1e15 && v > -1e15)
+    sprintf(buf, "%.3f", v);
+  else
+    sprintf(buf, "%.6e", v);
+  reedkiln_out_puts(t, buf);
+  return;
+}
+/* END   output text */
+
+/* BEGIN log buffer */
+static struct reedkiln_logconf reedkiln_logconf_default = {
+  Reedkiln_LogSize, 1048576u
+};
+
+static Reedkiln_Thread_local struct reedkiln_logtls reedkiln_log_tls
+  = { NULL, 0u, 0u };
+
+void reedkiln_log_configure(reedkiln_size capacity, reedkiln_size spill) {
+  struct reedkiln_worker* const w = reedkiln_worker_get();
+  struct reedkiln_logconf conf;
+  conf.capacity = (capacity == 0u) ? Reedkiln_LogSize
+    : (capacity >= UINT_MAX/4 ? UINT_MAX/4 : (unsigned int)capacity);
+  conf.spill = (spill == 0u) ? 1048576u
+    : (spill >= UINT_MAX/4 ? UINT_MAX/4 : (unsigned int)spill);
+  if (w->running_tf)
+    w->log.conf = conf;
+  else reedkiln_logconf_default = conf;
+  return;
+}
+
+/**
+ * @brief Release the chunks of a log segment.
+ * @param seg the segment
+ * @param keep segment offset below which to keep heap chunks
+ */
+static void reedkiln_log_trim(struct reedkiln_logseg* seg, size_t keep) {
+  unsigned int k;
+  for (k = 0u; k < Reedkiln_LogChunks; ++k) {
+    /* a map length of all ones marks the worker's own array */
+    if (seg->chunk[k] == NULL || seg->chunk_map_len[k] == ((size_t)-1))
+      continue;
+    else if (seg->chunk_map[k] == NULL && reedkiln_log_chunk_start(k) < keep)
+      continue;
+#if defined(Reedkiln_Spill)
+    if (seg->chunk_map[k] != NULL)
+      munmap(seg->chunk_map[k], seg->chunk_map_len[k]);
+    else
+#endif /*Reedkiln_Spill*/
+    free(seg->chunk[k]);
+    seg->chunk[k] = NULL;
+    seg->chunk_map[k] = NULL;
+    seg->chunk_map_len[k] = 0u;
+  }
+  return;
+}
+
+void reedkiln_log_reset(struct reedkiln_worker* w) {
+  struct reedkiln_logbuf* const ptr = &w->log;
+  unsigned int i;
+  ptr->conf = reedkiln_logconf_default;
+  /* the first chunk of the first segment is the worker's own array */
+  ptr->seg[0].chunk[0] = ptr->data;
+  ptr->seg[0].chunk_map_len[0] = (size_t)-1;
+  /* keep the heap chunks below the spill threshold for the next test */
+  for (i = 0u; i < Reedkiln_LogSegments; ++i) {
+    ptr->seg[i].len = 0u;
+    reedkiln_log_trim(ptr->seg+i, ptr->conf.spill);
+  }
+#if defined(Reedkiln_Spill)
+  if (ptr->spill_file != NULL && ptr->spill_len > 0u) {
+    if (ftruncate(fileno(ptr->spill_file), 0) == 0)
+      ptr->spill_len = 0u;
+  }
+#endif /*Reedkiln_Spill*/
+  Reedkiln_Atomic_Put(&ptr->seg_count, 0u);
+  Reedkiln_Atomic_Put(&ptr->pos, 0u);
+  Reedkiln_Atomic_Add(&ptr->generation, 1u);
+  return;
+}
+
+/**
+ * @brief Release a worker's log storage.
+ * @param w the worker
+ */
+void reedkiln_log_free(struct reedkiln_worker* w) {
+  struct reedkiln_logbuf* const ptr = &w->log;
+  unsigned int i;
+  for (i = 0u; i < Reedkiln_LogSegments; ++i)
+    reedkiln_log_trim(ptr->seg+i, 0u);
+  if (ptr->spill_file != NULL) {
+    fclose(ptr->spill_file);
+    ptr->spill_file = NULL;
+    ptr->spill_len = 0u;
+  }
+  return;
+}
+
+size_t reedkiln_log_chunk_start(unsigned int k) {
+  return (size_t)Reedkiln_LogSize * ((((size_t)1u)<<k) - 1u);
+}
+
+unsigned int reedkiln_log_chunk_index(size_t pos) {
+  unsigned int k = 0u;
+  size_t v = pos/Reedkiln_LogSize + 1u;
+  while (v > 1u) {
+    v >>= 1;
+    k += 1u;
+  }
+  return k;
+}
+
+/**
+ * @brief Get the storage for a log chunk, allocating if needed.
+ * @param ptr log arena
+ * @param seg segment that owns the chunk
+ * @param k chunk index
+ * @return the chunk, or NULL if no storage is available
+ */
+unsigned char* reedkiln_log_chunk
+  (struct reedkiln_logbuf* ptr, struct reedkiln_logseg* seg, unsigned int k)
+{
+  size_t const size = ((size_t)Reedkiln_LogSize)<<k;
+  if (seg->chunk[k] != NULL)
+    return seg->chunk[k];
+  else if (Reedkiln_Atomic_Get(&ptr->pos) < ptr->conf.spill)
+    seg->chunk[k] = (unsigned char*)malloc(size);
+#if defined(Reedkiln_Spill)
+  else {
+    /* map a fresh page-aligned range of the temporary file */
+    long const page = sysconf(_SC_PAGESIZE);
+    size_t const align = (page > 0) ? (size_t)page : 1u;
+    while (Reedkiln_Atomic_Xchg(&ptr->spill_lock, 1u) != 0u)
+      continue;
+    if (ptr->spill_file == NULL)
+      ptr->spill_file = tmpfile();
+    if (ptr->spill_file != NULL) {
+      int const fd = fileno(ptr->spill_file);
+      size_t const start = (ptr->spill_len + align-1u) / align * align;
+      if (ftruncate(fd, (off_t)(start+size)) == 0) {
+        void* const map = mmap(NULL, size, PROT_READ|PROT_WRITE,
+          MAP_SHARED, fd, (off_t)start);
+        ptr->spill_len = start+size;
+        if (map != MAP_FAILED) {
+          seg->chunk_map[k] = map;
+          seg->chunk_map_len[k] = size;
+          seg->chunk[k] = (unsigned char*)map;
+        }
+      }
+    }
+    Reedkiln_Atomic_Put(&ptr->spill_lock, 0u);
+  }
+#endif /*Reedkiln_Spill*/
+  return seg->chunk[k];
+}
+
+/**
+ * @brief Append bytes to a log segment.
+ * @param ptr log arena
+ * @param seg the segment
+ * @param s bytes to copy
+ * @param n number of bytes to copy
+ * @return zero on success, nonzero if storage ran out
+ */
+int reedkiln_log_put
+  ( struct reedkiln_logbuf* ptr, struct reedkiln_logseg* seg,
+    void const* s, size_t n)
+{
+  unsigned char const* src = (unsigned char const*)s;
+  while (n > 0u) {
+    unsigned int const k = reedkiln_log_chunk_index(seg->len);
+    size_t const offset = seg->len - reedkiln_log_chunk_start(k);
+    size_t const room = (((size_t)Reedkiln_LogSize)<<k) - offset;
+    size_t const part = (room < n) ? room : n;
+    unsigned char* chunk;
+    if (k >= Reedkiln_LogChunks)
+      return 1;
+    chunk = reedkiln_log_chunk(ptr, seg, k);
+    if (chunk == NULL)
+      return 1;
+    memcpy(chunk+offset, src, part);
+    src += part;
+    seg->len += part;
+    n -= part;
+  }
+  return 0;
+}
+
+/**
+ * @brief Visit bytes of a log segment, one chunk at a time.
+ * @param seg the segment
+ * @param pos segment offset of the first byte
+ * @param n number of bytes
+ * @param[out] out buffer to receive the bytes, or NULL
+ * @param[out] t text to receive the escaped bytes, if `out` is NULL
+ * @param was_digit escape state
+ */
+static void reedkiln_log_get
+  ( struct reedkiln_logseg const* seg, size_t pos, size_t n,
+    void* out, struct reedkiln_text* t, int* was_digit)
+{
+  unsigned char* dst = (unsigned char*)out;
+  while (n > 0u) {
+    unsigned int const k = reedkiln_log_chunk_index(pos);
+    size_t const offset = pos - reedkiln_log_chunk_start(k);
+    size_t const room = (((size_t)Reedkiln_LogSize)<<k) - offset;
+    size_t const part = (room < n) ? room : n;
+    if (dst != NULL) {
+      memcpy(dst, seg->chunk[k]+offset, part);
+      dst += part;
+    } else if (was_digit == NULL) {
+      reedkiln_out_write(t, seg->chunk[k]+offset, part);
+    } else reedkiln_log_escape(seg->chunk[k]+offset, part, t, was_digit);
+    pos += part;
+    n -= part;
+  }
+  return;
+}
+
+/**
+ * @brief Escape the records of all log segments in timestamp order.
+ * @param ptr log arena
+ * @param[out] t text to receive the message
+ * @param raw_tf nonzero to copy the records without escaping
+ */
+static void reedkiln_log_merge
+  (struct reedkiln_logbuf const* ptr, struct reedkiln_text* t, int raw_tf)
+{
+  unsigned int const count = Reedkiln_Atomic_Get(&ptr->seg_count);
+  unsigned int const segs =
+    (count < Reedkiln_LogSegments) ? count : Reedkiln_LogSegments;
+  size_t cursor[Reedkiln_LogSegments] = {0};
+  int was_digit = 0;
+  for (;;) {
+    struct reedkiln_logrec best_rec = {0};
+    unsigned int best = segs;
+    unsigned int i;
+    for (i = 0u; i < segs; ++i) {
+      struct reedkiln_logrec rec;
+      if (cursor[i] >= ptr->seg[i].len)
+        continue;
+      reedkiln_log_get(ptr->seg+i, cursor[i], sizeof(rec), &rec, NULL, NULL);
+      if (best == segs || rec.stamp < best_rec.stamp) {
+        best = i;
+        best_rec = rec;
+      }
+    }
+    if (best == segs)
+      break;
+    cursor[best] += sizeof(best_rec);
+    reedkiln_log_get(ptr->seg+best, cursor[best], best_rec.len,
+      NULL, t, raw_tf ? NULL : &was_digit);
+    cursor[best] += best_rec.len;
+  }
+  return;
+}
+
+/**
+ * @brief Store a record in the calling thread's log segment.
+ * @param ptr log arena
+ * @param data bytes to store
+ * @param n number of bytes, already claimed from the log capacity
+ */
+static void reedkiln_log_record
+  (struct reedkiln_logbuf* ptr, void const* data, size_t n)
+{
+  struct reedkiln_logtls* const tls = &reedkiln_log_tls;
+  unsigned int const generation = Reedkiln_Atomic_Get(&ptr->generation);
+  struct reedkiln_logseg* seg;
+  struct reedkiln_logrec rec;
+  size_t undo;
+  int shared_tf;
+  if (tls->log != ptr || tls->generation != generation) {
+    /* first write from this thread during this test */
+    unsigned int const slot = Reedkiln_Atomic_Add(&ptr->seg_count, 1u);
+    tls->log = ptr;
+    tls->generation = generation;
+    tls->slot = (slot < Reedkiln_LogSegments)
+      ? slot : Reedkiln_LogSegments-1u;
+  }
+  /* threads past the segment limit share the last segment */
+  shared_tf = (tls->slot == Reedkiln_LogSegments-1u);
+  seg = ptr->seg + tls->slot;
+  if (shared_tf) {
+    while (Reedkiln_Atomic_Xchg(&seg->lock, 1u) != 0u)
+      continue;
+  }
+  rec.stamp = reedkiln_clock_ns();
+  rec.len = n;
+  undo = seg->len;
+  if (reedkiln_log_put(ptr, seg, &rec, sizeof(rec)) != 0
+  ||  reedkiln_log_put(ptr, seg, data, n) != 0)
+  {
+    seg->len = undo;
+  }
+  if (shared_tf)
+    Reedkiln_Atomic_Put(&seg->lock, 0u);
+  return;
+}
+
+void reedkiln_yaml_render
+  ( struct reedkiln_run const* run, struct reedkiln_worker* w,
+    struct reedkiln_outcome const* result, struct reedkiln_text* t)
+{
+  unsigned int const log_pos = Reedkiln_Atomic_Get(&w->log.pos);
+  int const failed_tf =
+    (result->res != Reedkiln_OK && result->res != Reedkiln_IGNORE);
+  int const allocs_tf = run->allocs_tf
+    && Reedkiln_Atomic_Get(&reedkiln_alloc_hooked);
+  int const perf_tf = run->perf_tf && result->perf.mask != 0u;
+  if (log_pos == 0 && w->bench.samples == 0u && !run->timing_tf
+  &&  !failed_tf && !allocs_tf && !perf_tf)
+  {
+    return;
+  }
+  reedkiln_out_puts(t, "  ---\n");
+  /* seed for replaying this test alone */{
+    char buf[Reedkiln_ItoXMax+8];
+    sprintf(buf, "  seed: %#x\n", result->seed);
+    reedkiln_out_puts(t, buf);
+  }
+  if (log_pos > 0) {
+    reedkiln_out_puts(t, "  message: \"");
+    reedkiln_log_merge(&w->log, t, 0);
+    reedkiln_out_puts(t, "\"\n");
+  }
+  if (run->timing_tf)
+    reedkiln_timing_render(&result->timing, t);
+  if (allocs_tf)
+    reedkiln_alloc_render(&result->allocs, t);
+  if (perf_tf)
+    reedkiln_perf_render(&result->perf, t);
+  if (w->bench.samples > 0u)
+    reedkiln_bench_render(&w->bench, t);
+  reedkiln_out_puts(t, "  ...\n");
+  return;
+}
+
+unsigned int reedkiln_log_nextpos
+  (struct reedkiln_logbuf* ptr, reedkiln_size n)
+{
+  unsigned int const capacity = ptr->conf.capacity;
+  unsigned int in;
+  if (Reedkiln_Atomic_Get(&ptr->pos) >= capacity)
+    return UINT_MAX;
+  in = Reedkiln_Atomic_Add(&ptr->pos,
+    (n > capacity) ? capacity : (unsigned int)n);
+  return (in < capacity) ? in : UINT_MAX;
+}
+
+reedkiln_size reedkiln_log_write(void const* buffer, reedkiln_size count) {
+  struct reedkiln_worker* const w = reedkiln_worker_get();
+  struct reedkiln_logbuf* const ptr = &w->log;
+  unsigned int src;
+  reedkiln_timeout_check(w);
+  if (w->quiet_tf)
+    return 0;
+  src = reedkiln_log_nextpos(ptr, count);
+  if (src == UINT_MAX)
+    return 0;
+  /* write (possibly truncated) content to log buffer */{
+    unsigned int const capacity = ptr->conf.capacity;
+    size_t const put_length =
+      (size_t)((capacity - src < count) ? capacity - src : count);
+    reedkiln_log_record(ptr, buffer, put_length);
+    return put_length;
+  }
+}
+
+reedkiln_size reedkiln_log_printf(char const* format, ...) {
+  unsigned int count;
+  struct reedkiln_logbuf* const ptr = &reedkiln_worker_get()->log;
+  unsigned int src;
+  reedkiln_timeout_check(reedkiln_worker_get());
+  if (reedkiln_worker_get()->quiet_tf)
+    return 0;
+  /* calculate size */{
+    va_list ap;
+    int len;
+    va_start(ap, format);
+    len = reedkiln_log_vsnprintf(NULL, 0, format, ap);
+    va_end(ap);
+    if (len == -1)
+      return 0;
+    count = len+1u;
+  }
+  /* allocate buffer */{
+    src = reedkiln_log_nextpos(ptr, count);
+    if (src == UINT_MAX)
+      return 0;
+  }
+  /* write (possibly truncated) content to log buffer */{
+    unsigned int const capacity = ptr->conf.capacity;
+    size_t const put_length = (size_t)((capacity - src < count)
+       ? capacity - src : count);
+    unsigned char small[Reedkiln_LogSize];
+    unsigned char* const tmp = (put_length <= sizeof(small))
+      ? small : (unsigned char*)malloc(put_length);
+    va_list ap;
+    if (tmp == NULL)
+      return 0;
+    va_start(ap, format);
+    (void)reedkiln_log_vsnprintf(tmp, put_length, format, ap);
+    va_end(ap);
+    reedkiln_log_record(ptr, tmp, put_length);
+    if (tmp != small)
+      free(tmp);
+    return (unsigned int)put_length;
+  }
+}
+
+struct reedkiln_log_attr reedkiln_log_adjust_type(char const** p) {
+  struct reedkiln_log_attr value = {Reedkiln_Bias};
+  /* skip over the initial % */
   (*p) += 1;
   /* skip flags */
   for (; **p && memchr("0-+ #",**p,5); (*p) += 1)
@@ -737,41 +2336,141 @@ int reedkiln_log_vsnprintf
   return (count >= INT_MAX) ? -1 : (int)count;
 }
 
-void reedkiln_log_escape(unsigned char const* data, size_t n, FILE* f) {
-  size_t i;
-  int was_digit = 0;
-  for (i = 0; i < n; ++i) {
-    unsigned char const ch = data[i];
-    int const previous_digit = was_digit;
-    if (!ch)
+/**
+ * @brief Escape class of each byte in a log message.
+ * @note Zero for bytes copied as is, one for bytes skipped, two for
+ *   hexadecimal escapes, or the second character of a short escape.
+ */
+static unsigned char const reedkiln_log_class[256] = {
+  /* 0x00 */   1,   2,   2,   2,   2,   2,   2, 'a',
+  /* 0x08 */ 'b', 't', 'n', 'v', 'f',   2,   2,   2,
+  /* 0x10 */   2,   2,   2,   2,   2,   2,   2,   2,
+  /* 0x18 */   2,   2,   2,   2,   2,   2,   2,   2,
+  /* 0x20 */   0,   0, '"',   0,   0,   0,   0,   0,
+  /* 0x28 */   0,   0,   0,   0,   0,   0,   0,   0,
+  /* 0x30 */   0,   0,   0,   0,   0,   0,   0,   0,
+  /* 0x38 */   0,   0,   0,   0,   0,   0,   0,   0,
+  /* 0x40 */   0,   0,   0,   0,   0,   0,   0,   0,
+  /* 0x48 */   0,   0,   0,   0,   0,   0,   0,   0,
+  /* 0x50 */   0,   0,   0,   0,   0,   0,   0,   0,
+  /* 0x58 */   0,   0,   0,   0,   0,   0,   0,   0,
+  /* 0x60 */   0,   0,   0,   0,   0,   0,   0,   0,
+  /* 0x68 */   0,   0,   0,   0,   0,   0,   0,   0,
+  /* 0x70 */   0,   0,   0,   0,   0,   0,   0,   0,
+  /* 0x78 */   0,   0,   0,   0,   0,   0,   0,   2,
+  /* 0x80 */   2,   2,   2,   2,   2,   2,   2,   2,
+  /* 0x88 */   2,   2,   2,   2,   2,   2,   2,   2,
+  /* 0x90 */   2,   2,   2,   2,   2,   2,   2,   2,
+  /* 0x98 */   2,   2,   2,   2,   2,   2,   2,   2,
+  /* 0xa0 */   2,   2,   2,   2,   2,   2,   2,   2,
+  /* 0xa8 */   2,   2,   2,   2,   2,   2,   2,   2,
+  /* 0xb0 */   2,   2,   2,   2,   2,   2,   2,   2,
+  /* 0xb8 */   2,   2,   2,   2,   2,   2,   2,   2,
+  /* 0xc0 */   2,   2,   2,   2,   2,   2,   2,   2,
+  /* 0xc8 */   2,   2,   2,   2,   2,   2,   2,   2,
+  /* 0xd0 */   2,   2,   2,   2,   2,   2,   2,   2,
+  /* 0xd8 */   2,   2,   2,   2,   2,   2,   2,   2,
+  /* 0xe0 */   2,   2,   2,   2,   2,   2,   2,   2,
+  /* 0xe8 */   2,   2,   2,   2,   2,   2,   2,   2,
+  /* 0xf0 */   2,   2,   2,   2,   2,   2,   2,   2,
+  /* 0xf8 */   2,   2,   2,   2,   2,   2,   2,   2
+};
+
+/**
+ * @brief Count the bytes at the start of a buffer that need no escape.
+ * @param data bytes to scan
+ * @param n number of bytes
+ * @return the length of the run of plain bytes
+ */
+size_t reedkiln_log_plain_run(unsigned char const* data, size_t n) {
+  size_t i = 0u;
+#if defined(Reedkiln_SSE2)
+  __m128i const low = _mm_set1_epi8(0x20);
+  __m128i const del = _mm_set1_epi8(0x7f);
+  __m128i const quote = _mm_set1_epi8('"');
+  for (; i+16u <= n; i += 16u) {
+    __m128i const v = _mm_loadu_si128((__m128i const*)(data+i));
+    /* signed compare flags both control bytes and bytes past 0x7f */
+    __m128i const odd = _mm_or_si128(_mm_cmplt_epi8(v, low),
+      _mm_or_si128(_mm_cmpeq_epi8(v, del), _mm_cmpeq_epi8(v, quote)));
+    int const mask = _mm_movemask_epi8(odd);
+    if (mask != 0) {
+      unsigned int j = 0u;
+      while (!(mask & (1<<j)))
+        j += 1u;
+      return i+j;
+    }
+  }
+#endif /*Reedkiln_SSE2*/
+  for (; i < n && reedkiln_log_class[data[i]] == 0u; ++i)
+    continue;
+  return i;
+}
+
+void reedkiln_log_escape
+  ( unsigned char const* data, size_t n, struct reedkiln_text* t,
+    int* was_digit_ptr)
+{
+  static char const xdigits[] = "0123456789abcdef";
+  unsigned char stage[256];
+  size_t staged = 0u;
+  size_t i = 0u;
+  int was_digit = *was_digit_ptr;
+  while (i < n) {
+    size_t const run = reedkiln_log_plain_run(data+i, n-i);
+    if (run > 0u) {
+      size_t skip = 0u;
+      /* keep hex digits from extending the previous escape */
+      for (; was_digit && skip < run && isxdigit(data[i+skip]); ++skip) {
+        unsigned char const ch = data[i+skip];
+        if (staged+4u > sizeof(stage)) {
+          reedkiln_out_write(t, stage, staged);
+          staged = 0u;
+        }
+        stage[staged++] = '\\';
+        stage[staged++] = 'x';
+        stage[staged++] = xdigits[(ch>>4)&15u];
+        stage[staged++] = xdigits[ch&15u];
+      }
+      if (run-skip > sizeof(stage)-staged) {
+        /* hand long runs to the output directly */
+        reedkiln_out_write(t, stage, staged);
+        staged = 0u;
+        reedkiln_out_write(t, data+i+skip, run-skip);
+      } else {
+        memcpy(stage+staged, data+i+skip, run-skip);
+        staged += run-skip;
+      }
+      i += run;
+      if (run > skip)
+        was_digit = 0;
       continue;
-    was_digit = 0;
-    if (ch == '"')
-      fputs("\\\"", f);
-    else if (previous_digit && isxdigit(ch)) {
-      fprintf(f, "\\x%02x", ch&255u);
-      was_digit = 1;
-    } else if (isgraph(ch))
-      fputc(ch, f);
-    else switch (ch) {
-    case ' ':
-      fputc(' ', f); break;
-    case '\n':
-      fputs("\\n", f); break;
-    case '\t':
-      fputs("\\t", f); break;
-    case '\b':
-      fputs("\\b", f); break;
-    case '\f':
-      fputs("\\f", f); break;
-    case '\v':
-      fputs("\\v", f); break;
-    case '\a':
-      fputs("\\a", f); break;
-    default:
-      fprintf(f, "\\x%02x", ch&255u); was_digit = 1; break;
+    }
+    /* escape one byte */{
+      unsigned char const ch = data[i++];
+      unsigned char const cls = reedkiln_log_class[ch];
+      if (cls == 1u)
+        continue;
+      if (staged+4u > sizeof(stage)) {
+        reedkiln_out_write(t, stage, staged);
+        staged = 0u;
+      }
+      stage[staged++] = '\\';
+      if (cls == 2u) {
+        stage[staged++] = 'x';
+        stage[staged++] = xdigits[(ch>>4)&15u];
+        stage[staged++] = xdigits[ch&15u];
+        was_digit = 1;
+      } else {
+        stage[staged++] = cls;
+        was_digit = 0;
+      }
     }
   }
+  if (staged > 0u)
+    reedkiln_out_write(t, stage, staged);
+  *was_digit_ptr = was_digit;
+  return;
 }
 /* END   log buffer */
 
@@ -793,7 +2492,7 @@ void reedkiln_failfast(void) {
   if (reedkiln_next_jmp.active) {
     longjmp(reedkiln_next_jmp.buf, 1);
   } else {
-    reedkiln_next_status = Reedkiln_NOT_OK;
+    Reedkiln_Atomic_Put(&reedkiln_worker_get()->next_status, Reedkiln_NOT_OK);
     abort();
   }
 }
@@ -827,133 +2526,4669 @@ int reedkiln_prefix_match(char const* name, char const* prefix) {
   return *prefix_p == '\0';
 }
 
-void reedkiln_set_vtable(struct reedkiln_vtable const* vt) {
-  reedkiln_vtable_c = *vt;
-  return;
+/* BEGIN selection */
+int reedkiln_glob_match(char const* name, char const* glob) {
+  char const* star = NULL;
+  char const* resume = NULL;
+  while (*name != '\0') {
+    if (*glob == '*') {
+      star = glob++;
+      resume = name;
+    } else if (*glob == '?' || (*glob != '\0' && *glob == *name)) {
+      ++glob;
+      ++name;
+    } else if (star != NULL) {
+      /* let the last star take one more character */
+      glob = star+1;
+      name = ++resume;
+    } else return 0;
+  }
+  while (*glob == '*')
+    ++glob;
+  return *glob == '\0';
 }
 
-int reedkiln_main
-    (struct reedkiln_entry const* t, int argc, char **argv, void* p)
+int reedkiln_pattern_match
+  (char const* name, struct reedkiln_pattern const* pat)
 {
-  size_t const test_count = reedkiln_entry_count(t);
-  size_t test_i;
-  int total_res = EXIT_SUCCESS;
-  char const* testname_prefix = "";
-  unsigned int rand_seed = reedkiln_default_seed();
-  struct reedkiln_vtable const initial_table = reedkiln_vtable_c;
-  reedkiln_next_status = Reedkiln_OK;
-  reedkiln_bail_status = Reedkiln_OK;
-  /* inspect args */{
-    int argi;
-    int help_tf = 0;
-    for (argi = 1; argi < argc; ++argi) {
-      if (argv[argi][0] == '-') {
-        if (strcmp(argv[argi], "-?") == 0
-        ||  strcmp(argv[argi], "-h") == 0)
-        {
-          help_tf = 1;
-          break;
-        } else if (strcmp(argv[argi], "-l") == 0) {
-          help_tf = 2;
-        } else if (strcmp(argv[argi], "-s") == 0) {
-          if (++argi >= argc) {
-            fputs("option \"-s\" requires a number\n", stderr);
-            help_tf = 1;
-          } else {
-            rand_seed = (unsigned int)strtoul(argv[argi], NULL, 0);
-          }
-        } else {
-          fprintf(stderr,"unknown option \"%s\"\n", argv[argi]);
-          help_tf = 1;
+  return pat->prefix_tf
+    ? reedkiln_prefix_match(name, pat->text)
+    : reedkiln_glob_match(name, pat->text);
+}
+
+int reedkiln_name_cmp(void const* a, void const* b) {
+  struct reedkiln_entry const* const* const x =
+    (struct reedkiln_entry const* const*)a;
+  struct reedkiln_entry const* const* const y =
+    (struct reedkiln_entry const* const*)b;
+  int const cmp = strcmp((*x)->name, (*y)->name);
+  if (cmp != 0)
+    return cmp;
+  else return (*x < *y) ? -1 : (*x > *y);
+}
+
+int reedkiln_index_cmp(void const* a, void const* b) {
+  struct reedkiln_entry const* const* const x =
+    (struct reedkiln_entry const* const*)a;
+  struct reedkiln_entry const* const* const y =
+    (struct reedkiln_entry const* const*)b;
+  return (*x < *y) ? -1 : (*x > *y);
+}
+
+/**
+ * @brief Find the first name in the index not before a prefix.
+ * @param index entries sorted by name
+ * @param n number of entries in the index
+ * @param prefix start of the names to find
+ * @param prefix_len length of the prefix
+ * @return an index position
+ */
+size_t reedkiln_name_lower_bound
+  ( struct reedkiln_entry const* const* index, size_t n,
+    char const* prefix, size_t prefix_len)
+{
+  size_t lo = 0u, hi = n;
+  while (lo < hi) {
+    size_t const mid = lo + (hi-lo)/2u;
+    if (strncmp(index[mid]->name, prefix, prefix_len) < 0)
+      lo = mid+1u;
+    else hi = mid;
+  }
+  return lo;
+}
+
+/**
+ * @brief Select tests by name.
+ * @param t array of tests
+ * @param n number of tests
+ * @param filter patterns to include and exclude
+ * @param[out] out_count number of tests selected
+ * @return a new array of the selected tests in their original order,
+ *   ending with a null entry, or NULL on allocation failure
+ * @note Each include pattern visits only the names that share its
+ *   literal prefix, found by binary search in a sorted name index.
+ */
+struct reedkiln_entry* reedkiln_select
+  ( struct reedkiln_entry const* t, size_t n,
+    struct reedkiln_filter const* filter, size_t* out_count)
+{
+  struct reedkiln_entry const** index;
+  struct reedkiln_entry const** chosen;
+  unsigned char* mark;
+  struct reedkiln_entry* out = NULL;
+  size_t count = 0u;
+  size_t i;
+  chosen = (struct reedkiln_entry const**)malloc
+    ((n ? n : 1u)*sizeof(struct reedkiln_entry const*));
+  if (chosen == NULL)
+    return NULL;
+  if (filter->include_count == 0u) {
+    for (i = 0u; i < n; ++i)
+      chosen[count++] = t+i;
+  } else {
+    index = (struct reedkiln_entry const**)malloc
+      ((n ? n : 1u)*sizeof(struct reedkiln_entry const*));
+    mark = (unsigned char*)calloc(n ? n : 1u, 1u);
+    if (index == NULL || mark == NULL) {
+      free(mark);
+      free(index);
+      free(chosen);
+      return NULL;
+    }
+    for (i = 0u; i < n; ++i)
+      index[i] = t+i;
+    qsort(index, n, sizeof(*index), &reedkiln_name_cmp);
+    for (i = 0u; i < filter->include_count; ++i) {
+      struct reedkiln_pattern const* const pat = filter->include+i;
+      size_t const prefix_len = pat->prefix_tf
+        ? strlen(pat->text) : strcspn(pat->text, "*?");
+      size_t pos = reedkiln_name_lower_bound
+        (index, n, pat->text, prefix_len);
+      for (; pos < n; ++pos) {
+        size_t const test_i = (size_t)(index[pos]-t);
+        if (strncmp(index[pos]->name, pat->text, prefix_len) != 0)
           break;
+        else if (!mark[test_i]
+        &&  reedkiln_pattern_match(index[pos]->name, pat))
+        {
+          mark[test_i] = 1u;
+          chosen[count++] = index[pos];
         }
-      } else {
-        testname_prefix = argv[argi];
       }
     }
-    if (help_tf) {
-      if (help_tf == 2) {
-        size_t i;
-        for (i = 0u; i < test_count; ++i) {
-          fprintf(stderr, "%s\n", t[i].name);
-        }
-      } else {
-        fputs("usage: %s [option [option ...]] [(prefix)]\n\n"
-          "options:\n"
-          "  -?, -h      print a help message\n"
-          "  -l          list all test names\n"
-          "  -s (seed)   set the random seed\n\n"
-          "parameters:\n"
-          "  (prefix)    run tests whose names start with this prefix\n",
-          stderr);
+    /* restore the order given */
+    qsort(chosen, count, sizeof(*chosen), &reedkiln_index_cmp);
+    free(mark);
+    free(index);
+  }
+  out = (struct reedkiln_entry*)malloc
+    ((count+1u)*sizeof(struct reedkiln_entry));
+  if (out != NULL) {
+    size_t kept = 0u;
+    for (i = 0u; i < count; ++i) {
+      size_t j;
+      for (j = 0u; j < filter->exclude_count; ++j) {
+        if (reedkiln_pattern_match(chosen[i]->name, filter->exclude+j))
+          break;
+      }
+      if (j == filter->exclude_count)
+        out[kept++] = *chosen[i];
+    }
+    memset(out+kept, 0, sizeof(struct reedkiln_entry));
+    *out_count = kept;
+  }
+  free(chosen);
+  return out;
+}
+/* END   selection */
+
+/* BEGIN sharding */
+int reedkiln_duration_cmp(void const* a, void const* b) {
+  struct reedkiln_duration const* const x = (struct reedkiln_duration const*)a;
+  struct reedkiln_duration const* const y = (struct reedkiln_duration const*)b;
+  int const cmp = strcmp(x->name, y->name);
+  if (cmp != 0)
+    return cmp;
+  /* keep later lines after earlier ones */
+  else return (x < y) ? -1 : (x > y);
+}
+
+/**
+ * @brief Load recorded wall times.
+ * @param[out] d durations to fill
+ * @param path file with one "(ms) (name)" line per test
+ * @return zero on success or if the file does not exist,
+ *   nonzero on allocation failure
+ * @note Later lines for the same name replace earlier ones, so the
+ *   files from several shards can be concatenated.
+ */
+int reedkiln_durations_load(struct reedkiln_durations* d, char const* path) {
+  char line[1024];
+  FILE* const f = fopen(path, "rb");
+  int res = 0;
+  if (f == NULL)
+    return 0;
+  while (fgets(line, sizeof(line), f) != NULL) {
+    char* end;
+    size_t len = strlen(line);
+    double const ms = strtod(line, &end);
+    if (len > 0u && line[len-1u] == '\n')
+      line[--len] = '\0';
+    else if (!feof(f)) {
+      /* skip the rest of a line too long to hold a name */
+      int ch;
+      while ((ch = fgetc(f)) != EOF && ch != '\n')
+        continue;
+      continue;
+    }
+    if (end == line || *end != ' ' || !(ms >= 0.0))
+      continue;
+    ++end;
+    if (d->count >= d->cap) {
+      size_t const new_cap = d->cap ? d->cap*2u : 64u;
+      struct reedkiln_duration* const new_rec =
+        (struct reedkiln_duration*)realloc
+          (d->rec, new_cap*sizeof(struct reedkiln_duration));
+      if (new_rec == NULL) {
+        res = -1;
+        break;
+      }
+      d->rec = new_rec;
+      d->cap = new_cap;
+    }
+    d->rec[d->count].name = (char*)malloc(strlen(end)+1u);
+    if (d->rec[d->count].name == NULL) {
+      res = -1;
+      break;
+    }
+    strcpy(d->rec[d->count].name, end);
+    d->rec[d->count].ms = ms;
+    d->count += 1u;
+  }
+  fclose(f);
+  if (d->count > 0u) {
+    size_t i, kept = 0u;
+    qsort(d->rec, d->count, sizeof(*d->rec), &reedkiln_duration_cmp);
+    for (i = 0u; i < d->count; ++i) {
+      if (i+1u < d->count && strcmp(d->rec[i].name, d->rec[i+1u].name) == 0)
+        free(d->rec[i].name);
+      else d->rec[kept++] = d->rec[i];
+    }
+    d->count = kept;
+  }
+  return res;
+}
+
+struct reedkiln_duration* reedkiln_durations_find
+  (struct reedkiln_durations const* d, char const* name)
+{
+  size_t lo = 0u, hi = d->count;
+  while (lo < hi) {
+    size_t const mid = lo + (hi-lo)/2u;
+    int const cmp = strcmp(d->rec[mid].name, name);
+    if (cmp == 0)
+      return d->rec+mid;
+    else if (cmp < 0)
+      lo = mid+1u;
+    else hi = mid;
+  }
+  return NULL;
+}
+
+/**
+ * @brief Save recorded wall times, updated with this run's tests.
+ * @param d durations from before the run
+ * @param run test run with measured durations
+ * @param path file to write
+ * @return zero on success, nonzero otherwise
+ */
+int reedkiln_durations_save
+  ( struct reedkiln_durations* d, struct reedkiln_run const* run,
+    char const* path)
+{
+  size_t i;
+  FILE* f;
+  int res = 0;
+  f = fopen(path, "wb");
+  if (f == NULL)
+    return -1;
+  for (i = 0u; i < run->test_count; ++i) {
+    struct reedkiln_duration* const rec = (run->durations[i] >= 0.0)
+      ? reedkiln_durations_find(d, run->t[i].name) : NULL;
+    /* mark records that this run replaces */
+    if (rec != NULL)
+      rec->ms = -1.0 - rec->ms;
+  }
+  /* untouched records first, then this run's tests */
+  for (i = 0u; i < d->count; ++i) {
+    if (d->rec[i].ms >= 0.0 && fprintf(f, "%.3f %s\n",
+          d->rec[i].ms, d->rec[i].name) < 0)
+    {
+      res = -1;
+    }
+  }
+  for (i = 0u; i < run->test_count; ++i) {
+    if (run->durations[i] >= 0.0 && fprintf(f, "%.3f %s\n",
+          run->durations[i], run->t[i].name) < 0)
+    {
+      res = -1;
+    }
+  }
+  if (fclose(f) != 0)
+    res = -1;
+  return res;
+}
+
+void reedkiln_durations_free(struct reedkiln_durations* d) {
+  size_t i;
+  for (i = 0u; i < d->count; ++i)
+    free(d->rec[i].name);
+  free(d->rec);
+  d->rec = NULL;
+  d->count = 0u;
+  d->cap = 0u;
+  return;
+}
+
+int reedkiln_shard_cmp(void const* a, void const* b) {
+  struct reedkiln_shard_item const* const x =
+    (struct reedkiln_shard_item const*)a;
+  struct reedkiln_shard_item const* const y =
+    (struct reedkiln_shard_item const*)b;
+  if (x->ms != y->ms)
+    return (x->ms > y->ms) ? -1 : 1;
+  else return (x->test_i < y->test_i) ? -1 : (x->test_i > y->test_i);
+}
+
+/**
+ * @brief Keep only one shard's tests.
+ * @param t array of tests to compact in place
+ * @param n number of tests
+ * @param index zero-based shard to keep
+ * @param count number of shards
+ * @param d recorded wall times, possibly empty
+ * @return the number of tests kept, or `(size_t)-1` on
+ *   allocation failure
+ * @note With more shards than tests, some shards keep no tests.
+ * @note With recorded times for any of the tests, each test goes to the
+ *   shard with the least total time so far, longest test first, and
+ *   tests without a record count as the mean. Otherwise, tests go by a
+ *   hash of their name. Either way, every shard computes the same split
+ *   from the same tests and records.
+ */
+size_t reedkiln_shard
+  ( struct reedkiln_entry* t, size_t n, unsigned long int index,
+    unsigned long int count, struct reedkiln_durations const* d)
+{
+  struct reedkiln_shard_item* items = NULL;
+  double* load = NULL;
+  unsigned char* keep;
+  size_t i, kept = 0u;
+  keep = (unsigned char*)calloc(n ? n : 1u, 1u);
+  if (keep == NULL)
+    return (size_t)-1;
+  if (d->count > 0u) {
+    items = (struct reedkiln_shard_item*)malloc
+      ((n ? n : 1u)*sizeof(struct reedkiln_shard_item));
+    load = (double*)calloc(count, sizeof(double));
+    if (items == NULL || load == NULL) {
+      /* falling back to the hash would split differently elsewhere */
+      free(load);
+      free(items);
+      free(keep);
+      return (size_t)-1;
+    }
+  }
+  if (items != NULL) {
+    double total = 0.0;
+    size_t known = 0u;
+    for (i = 0u; i < n; ++i) {
+      struct reedkiln_duration const* const rec =
+        reedkiln_durations_find(d, t[i].name);
+      items[i].ms = (rec != NULL) ? rec->ms : -1.0;
+      items[i].test_i = i;
+      if (rec != NULL) {
+        total += rec->ms;
+        known += 1u;
+      }
+    }
+    for (i = 0u; known > 0u && i < n; ++i) {
+      if (items[i].ms < 0.0)
+        items[i].ms = total / (double)known;
+    }
+    if (known > 0u) {
+      qsort(items, n, sizeof(*items), &reedkiln_shard_cmp);
+      for (i = 0u; i < n; ++i) {
+        unsigned long int best = 0u;
+        unsigned long int j;
+        for (j = 1u; j < count; ++j) {
+          if (load[j] < load[best])
+            best = j;
+        }
+        load[best] += items[i].ms;
+        keep[items[i].test_i] = (best == index);
+      }
+    } else d = NULL;
+  } else d = NULL;
+  free(load);
+  free(items);
+  if (d == NULL) {
+    for (i = 0u; i < n; ++i)
+      keep[i] = (reedkiln_name_hash(t[i].name) % count == index);
+  }
+  for (i = 0u; i < n; ++i) {
+    if (keep[i])
+      t[kept++] = t[i];
+  }
+  memset(t+kept, 0, sizeof(struct reedkiln_entry));
+  free(keep);
+  return kept;
+}
+/* END   sharding */
+
+/* BEGIN result cache */
+/**
+ * @brief Compute the cache fingerprint.
+ * @param[out] c cache to update
+ * @param text user fingerprint, or NULL to hash the file instead
+ * @param path test binary
+ * @return zero on success, nonzero if the binary cannot be read
+ */
+int reedkiln_cache_fingerprint
+  (struct reedkiln_cache* c, char const* text, char const* path)
+{
+  /* FNV-1a alongside a multiplicative hash, plus the length */
+  unsigned int h1 = 0x811c9dc5u;
+  unsigned int h2 = 0u;
+  unsigned long int len = 0u;
+  if (text != NULL) {
+    unsigned char const* p;
+    for (p = (unsigned char const*)text; *p != 0; ++p, ++len) {
+      h1 = (h1 ^ *p) * 0x01000193u;
+      h2 = h2*31u + *p;
+    }
+  } else {
+    unsigned char buf[4096];
+    size_t n;
+    FILE* const f = fopen(path, "rb");
+    if (f == NULL)
+      return -1;
+    while ((n = fread(buf, 1u, sizeof(buf), f)) > 0u) {
+      size_t i;
+      for (i = 0u; i < n; ++i) {
+        h1 = (h1 ^ buf[i]) * 0x01000193u;
+        h2 = h2*31u + buf[i];
+      }
+      len += (unsigned long int)n;
+    }
+    if (ferror(f)) {
+      fclose(f);
+      return -1;
+    }
+    fclose(f);
+  }
+  sprintf(c->fingerprint, "%08x%08x%06lx", h1, reedkiln_rand_mix(h2),
+    len & 0xfffffful);
+  return 0;
+}
+
+int reedkiln_cached_cmp(void const* a, void const* b) {
+  struct reedkiln_cached const* const x = (struct reedkiln_cached const*)a;
+  struct reedkiln_cached const* const y = (struct reedkiln_cached const*)b;
+  int const cmp = strcmp(x->name, y->name);
+  if (cmp != 0)
+    return cmp;
+  else return (x->seed < y->seed) ? -1 : (x->seed > y->seed);
+}
+
+/**
+ * @brief Load the passing tests recorded for this fingerprint.
+ * @param[out] c cache to fill
+ * @param path file with one "(fingerprint) (seed) (name)" line per test
+ * @return zero on success or if the file does not exist,
+ *   nonzero on allocation failure
+ */
+int reedkiln_cache_load(struct reedkiln_cache* c, char const* path) {
+  char line[1024];
+  size_t const fp_len = strlen(c->fingerprint);
+  FILE* const f = fopen(path, "rb");
+  int res = 0;
+  if (f == NULL)
+    return 0;
+  while (fgets(line, sizeof(line), f) != NULL) {
+    char* end;
+    unsigned long int seed;
+    size_t len = strlen(line);
+    if (len > 0u && line[len-1u] == '\n')
+      line[--len] = '\0';
+    else if (!feof(f)) {
+      /* skip the rest of a line too long to hold a name */
+      int ch;
+      while ((ch = fgetc(f)) != EOF && ch != '\n')
+        continue;
+      continue;
+    }
+    if (strncmp(line, c->fingerprint, fp_len) != 0 || line[fp_len] != ' ')
+      continue;
+    seed = strtoul(line+fp_len+1u, &end, 16);
+    if (*end != ' ')
+      continue;
+    ++end;
+    if (c->count >= c->cap) {
+      size_t const new_cap = c->cap ? c->cap*2u : 64u;
+      struct reedkiln_cached* const new_rec = (struct reedkiln_cached*)realloc
+        (c->rec, new_cap*sizeof(struct reedkiln_cached));
+      if (new_rec == NULL) {
+        res = -1;
+        break;
+      }
+      c->rec = new_rec;
+      c->cap = new_cap;
+    }
+    c->rec[c->count].name = (char*)malloc(strlen(end)+1u);
+    if (c->rec[c->count].name == NULL) {
+      res = -1;
+      break;
+    }
+    strcpy(c->rec[c->count].name, end);
+    c->rec[c->count].seed = (unsigned int)seed;
+    c->rec[c->count].drop_tf = 0;
+    c->count += 1u;
+  }
+  fclose(f);
+  if (c->count > 0u)
+    qsort(c->rec, c->count, sizeof(*c->rec), &reedkiln_cached_cmp);
+  return res;
+}
+
+struct reedkiln_cached* reedkiln_cache_find
+  (struct reedkiln_cache const* c, char const* name, unsigned int seed)
+{
+  struct reedkiln_cached key;
+  key.name = (char*)name;
+  key.seed = seed;
+  return (struct reedkiln_cached*)bsearch(&key, c->rec, c->count,
+    sizeof(*c->rec), &reedkiln_cached_cmp);
+}
+
+int reedkiln_cache_hit
+  (struct reedkiln_run const* run, struct reedkiln_entry const* test)
+{
+  return run->cache != NULL && run->cache->use_tf
+    && !(test->flags & (Reedkiln_TODO|Reedkiln_BENCH))
+    && reedkiln_cache_find(run->cache, test->name,
+          reedkiln_entry_seed(run, (size_t)(test - run->t))) != NULL;
+}
+
+/**
+ * @brief Record a test's result for the next run.
+ * @param run test run configuration
+ * @param test_i index of the test
+ * @param result outcome of the test
+ */
+void reedkiln_cache_note
+  ( struct reedkiln_run const* run, size_t test_i,
+    struct reedkiln_outcome const* result)
+{
+  struct reedkiln_entry const* const test = run->t+test_i;
+  if (run->cache == NULL || run->cache->state == NULL || result->skip_tf)
+    return;
+  run->cache->state[test_i] = (result->res == Reedkiln_OK
+      && !(test->flags & (Reedkiln_TODO|Reedkiln_BENCH)))
+    ? 1u : 2u;
+  return;
+}
+
+/**
+ * @brief Save the cache, updated with this run's results.
+ * @param c cache from before the run
+ * @param run test run with results noted
+ * @param path file to write
+ * @return zero on success, nonzero otherwise
+ * @note Records for other fingerprints are dropped.
+ */
+int reedkiln_cache_save
+  ( struct reedkiln_cache* c, struct reedkiln_run const* run,
+    char const* path)
+{
+  size_t i;
+  FILE* f;
+  int res = 0;
+  if (c->state == NULL)
+    return -1;
+  for (i = 0u; i < run->test_count; ++i) {
+    struct reedkiln_cached* const rec = (c->state[i] != 0u)
+      ? reedkiln_cache_find(c, run->t[i].name, reedkiln_entry_seed(run, i))
+      : NULL;
+    if (rec != NULL)
+      rec->drop_tf = 1;
+  }
+  f = fopen(path, "wb");
+  if (f == NULL)
+    return -1;
+  for (i = 0u; i < c->count; ++i) {
+    if (!c->rec[i].drop_tf && fprintf(f, "%s %x %s\n",
+          c->fingerprint, c->rec[i].seed, c->rec[i].name) < 0)
+    {
+      res = -1;
+    }
+  }
+  for (i = 0u; i < run->test_count; ++i) {
+    if (c->state[i] == 1u && fprintf(f, "%s %x %s\n", c->fingerprint,
+          reedkiln_entry_seed(run, i), run->t[i].name) < 0)
+    {
+      res = -1;
+    }
+  }
+  if (fclose(f) != 0)
+    res = -1;
+  return res;
+}
+
+void reedkiln_cache_free(struct reedkiln_cache* c) {
+  size_t i;
+  for (i = 0u; i < c->count; ++i)
+    free(c->rec[i].name);
+  free(c->rec);
+  free(c->state);
+  c->rec = NULL;
+  c->count = 0u;
+  c->cap = 0u;
+  c->state = NULL;
+  return;
+}
+/* END   result cache */
+
+/* BEGIN allocation accounting */
+/**
+ * @brief Allocation made while a test callback ran.
+ */
+struct reedkiln_alloc_rec {
+  /** @brief Block, NULL for an empty slot, or the table for a removed one. */
+  void const* ptr;
+  reedkiln_size size;
+  struct reedkiln_worker* w;
+  unsigned int serial;
+};
+
+/**
+ * @brief Open-addressed table of blocks allocated by running tests.
+ */
+struct reedkiln_alloc_table {
+  struct reedkiln_alloc_rec* rec;
+  /** @brief Number of slots, a power of two. */
+  size_t cap;
+  /** @brief Slots in use, including removed ones. */
+  size_t used;
+  size_t count;
+  /** @brief Workers counting allocations. */
+  struct reedkiln_worker* active;
+  unsigned int next_serial;
+#if defined(Reedkiln_Threads)
+  mtx_t lock;
+#endif /*Reedkiln_Threads*/
+};
+
+static struct reedkiln_alloc_table reedkiln_alloc_state;
+static Reedkiln_Atomic_tag unsigned int reedkiln_alloc_ready = 0u;
+/* set while the accounting itself allocates */
+static Reedkiln_Thread_local int reedkiln_alloc_busy = 0;
+
+void reedkiln_alloc_start(void) {
+  memset(&reedkiln_alloc_state, 0, sizeof(reedkiln_alloc_state));
+#if defined(Reedkiln_Threads)
+  if (mtx_init(&reedkiln_alloc_state.lock, mtx_plain) != thrd_success)
+    return;
+#endif /*Reedkiln_Threads*/
+  Reedkiln_Atomic_Put(&reedkiln_alloc_ready, 1u);
+  return;
+}
+
+void reedkiln_alloc_stop(void) {
+  if (!Reedkiln_Atomic_Xchg(&reedkiln_alloc_ready, 0u))
+    return;
+#if defined(Reedkiln_Threads)
+  mtx_destroy(&reedkiln_alloc_state.lock);
+#endif /*Reedkiln_Threads*/
+  free(reedkiln_alloc_state.rec);
+  reedkiln_alloc_state.rec = NULL;
+  return;
+}
+
+void reedkiln_alloc_lock(void) {
+  reedkiln_alloc_busy = 1;
+#if defined(Reedkiln_Threads)
+  mtx_lock(&reedkiln_alloc_state.lock);
+#endif /*Reedkiln_Threads*/
+  return;
+}
+
+void reedkiln_alloc_unlock(void) {
+#if defined(Reedkiln_Threads)
+  mtx_unlock(&reedkiln_alloc_state.lock);
+#endif /*Reedkiln_Threads*/
+  reedkiln_alloc_busy = 0;
+  return;
+}
+
+size_t reedkiln_alloc_slot(void const* p, size_t cap) {
+  size_t const v = (size_t)p;
+  unsigned int const h = reedkiln_rand_mix
+    ((unsigned int)(v>>4) ^ (unsigned int)((v>>16)>>16));
+  return h & (cap-1u);
+}
+
+struct reedkiln_alloc_rec* reedkiln_alloc_find(void const* p) {
+  struct reedkiln_alloc_table* const table = &reedkiln_alloc_state;
+  size_t i;
+  if (table->cap == 0u)
+    return NULL;
+  for (i = reedkiln_alloc_slot(p, table->cap); table->rec[i].ptr != NULL;
+      i = (i+1u) & (table->cap-1u))
+  {
+    if (table->rec[i].ptr == p)
+      return table->rec+i;
+  }
+  return NULL;
+}
+
+/**
+ * @brief Make room for another record.
+ * @return zero on success, nonzero on allocation failure
+ * @note Call with the table locked.
+ */
+int reedkiln_alloc_grow(void) {
+  struct reedkiln_alloc_table* const table = &reedkiln_alloc_state;
+  size_t const new_cap = (table->cap == 0u) ? 1024u
+    : (table->count*2u >= table->cap ? table->cap*2u : table->cap);
+  struct reedkiln_alloc_rec* const new_rec = (struct reedkiln_alloc_rec*)
+    calloc(new_cap, sizeof(struct reedkiln_alloc_rec));
+  size_t i;
+  if (new_rec == NULL)
+    return -1;
+  /* move the live records, dropping removed ones */
+  for (i = 0u; i < table->cap; ++i) {
+    struct reedkiln_alloc_rec const* const rec = table->rec+i;
+    size_t j;
+    if (rec->ptr == NULL || rec->ptr == (void const*)table)
+      continue;
+    for (j = reedkiln_alloc_slot(rec->ptr, new_cap); new_rec[j].ptr != NULL;
+        j = (j+1u) & (new_cap-1u))
+    {
+      continue;
+    }
+    new_rec[j] = *rec;
+  }
+  free(table->rec);
+  table->rec = new_rec;
+  table->cap = new_cap;
+  table->used = table->count;
+  return 0;
+}
+
+void reedkiln_alloc_hook_add(void* p, reedkiln_size n) {
+  struct reedkiln_alloc_table* const table = &reedkiln_alloc_state;
+  struct reedkiln_worker* w;
+  Reedkiln_Atomic_Put(&reedkiln_alloc_hooked, 1u);
+  if (!Reedkiln_Atomic_Get(&reedkiln_alloc_ready) || reedkiln_alloc_busy)
+    return;
+  w = reedkiln_worker_get();
+  if (!Reedkiln_Atomic_Get(&w->alloc_tf))
+    return;
+  reedkiln_alloc_lock();
+  if (Reedkiln_Atomic_Get(&w->alloc_tf)
+  &&  ((table->used+1u)*4u < table->cap*3u || reedkiln_alloc_grow() == 0))
+  {
+    size_t i;
+    for (i = reedkiln_alloc_slot(p, table->cap);
+        table->rec[i].ptr != NULL && table->rec[i].ptr != (void const*)table;
+        i = (i+1u) & (table->cap-1u))
+    {
+      continue;
+    }
+    if (table->rec[i].ptr == NULL)
+      table->used += 1u;
+    table->count += 1u;
+    table->rec[i].ptr = p;
+    table->rec[i].size = n;
+    table->rec[i].w = w;
+    table->rec[i].serial = w->alloc_serial;
+    w->allocs.allocs += 1u;
+    w->allocs.bytes += n;
+    w->allocs.live_bytes += n;
+    if (w->allocs.live_bytes > w->allocs.peak_bytes)
+      w->allocs.peak_bytes = w->allocs.live_bytes;
+  }
+  reedkiln_alloc_unlock();
+  return;
+}
+
+void reedkiln_alloc_hook_remove(void* p) {
+  struct reedkiln_alloc_table* const table = &reedkiln_alloc_state;
+  struct reedkiln_alloc_rec* rec;
+  if (!Reedkiln_Atomic_Get(&reedkiln_alloc_ready) || reedkiln_alloc_busy)
+    return;
+  reedkiln_alloc_lock();
+  rec = reedkiln_alloc_find(p);
+  if (rec != NULL) {
+    struct reedkiln_worker* w;
+    /* credit the test only if it is still running */
+    for (w = table->active; w != NULL; w = w->alloc_next) {
+      if (w == rec->w && w->alloc_serial == rec->serial) {
+        w->allocs.live_bytes -= rec->size;
+        break;
+      }
+    }
+    rec->ptr = table;
+    table->count -= 1u;
+  }
+  reedkiln_alloc_unlock();
+  return;
+}
+
+/**
+ * @brief Start counting allocations for a test callback.
+ * @param w worker about to run the callback
+ */
+void reedkiln_alloc_begin(struct reedkiln_worker* w) {
+  struct reedkiln_alloc_table* const table = &reedkiln_alloc_state;
+  memset(&w->allocs, 0, sizeof(w->allocs));
+  if (!Reedkiln_Atomic_Get(&reedkiln_alloc_ready))
+    return;
+  reedkiln_alloc_lock();
+  table->next_serial += 1u;
+  w->alloc_serial = table->next_serial;
+  w->alloc_next = table->active;
+  table->active = w;
+  Reedkiln_Atomic_Put(&w->alloc_tf, 1u);
+  reedkiln_alloc_unlock();
+  return;
+}
+
+/**
+ * @brief Stop counting allocations for a test callback.
+ * @param w worker that ran the callback
+ * @param[out] out final counts
+ */
+void reedkiln_alloc_end
+  (struct reedkiln_worker* w, struct reedkiln_allocs* out)
+{
+  struct reedkiln_alloc_table* const table = &reedkiln_alloc_state;
+  struct reedkiln_worker** link;
+  if (!Reedkiln_Atomic_Get(&w->alloc_tf)) {
+    *out = w->allocs;
+    return;
+  }
+  reedkiln_alloc_lock();
+  Reedkiln_Atomic_Put(&w->alloc_tf, 0u);
+  for (link = &table->active; *link != NULL; link = &(*link)->alloc_next) {
+    if (*link == w) {
+      *link = w->alloc_next;
+      break;
+    }
+  }
+  w->alloc_next = NULL;
+  *out = w->allocs;
+  reedkiln_alloc_unlock();
+  return;
+}
+
+int reedkiln_alloc_count(struct reedkiln_allocs* out) {
+  struct reedkiln_worker* const w = reedkiln_worker_get();
+  if (!Reedkiln_Atomic_Get(&reedkiln_alloc_hooked)
+  ||  !Reedkiln_Atomic_Get(&w->alloc_tf))
+  {
+    memset(out, 0, sizeof(*out));
+    return -1;
+  }
+  reedkiln_alloc_lock();
+  *out = w->allocs;
+  reedkiln_alloc_unlock();
+  return 0;
+}
+
+int reedkiln_alloc_budget(reedkiln_size allocs, reedkiln_size bytes) {
+  struct reedkiln_worker* const w = reedkiln_worker_get();
+  w->alloc_budget[0] = allocs;
+  w->alloc_budget[1] = bytes;
+  return Reedkiln_Atomic_Get(&reedkiln_alloc_hooked) ? 0 : -1;
+}
+
+/**
+ * @brief Check a test's allocations against its budget.
+ * @param w worker that ran the test
+ * @param counts allocations made by the test
+ * @return nonzero if over budget, zero otherwise
+ */
+int reedkiln_alloc_over
+  (struct reedkiln_worker* w, struct reedkiln_allocs const* counts)
+{
+  if (counts->allocs <= w->alloc_budget[0]
+  &&  counts->bytes <= w->alloc_budget[1])
+  {
+    return 0;
+  }
+  reedkiln_out_puts(w->notes, "## allocation budget exceeded: ");
+  reedkiln_out_ulong(w->notes, (unsigned long int)counts->allocs);
+  reedkiln_out_puts(w->notes, " allocation(s) of ");
+  reedkiln_out_ulong(w->notes, (unsigned long int)counts->bytes);
+  reedkiln_out_puts(w->notes, " byte(s)\n");
+  return 1;
+}
+
+void reedkiln_alloc_render
+  (struct reedkiln_allocs const* counts, struct reedkiln_text* t)
+{
+  reedkiln_out_puts(t, "  allocs: ");
+  reedkiln_out_ulong(t, (unsigned long int)counts->allocs);
+  reedkiln_out_puts(t, "\n  bytes: ");
+  reedkiln_out_ulong(t, (unsigned long int)counts->bytes);
+  reedkiln_out_puts(t, "\n  peak_bytes: ");
+  reedkiln_out_ulong(t, (unsigned long int)counts->peak_bytes);
+  reedkiln_out_puts(t, "\n  leaked_bytes: ");
+  reedkiln_out_ulong(t, (unsigned long int)counts->live_bytes);
+  reedkiln_out_puts(t, "\n");
+  return;
+}
+/* END   allocation accounting */
+
+/* BEGIN performance counters */
+/**
+ * @brief Open the hardware counters for the calling thread.
+ * @param w worker to hold the counters
+ * @return the number of counters available
+ * @note Counters that cannot be opened are left out.
+ */
+int reedkiln_perf_open(struct reedkiln_worker* w) {
+  int count = 0;
+#if defined(Reedkiln_Perf)
+  static unsigned int const types[Reedkiln_PerfCount] = {
+    PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE,
+    PERF_TYPE_HW_CACHE, PERF_TYPE_HW_CACHE
+  };
+  static unsigned long int const configs[Reedkiln_PerfCount] = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_BRANCH_MISSES,
+    PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+      | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+    PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+      | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)
+  };
+  long int const pid = (long int)getpid();
+  int i;
+  if (w->perf_pid == pid) {
+    for (i = 0; i < Reedkiln_PerfCount; ++i)
+      count += (w->perf_fd[i] >= 0);
+    return count;
+  } else if (w->perf_pid != 0) {
+    /* counters from before a fork follow the parent, so drop them */
+    reedkiln_perf_close(w);
+  }
+  for (i = 0; i < Reedkiln_PerfCount; ++i) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = types[i];
+    attr.config = configs[i];
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED
+      | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    w->perf_fd[i] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    if (w->perf_fd[i] >= 0)
+      count += 1;
+  }
+  w->perf_pid = pid;
+#else
+  (void)w;
+#endif /*Reedkiln_Perf*/
+  return count;
+}
+
+void reedkiln_perf_close(struct reedkiln_worker* w) {
+#if defined(Reedkiln_Perf)
+  int i;
+  if (w->perf_pid == 0)
+    return;
+  for (i = 0; i < Reedkiln_PerfCount; ++i) {
+    if (w->perf_fd[i] >= 0)
+      close(w->perf_fd[i]);
+    w->perf_fd[i] = -1;
+  }
+  w->perf_pid = 0;
+#else
+  (void)w;
+#endif /*Reedkiln_Perf*/
+  return;
+}
+
+/**
+ * @brief Start the hardware counters before a test callback.
+ * @param w worker about to run the callback
+ */
+void reedkiln_perf_begin(struct reedkiln_worker* w) {
+#if defined(Reedkiln_Perf)
+  int i;
+  if (!w->perf_tf || reedkiln_perf_open(w) == 0)
+    return;
+  for (i = 0; i < Reedkiln_PerfCount; ++i) {
+    if (w->perf_fd[i] >= 0) {
+      ioctl(w->perf_fd[i], PERF_EVENT_IOC_RESET, 0);
+      ioctl(w->perf_fd[i], PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+#else
+  (void)w;
+#endif /*Reedkiln_Perf*/
+  return;
+}
+
+/**
+ * @brief Stop and read the hardware counters after a test callback.
+ * @param w worker that ran the callback
+ * @param[out] out counter values
+ * @note Counters shared with other events are scaled up to
+ *   estimate the whole run of the callback.
+ */
+void reedkiln_perf_end
+  (struct reedkiln_worker* w, struct reedkiln_perf* out)
+{
+#if defined(Reedkiln_Perf)
+  int i;
+  out->mask = 0u;
+  if (!w->perf_tf || w->perf_pid == 0)
+    return;
+  for (i = 0; i < Reedkiln_PerfCount; ++i) {
+    if (w->perf_fd[i] >= 0)
+      ioctl(w->perf_fd[i], PERF_EVENT_IOC_DISABLE, 0);
+  }
+  for (i = 0; i < Reedkiln_PerfCount; ++i) {
+    /* value, time enabled, time running */
+    unsigned long long data[3];
+    if (w->perf_fd[i] < 0
+    ||  read(w->perf_fd[i], data, sizeof(data)) != (ssize_t)sizeof(data)
+    ||  data[2] == 0u)
+    {
+      continue;
+    }
+    out->value[i] = (data[2] < data[1])
+      ? (reedkiln_intmax)((double)data[0] * data[1] / data[2])
+      : (reedkiln_intmax)data[0];
+    out->mask |= (1u << i);
+  }
+#else
+  (void)w;
+  out->mask = 0u;
+#endif /*Reedkiln_Perf*/
+  return;
+}
+
+void reedkiln_perf_render
+  (struct reedkiln_perf const* perf, struct reedkiln_text* t)
+{
+  static char const* const names[Reedkiln_PerfCount] = {
+    "cycles", "instructions", "branch_misses", "l1d_misses", "llc_misses"
+  };
+  int i;
+  reedkiln_out_puts(t, "  perf:\n");
+  for (i = 0; i < Reedkiln_PerfCount; ++i) {
+    if (!(perf->mask & (1u << i)))
+      continue;
+    reedkiln_out_puts(t, "    ");
+    reedkiln_out_puts(t, names[i]);
+    reedkiln_out_puts(t, ": ");
+    reedkiln_out_uintmax(t, perf->value[i]);
+    reedkiln_out_puts(t, "\n");
+  }
+  return;
+}
+/* END   performance counters */
+
+/* BEGIN reporters */
+/**
+ * @brief Reporters registered for the run.
+ */
+struct reedkiln_reports {
+  struct reedkiln_reporter const* r[Reedkiln_ReportMax];
+  void* p[Reedkiln_ReportMax];
+  unsigned int count;
+};
+
+static struct reedkiln_reports reedkiln_reports_state;
+
+/**
+ * @brief Report file written by a built-in reporter.
+ */
+struct reedkiln_report_file {
+  FILE* f;
+  /** @brief Name of the test suite, from the program name. */
+  char const* suite;
+  /** @brief Log text held until the test ends. */
+  struct reedkiln_text pending;
+};
+
+int reedkiln_add_reporter(struct reedkiln_reporter const* r, void* p) {
+  struct reedkiln_reports* const reps = &reedkiln_reports_state;
+  if (reps->count >= Reedkiln_ReportMax)
+    return -1;
+  reps->r[reps->count] = r;
+  reps->p[reps->count] = p;
+  reps->count += 1u;
+  return 0;
+}
+
+void reedkiln_report_capture
+  (struct reedkiln_worker* w, struct reedkiln_outcome* result)
+{
+  if (reedkiln_reports_state.count > 0u
+  &&  Reedkiln_Atomic_Get(&w->log.pos) > 0)
+  {
+    reedkiln_log_merge(&w->log, &result->message, 1);
+  }
+  return;
+}
+
+void reedkiln_report_plan(size_t count, unsigned int seed) {
+  struct reedkiln_reports const* const reps = &reedkiln_reports_state;
+  unsigned int i;
+  for (i = 0u; i < reps->count; ++i) {
+    if (reps->r[i]->plan_cb != NULL)
+      (*reps->r[i]->plan_cb)(reps->p[i], count, seed);
+  }
+  return;
+}
+
+void reedkiln_report_test
+  ( struct reedkiln_run const* run, size_t test_i,
+    struct reedkiln_outcome const* result, struct reedkiln_worker* w)
+{
+  struct reedkiln_reports const* const reps = &reedkiln_reports_state;
+  struct reedkiln_text local = {0};
+  struct reedkiln_text const* message = &result->message;
+  struct reedkiln_report report;
+  unsigned int i;
+  if (reps->count == 0u)
+    return;
+  if (w != NULL && message->len == 0u && !result->skip_tf
+  &&  Reedkiln_Atomic_Get(&w->log.pos) > 0)
+  {
+    reedkiln_log_merge(&w->log, &local, 1);
+    message = &local;
+  }
+  report.number = test_i+1u;
+  report.name = run->t[test_i].name;
+  report.ok_tf =
+    (result->res == Reedkiln_OK || result->res == Reedkiln_IGNORE);
+  report.directive = result->direct_text;
+  /* drop the " # " before the directive */
+  while (*report.directive == ' ' || *report.directive == '#')
+    report.directive += 1;
+  report.flags = run->t[test_i].flags;
+  report.seed = result->seed;
+  report.duration_ms = result->timing.setup_ms
+    + result->timing.test_ms + result->timing.teardown_ms;
+  report.notes = (char const*)result->notes.data;
+  report.notes_len = result->notes.len;
+  for (i = 0u; i < reps->count; ++i) {
+    struct reedkiln_reporter const* const r = reps->r[i];
+    if (r->start_cb != NULL)
+      (*r->start_cb)(reps->p[i], report.number, report.name);
+    if (r->log_cb != NULL && message->len > 0u) {
+      (*r->log_cb)(reps->p[i], report.number,
+        (char const*)message->data, message->len);
+    }
+    if (r->end_cb != NULL)
+      (*r->end_cb)(reps->p[i], &report);
+  }
+  reedkiln_text_free(&local);
+  return;
+}
+
+void reedkiln_report_bail(struct reedkiln_outcome const* result) {
+  struct reedkiln_reports const* const reps = &reedkiln_reports_state;
+  static char const bail_text[] = "Bail out!";
+  struct reedkiln_text reason = {0};
+  char const* const notes = (char const*)result->notes.data;
+  char const* line = NULL;
+  unsigned int i;
+  if (reps->count == 0u)
+    return;
+  /* find the reason on the "Bail out!" line */{
+    size_t j;
+    for (j = 0u; j + sizeof(bail_text)-1u <= result->notes.len; ++j) {
+      if ((j == 0u || notes[j-1u] == '\n')
+      &&  memcmp(notes+j, bail_text, sizeof(bail_text)-1u) == 0)
+      {
+        line = notes + j + sizeof(bail_text)-1u;
+        break;
+      }
+    }
+  }
+  if (line != NULL) {
+    char const* const end = notes + result->notes.len;
+    char const* stop;
+    if (line < end && *line == ' ')
+      line += 1;
+    for (stop = line; stop < end && *stop != '\n'; ++stop)
+      continue;
+    reedkiln_out_write(&reason, line, (size_t)(stop - line));
+  }
+  reedkiln_out_write(&reason, "", 1u);
+  for (i = 0u; i < reps->count; ++i) {
+    if (reps->r[i]->bail_cb != NULL) {
+      (*reps->r[i]->bail_cb)(reps->p[i],
+        reason.data != NULL ? (char const*)reason.data : "");
+    }
+  }
+  reedkiln_text_free(&reason);
+  return;
+}
+
+void reedkiln_report_finish(void) {
+  struct reedkiln_reports const* const reps = &reedkiln_reports_state;
+  unsigned int i;
+  for (i = 0u; i < reps->count; ++i) {
+    if (reps->r[i]->finish_cb != NULL)
+      (*reps->r[i]->finish_cb)(reps->p[i]);
+  }
+  return;
+}
+
+void reedkiln_xml_write(FILE* f, char const* s, size_t n) {
+  size_t i;
+  for (i = 0u; i < n; ++i) {
+    unsigned char const ch = (unsigned char)s[i];
+    switch (ch) {
+    case '<': fputs("&lt;", f); break;
+    case '>': fputs("&gt;", f); break;
+    case '&': fputs("&amp;", f); break;
+    case '"': fputs("&quot;", f); break;
+    case '\t':
+    case '\n':
+    case '\r':
+      fputc(ch, f); break;
+    default:
+      /* XML 1.0 has no way to write other control characters */
+      fputc(ch < 0x20 ? '?' : ch, f);
+      break;
+    }
+  }
+  return;
+}
+
+void reedkiln_json_write(FILE* f, char const* s, size_t n) {
+  size_t i;
+  fputc('"', f);
+  for (i = 0u; i < n; ++i) {
+    unsigned char const ch = (unsigned char)s[i];
+    switch (ch) {
+    case '"': fputs("\\\"", f); break;
+    case '\\': fputs("\\\\", f); break;
+    case '\n': fputs("\\n", f); break;
+    case '\r': fputs("\\r", f); break;
+    case '\t': fputs("\\t", f); break;
+    default:
+      if (ch < 0x20)
+        fprintf(f, "\\u%04x", (unsigned int)ch);
+      else fputc(ch, f);
+      break;
+    }
+  }
+  fputc('"', f);
+  return;
+}
+
+void reedkiln_bin_u32(unsigned char* b, unsigned long int v) {
+  b[0] = (unsigned char)(v & 255u);
+  b[1] = (unsigned char)((v >> 8) & 255u);
+  b[2] = (unsigned char)((v >> 16) & 255u);
+  b[3] = (unsigned char)((v >> 24) & 255u);
+  return;
+}
+
+void reedkiln_bin_record
+  ( FILE* f, unsigned int kind, unsigned char const* head, size_t head_len,
+    char const* s, size_t n)
+{
+  unsigned char prefix[5];
+  prefix[0] = (unsigned char)kind;
+  reedkiln_bin_u32(prefix+1, (unsigned long int)(head_len + n));
+  fwrite(prefix, 1u, sizeof(prefix), f);
+  if (head_len > 0u)
+    fwrite(head, 1u, head_len, f);
+  if (n > 0u)
+    fwrite(s, 1u, n, f);
+  return;
+}
+
+static void reedkiln_junit_plan
+  (void* p, reedkiln_size count, unsigned int seed)
+{
+  struct reedkiln_report_file* const rf = (struct reedkiln_report_file*)p;
+  fputs("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<testsuites>\n"
+    "<testsuite name=\"", rf->f);
+  reedkiln_xml_write(rf->f, rf->suite, strlen(rf->suite));
+  fprintf(rf->f, "\" tests=\"%lu\">\n<properties>\n"
+    "<property name=\"random_seed\" value=\"%#x\"/>\n</properties>\n",
+    (unsigned long int)count, seed);
+  return;
+}
+
+static void reedkiln_junit_log
+  (void* p, reedkiln_size number, char const* text, reedkiln_size n)
+{
+  struct reedkiln_report_file* const rf = (struct reedkiln_report_file*)p;
+  (void)number;
+  /* the time goes in the start tag, so wait for the end */
+  reedkiln_out_write(&rf->pending, text, n);
+  return;
+}
+
+static void reedkiln_junit_end(void* p, struct reedkiln_report const* r) {
+  struct reedkiln_report_file* const rf = (struct reedkiln_report_file*)p;
+  fputs("<testcase classname=\"", rf->f);
+  reedkiln_xml_write(rf->f, rf->suite, strlen(rf->suite));
+  fputs("\" name=\"", rf->f);
+  reedkiln_xml_write(rf->f, r->name, strlen(r->name));
+  fprintf(rf->f, "\" time=\"%.6f\">\n", r->duration_ms/1000.0);
+  fprintf(rf->f, "<properties>\n"
+    "<property name=\"seed\" value=\"%#x\"/>\n</properties>\n", r->seed);
+  if (r->directive[0] != '\0' && (r->ok_tf || (r->flags & Reedkiln_TODO))) {
+    fputs("<skipped message=\"", rf->f);
+    reedkiln_xml_write(rf->f, r->directive, strlen(r->directive));
+    fputs("\"/>\n", rf->f);
+  } else if (!r->ok_tf) {
+    fputs("<failure message=\"not ok\">", rf->f);
+    reedkiln_xml_write(rf->f, r->notes, r->notes_len);
+    fputs("</failure>\n", rf->f);
+  }
+  if (rf->pending.len > 0u) {
+    fputs("<system-out>", rf->f);
+    reedkiln_xml_write(rf->f, (char const*)rf->pending.data, rf->pending.len);
+    fputs("</system-out>\n", rf->f);
+    rf->pending.len = 0u;
+  }
+  fputs("</testcase>\n", rf->f);
+  return;
+}
+
+static void reedkiln_junit_bail(void* p, char const* reason) {
+  struct reedkiln_report_file* const rf = (struct reedkiln_report_file*)p;
+  fputs("<system-err>Bail out! ", rf->f);
+  reedkiln_xml_write(rf->f, reason, strlen(reason));
+  fputs("</system-err>\n", rf->f);
+  return;
+}
+
+static void reedkiln_junit_finish(void* p) {
+  struct reedkiln_report_file* const rf = (struct reedkiln_report_file*)p;
+  fputs("</testsuite>\n</testsuites>\n", rf->f);
+  return;
+}
+
+static void reedkiln_jsonl_plan
+  (void* p, reedkiln_size count, unsigned int seed)
+{
+  struct reedkiln_report_file* const rf = (struct reedkiln_report_file*)p;
+  fputs("{\"event\":\"plan\",\"suite\":", rf->f);
+  reedkiln_json_write(rf->f, rf->suite, strlen(rf->suite));
+  fprintf(rf->f, ",\"count\":%lu,\"seed\":%u}\n",
+    (unsigned long int)count, seed);
+  return;
+}
+
+static void reedkiln_jsonl_start
+  (void* p, reedkiln_size number, char const* name)
+{
+  struct reedkiln_report_file* const rf = (struct reedkiln_report_file*)p;
+  fprintf(rf->f, "{\"event\":\"start\",\"number\":%lu,\"name\":",
+    (unsigned long int)number);
+  reedkiln_json_write(rf->f, name, strlen(name));
+  fputs("}\n", rf->f);
+  return;
+}
+
+static void reedkiln_jsonl_log
+  (void* p, reedkiln_size number, char const* text, reedkiln_size n)
+{
+  struct reedkiln_report_file* const rf = (struct reedkiln_report_file*)p;
+  fprintf(rf->f, "{\"event\":\"log\",\"number\":%lu,\"text\":",
+    (unsigned long int)number);
+  reedkiln_json_write(rf->f, text, n);
+  fputs("}\n", rf->f);
+  return;
+}
+
+static void reedkiln_jsonl_end(void* p, struct reedkiln_report const* r) {
+  struct reedkiln_report_file* const rf = (struct reedkiln_report_file*)p;
+  fprintf(rf->f, "{\"event\":\"end\",\"number\":%lu,\"name\":",
+    (unsigned long int)r->number);
+  reedkiln_json_write(rf->f, r->name, strlen(r->name));
+  fprintf(rf->f, ",\"ok\":%s,\"directive\":", r->ok_tf ? "true" : "false");
+  reedkiln_json_write(rf->f, r->directive, strlen(r->directive));
+  fprintf(rf->f, ",\"flags\":%u,\"seed\":%u,\"duration_ms\":%.3f,\"notes\":",
+    r->flags, r->seed, r->duration_ms);
+  reedkiln_json_write(rf->f, r->notes, r->notes_len);
+  fputs("}\n", rf->f);
+  return;
+}
+
+static void reedkiln_jsonl_bail(void* p, char const* reason) {
+  struct reedkiln_report_file* const rf = (struct reedkiln_report_file*)p;
+  fputs("{\"event\":\"bail\",\"reason\":", rf->f);
+  reedkiln_json_write(rf->f, reason, strlen(reason));
+  fputs("}\n", rf->f);
+  return;
+}
+
+static void reedkiln_jsonl_finish(void* p) {
+  struct reedkiln_report_file* const rf = (struct reedkiln_report_file*)p;
+  fputs("{\"event\":\"finish\"}\n", rf->f);
+  return;
+}
+
+/*
+ * Binary reports start with "RKLN" and a 32-bit version, then hold
+ * records of a kind byte, a 32-bit payload length and the payload.
+ * All integers are little-endian.
+ */
+static void reedkiln_binary_plan
+  (void* p, reedkiln_size count, unsigned int seed)
+{
+  struct reedkiln_report_file* const rf = (struct reedkiln_report_file*)p;
+  unsigned char head[8];
+  fputs("RKLN", rf->f);
+  reedkiln_bin_u32(head, 1u);
+  fwrite(head, 1u, 4u, rf->f);
+  /* plan: count, seed, suite name */
+  reedkiln_bin_u32(head, (unsigned long int)count);
+  reedkiln_bin_u32(head+4, seed);
+  reedkiln_bin_record(rf->f, 1u, head, 8u, rf->suite, strlen(rf->suite));
+  return;
+}
+
+static void reedkiln_binary_start
+  (void* p, reedkiln_size number, char const* name)
+{
+  struct reedkiln_report_file* const rf = (struct reedkiln_report_file*)p;
+  unsigned char head[4];
+  /* start: number, name */
+  reedkiln_bin_u32(head, (unsigned long int)number);
+  reedkiln_bin_record(rf->f, 2u, head, 4u, name, strlen(name));
+  return;
+}
+
+static void reedkiln_binary_log
+  (void* p, reedkiln_size number, char const* text, reedkiln_size n)
+{
+  struct reedkiln_report_file* const rf = (struct reedkiln_report_file*)p;
+  unsigned char head[4];
+  /* log: number, text */
+  reedkiln_bin_u32(head, (unsigned long int)number);
+  reedkiln_bin_record(rf->f, 3u, head, 4u, text, n);
+  return;
+}
+
+static void reedkiln_binary_end(void* p, struct reedkiln_report const* r) {
+  struct reedkiln_report_file* const rf = (struct reedkiln_report_file*)p;
+  size_t const directive_len = strlen(r->directive);
+  unsigned char head[21];
+  struct reedkiln_text tail = {0};
+  /* end: number, ok, flags, seed, microseconds, directive length,
+   *   directive, notes */
+  reedkiln_bin_u32(head, (unsigned long int)r->number);
+  head[4] = (unsigned char)(r->ok_tf ? 1u : 0u);
+  reedkiln_bin_u32(head+5, r->flags);
+  reedkiln_bin_u32(head+9, r->seed);
+  reedkiln_bin_u32(head+13, (r->duration_ms*1000.0 >= 4294967295.0)
+    ? 0xFFFFFFFFul : (unsigned long int)(r->duration_ms*1000.0));
+  reedkiln_bin_u32(head+17, (unsigned long int)directive_len);
+  if (directive_len > 0u)
+    reedkiln_out_write(&tail, r->directive, directive_len);
+  if (r->notes_len > 0u)
+    reedkiln_out_write(&tail, r->notes, r->notes_len);
+  reedkiln_bin_record(rf->f, 4u, head, sizeof(head),
+    (char const*)tail.data, tail.len);
+  reedkiln_text_free(&tail);
+  return;
+}
+
+static void reedkiln_binary_bail(void* p, char const* reason) {
+  struct reedkiln_report_file* const rf = (struct reedkiln_report_file*)p;
+  /* bail: reason */
+  reedkiln_bin_record(rf->f, 5u, NULL, 0u, reason, strlen(reason));
+  return;
+}
+
+static void reedkiln_binary_finish(void* p) {
+  struct reedkiln_report_file* const rf = (struct reedkiln_report_file*)p;
+  reedkiln_bin_record(rf->f, 6u, NULL, 0u, NULL, 0u);
+  return;
+}
+
+static struct reedkiln_reporter const reedkiln_junit_reporter = {
+  &reedkiln_junit_plan, NULL, &reedkiln_junit_log,
+  &reedkiln_junit_end, &reedkiln_junit_bail, &reedkiln_junit_finish
+};
+static struct reedkiln_reporter const reedkiln_jsonl_reporter = {
+  &reedkiln_jsonl_plan, &reedkiln_jsonl_start, &reedkiln_jsonl_log,
+  &reedkiln_jsonl_end, &reedkiln_jsonl_bail, &reedkiln_jsonl_finish
+};
+static struct reedkiln_reporter const reedkiln_binary_reporter = {
+  &reedkiln_binary_plan, &reedkiln_binary_start, &reedkiln_binary_log,
+  &reedkiln_binary_end, &reedkiln_binary_bail, &reedkiln_binary_finish
+};
+
+/**
+ * @brief Open a report file and add its reporter.
+ * @param rf report file to fill
+ * @param spec format and path, as in "junit:out.xml"
+ * @param suite name of the test suite
+ * @return zero on success, nonzero on error
+ */
+int reedkiln_report_open
+  (struct reedkiln_report_file* rf, char const* spec, char const* suite)
+{
+  static struct {
+    char const* name;
+    struct reedkiln_reporter const* r;
+  } const formats[] = {
+    { "junit:", &reedkiln_junit_reporter },
+    { "jsonl:", &reedkiln_jsonl_reporter },
+    { "binary:", &reedkiln_binary_reporter }
+  };
+  size_t i;
+  for (i = 0u; i < sizeof(formats)/sizeof(formats[0]); ++i) {
+    size_t const len = strlen(formats[i].name);
+    if (strncmp(spec, formats[i].name, len) != 0)
+      continue;
+    rf->suite = suite;
+    rf->pending.data = NULL;
+    rf->pending.len = 0u;
+    rf->pending.cap = 0u;
+    rf->f = fopen(spec+len, "wb");
+    if (rf->f == NULL)
+      return -1;
+    if (reedkiln_add_reporter(formats[i].r, rf) != 0) {
+      fclose(rf->f);
+      rf->f = NULL;
+      return -1;
+    }
+    return 0;
+  }
+  rf->f = NULL;
+  return -1;
+}
+
+/**
+ * @brief Close report files and drop their reporters.
+ * @param rf report files to close
+ * @param count number of report files
+ * @param base number of reporters to keep
+ * @return zero on success, nonzero if a file failed to close
+ */
+int reedkiln_report_close
+  (struct reedkiln_report_file* rf, unsigned int count, unsigned int base)
+{
+  int res = 0;
+  unsigned int i;
+  for (i = 0u; i < count; ++i) {
+    if (rf[i].f != NULL && fclose(rf[i].f) != 0)
+      res = -1;
+    rf[i].f = NULL;
+    reedkiln_text_free(&rf[i].pending);
+  }
+  reedkiln_reports_state.count = base;
+  return res;
+}
+/* END   reporters */
+
+/* BEGIN benchmark */
+double reedkiln_clock_ns(void) {
+#if (defined _WIN32)
+  LARGE_INTEGER now, freq;
+  if (!QueryPerformanceCounter(&now) || !QueryPerformanceFrequency(&freq))
+    return 0.0;
+  return (double)now.QuadPart * (1e9 / (double)freq.QuadPart);
+#elif (defined CLOCK_MONOTONIC)
+  struct timespec ts;
+  if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0)
+    return 0.0;
+  return (double)ts.tv_sec*1e9 + (double)ts.tv_nsec;
+#else
+  return (double)clock() * (1e9 / CLOCKS_PER_SEC);
+#endif /*_WIN32*/
+}
+
+double reedkiln_cpu_ns(int thread_tf) {
+#if (defined _WIN32)
+  FILETIME creation, exit_time, kernel, user;
+  BOOL const ok = thread_tf
+    ? GetThreadTimes(GetCurrentThread(), &creation, &exit_time, &kernel, &user)
+    : GetProcessTimes(GetCurrentProcess(),
+        &creation, &exit_time, &kernel, &user);
+  if (!ok)
+    return 0.0;
+  return ((double)kernel.dwLowDateTime + (double)user.dwLowDateTime
+    + ((double)kernel.dwHighDateTime + (double)user.dwHighDateTime)
+      * 4294967296.0) * 100.0;
+#elif (defined CLOCK_PROCESS_CPUTIME_ID)
+  struct timespec ts;
+#  if (defined CLOCK_THREAD_CPUTIME_ID)
+  clockid_t const id = thread_tf
+    ? CLOCK_THREAD_CPUTIME_ID : CLOCK_PROCESS_CPUTIME_ID;
+#  else
+  clockid_t const id = CLOCK_PROCESS_CPUTIME_ID;
+#  endif /*CLOCK_THREAD_CPUTIME_ID*/
+  if (clock_gettime(id, &ts) != 0)
+    return 0.0;
+  return (double)ts.tv_sec*1e9 + (double)ts.tv_nsec;
+#else
+  return (double)clock() * (1e9 / CLOCKS_PER_SEC);
+#endif /*_WIN32*/
+}
+
+/**
+ * @brief Record the start of a test phase.
+ * @param w worker to measure
+ * @param[out] mark wall and CPU clock values
+ */
+void reedkiln_timing_mark(struct reedkiln_worker const* w, double* mark) {
+  mark[0] = reedkiln_clock_ns();
+  mark[1] = reedkiln_cpu_ns(w->thread_cpu_tf != 0u);
+  return;
+}
+
+/**
+ * @brief Add the time since a mark to a phase.
+ * @param w worker to measure
+ * @param[out] wall_ms phase wall time to update
+ * @param[out] cpu_ms phase CPU time to update
+ * @param mark wall and CPU clock values at the start of the phase;
+ *   updated to the current clock values
+ */
+void reedkiln_timing_add
+  ( struct reedkiln_worker const* w, double* wall_ms, double* cpu_ms,
+    double* mark)
+{
+  double const wall = reedkiln_clock_ns();
+  double const cpu = reedkiln_cpu_ns(w->thread_cpu_tf != 0u);
+  *wall_ms += (wall - mark[0]) / 1e6;
+  *cpu_ms += (cpu - mark[1]) / 1e6;
+  mark[0] = wall;
+  mark[1] = cpu;
+  return;
+}
+
+void reedkiln_timing_render
+  (struct reedkiln_timing const* timing, struct reedkiln_text* t)
+{
+  reedkiln_out_puts(t, "  duration_ms: ");
+  reedkiln_out_double(t,
+    timing->setup_ms + timing->test_ms + timing->teardown_ms);
+  reedkiln_out_puts(t, "\n  setup:\n    duration_ms: ");
+  reedkiln_out_double(t, timing->setup_ms);
+  reedkiln_out_puts(t, "\n    cpu_ms: ");
+  reedkiln_out_double(t, timing->setup_cpu_ms);
+  reedkiln_out_puts(t, "\n  test:\n    duration_ms: ");
+  reedkiln_out_double(t, timing->test_ms);
+  reedkiln_out_puts(t, "\n    cpu_ms: ");
+  reedkiln_out_double(t, timing->test_cpu_ms);
+  reedkiln_out_puts(t, "\n  teardown:\n    duration_ms: ");
+  reedkiln_out_double(t, timing->teardown_ms);
+  reedkiln_out_puts(t, "\n    cpu_ms: ");
+  reedkiln_out_double(t, timing->teardown_cpu_ms);
+  reedkiln_out_puts(t, "\n");
+  return;
+}
+
+double reedkiln_sqrt(double x) {
+  double r;
+  int i;
+  if (!(x > 0.0))
+    return 0.0;
+  r = (x > 1.0) ? x : 1.0;
+  for (i = 0; i < 80; ++i) {
+    double const next = 0.5*(r + x/r);
+    if (next >= r)
+      break;
+    r = next;
+  }
+  return r;
+}
+
+reedkiln_size reedkiln_bench_count(void) {
+  struct reedkiln_worker* const w = reedkiln_worker_get();
+  reedkiln_size const n = w->bench.count;
+  reedkiln_timeout_check(w);
+  return n ? n : 1u;
+}
+
+void reedkiln_bench_pause(void) {
+  struct reedkiln_bench* const bench = &reedkiln_worker_get()->bench;
+  if (bench->count > 0u && !bench->paused_tf) {
+    bench->elapsed_ns += reedkiln_clock_ns() - bench->start_ns;
+    bench->paused_tf = 1u;
+  }
+  return;
+}
+
+void reedkiln_bench_resume(void) {
+  struct reedkiln_bench* const bench = &reedkiln_worker_get()->bench;
+  if (bench->count > 0u && bench->paused_tf) {
+    bench->paused_tf = 0u;
+    bench->start_ns = reedkiln_clock_ns();
+  }
+  return;
+}
+
+int reedkiln_bench_sample
+  ( struct reedkiln_worker* w, reedkiln_cb cb, void* p,
+    reedkiln_size n, double* ns)
+{
+  int res;
+  w->bench.count = n;
+  w->bench.elapsed_ns = 0.0;
+  w->bench.paused_tf = 0u;
+  w->bench.start_ns = reedkiln_clock_ns();
+  res = reedkiln_run_test(cb, p);
+  reedkiln_bench_pause();
+  *ns = w->bench.elapsed_ns;
+  return res;
+}
+
+int reedkiln_run_bench
+  ( struct reedkiln_run const* run, struct reedkiln_worker* w,
+    reedkiln_cb cb, void* p)
+{
+  double const target = run->bench_time * 1e9 / Reedkiln_BenchSamples;
+  double const wall_start = reedkiln_clock_ns();
+  double times[Reedkiln_BenchSamples];
+  reedkiln_size n = 1u;
+  double ns = 0.0;
+  int res;
+  unsigned int i;
+  /* calibrate by wall time (so pauses count), which also warms up */
+  for (;;) {
+    double const sample_start = reedkiln_clock_ns();
+    double wall;
+    res = reedkiln_bench_sample(w, cb, p, n, &ns);
+    wall = reedkiln_clock_ns() - sample_start;
+    if (res != Reedkiln_OK || wall >= target || n >= reedkiln_bench_max
+    ||  reedkiln_clock_ns() - wall_start > run->bench_time*1e9)
+    {
+      break;
+    } else if (wall*100.0 < target) {
+      n = (n > reedkiln_bench_max/100u) ? reedkiln_bench_max : n*100u;
+    } else {
+      double const next = (double)n * 1.2 * target / wall;
+      n = (next >= (double)reedkiln_bench_max)
+        ? reedkiln_bench_max : (reedkiln_size)next + 1u;
+    }
+  }
+  /* warm up at the final count */
+  if (res == Reedkiln_OK)
+    res = reedkiln_bench_sample(w, cb, p, n, &ns);
+  for (i = 0u; i < Reedkiln_BenchSamples && res == Reedkiln_OK; ++i) {
+    res = reedkiln_bench_sample(w, cb, p, n, &ns);
+    times[i] = ns / (double)n;
+  }
+  w->bench.count = 0u;
+  if (res == Reedkiln_OK) {
+    w->bench.iterations = n;
+    reedkiln_bench_stats(&w->bench, times, Reedkiln_BenchSamples);
+  }
+  return res;
+}
+
+/**
+ * @brief Quantile of sorted samples with linear interpolation.
+ */
+static double reedkiln_bench_quantile
+  (double const* sorted, unsigned int n, double q)
+{
+  double const pos = q * (double)(n-1u);
+  unsigned int const lo = (unsigned int)pos;
+  double const frac = pos - (double)lo;
+  if (lo+1u >= n)
+    return sorted[n-1u];
+  return sorted[lo] + (sorted[lo+1u] - sorted[lo])*frac;
+}
+
+void reedkiln_bench_stats
+  (struct reedkiln_bench* bench, double* times, unsigned int n)
+{
+  double sum = 0.0;
+  double sq = 0.0;
+  unsigned int i;
+  /* insertion sort */for (i = 1u; i < n; ++i) {
+    double const v = times[i];
+    unsigned int j;
+    for (j = i; j > 0u && times[j-1u] > v; --j)
+      times[j] = times[j-1u];
+    times[j] = v;
+  }
+  for (i = 0u; i < n; ++i)
+    sum += times[i];
+  bench->mean_ns = sum / (double)n;
+  for (i = 0u; i < n; ++i) {
+    double const d = times[i] - bench->mean_ns;
+    sq += d*d;
+  }
+  bench->stddev_ns = (n > 1u) ? reedkiln_sqrt(sq / (double)(n-1u)) : 0.0;
+  bench->median_ns = reedkiln_bench_quantile(times, n, 0.5);
+  /* count outliers beyond Tukey's fences */{
+    double const q1 = reedkiln_bench_quantile(times, n, 0.25);
+    double const q3 = reedkiln_bench_quantile(times, n, 0.75);
+    double const fence = 1.5*(q3 - q1);
+    bench->outliers = 0u;
+    for (i = 0u; i < n; ++i) {
+      if (times[i] < q1 - fence || times[i] > q3 + fence)
+        bench->outliers += 1u;
+    }
+  }
+  bench->samples = n;
+  return;
+}
+
+void reedkiln_bench_render
+  (struct reedkiln_bench const* bench, struct reedkiln_text* t)
+{
+  reedkiln_out_puts(t, "  benchmark:\n    iterations: ");
+  reedkiln_out_ulong(t, (unsigned long int)bench->iterations);
+  reedkiln_out_puts(t, "\n    samples: ");
+  reedkiln_out_ulong(t, bench->samples);
+  reedkiln_out_puts(t, "\n    mean_ns: ");
+  reedkiln_out_double(t, bench->mean_ns);
+  reedkiln_out_puts(t, "\n    median_ns: ");
+  reedkiln_out_double(t, bench->median_ns);
+  reedkiln_out_puts(t, "\n    stddev_ns: ");
+  reedkiln_out_double(t, bench->stddev_ns);
+  reedkiln_out_puts(t, "\n    outliers: ");
+  reedkiln_out_ulong(t, bench->outliers);
+  reedkiln_out_puts(t, "\n");
+  return;
+}
+/* END   benchmark */
+
+/* BEGIN property */
+int reedkiln_gen_push(struct reedkiln_gen* g, unsigned long int v) {
+  if (g->len >= g->cap) {
+    size_t const new_cap = g->cap ? g->cap*2u : 64u;
+    unsigned long int* new_choice;
+    if (new_cap > ((size_t)-1)/sizeof(unsigned long int))
+      return -1;
+    new_choice = (unsigned long int*)realloc
+      (g->choice, new_cap*sizeof(unsigned long int));
+    if (new_choice == NULL)
+      return -1;
+    g->choice = new_choice;
+    g->cap = new_cap;
+  }
+  g->choice[g->len++] = v;
+  return 0;
+}
+
+unsigned long int reedkiln_gen_draw
+  (struct reedkiln_gen* g, unsigned long int max)
+{
+  unsigned long int v;
+  reedkiln_timeout_check(reedkiln_worker_get());
+  if (g->replay != NULL) {
+    v = (g->len < g->replay_len) ? g->replay[g->len] : 0u;
+    if (v > max)
+      v = max;
+  } else {
+    /* mix so that the low bits do not follow the generator's pattern */
+    v = reedkiln_rand_mix(reedkiln_rand_step());
+    /* widen to the full range of unsigned long */
+    v = ((v << 16) << 16) ^ reedkiln_rand_mix(reedkiln_rand_step());
+    if (max < ULONG_MAX)
+      v %= max+1u;
+  }
+  if (reedkiln_gen_push(g, v) != 0)
+    g->overrun_tf = 1;
+  return v;
+}
+
+unsigned long int reedkiln_gen_uint
+  (struct reedkiln_gen* g, unsigned long int max)
+{
+  unsigned long int const v = reedkiln_gen_draw(g, max);
+  if (g->describe != NULL) {
+    reedkiln_out_puts(g->describe, " ");
+    reedkiln_out_ulong(g->describe, v);
+  }
+  return v;
+}
+
+long int reedkiln_gen_int(struct reedkiln_gen* g, long int lo, long int hi) {
+  long int v;
+  if (lo >= 0) {
+    v = (long int)((unsigned long int)lo
+      + reedkiln_gen_draw(g, (unsigned long int)hi - (unsigned long int)lo));
+  } else if (hi <= 0) {
+    v = (long int)((unsigned long int)hi
+      - reedkiln_gen_draw(g, (unsigned long int)hi - (unsigned long int)lo));
+  } else {
+    /* draw the sign first, so each side shrinks toward zero on its own */
+    unsigned long int const neg_tf = reedkiln_gen_draw(g, 1u);
+    unsigned long int const k = reedkiln_gen_draw(g,
+      neg_tf ? 0u - (unsigned long int)lo : (unsigned long int)hi);
+    v = (k == 0u) ? 0
+      : neg_tf ? -(long int)(k-1u) - 1 : (long int)k;
+  }
+  if (g->describe != NULL) {
+    char buf[Reedkiln_ItoAMax+3];
+    sprintf(buf, " %li", v);
+    reedkiln_out_puts(g->describe, buf);
+  }
+  return v;
+}
+
+reedkiln_size reedkiln_gen_bytes
+  (struct reedkiln_gen* g, void* b, reedkiln_size max)
+{
+  static char const digits[] = "0123456789abcdef";
+  unsigned char* const p = (unsigned char*)b;
+  size_t const n = (size_t)reedkiln_gen_draw
+    (g, (max > ULONG_MAX) ? ULONG_MAX : (unsigned long int)max);
+  size_t i;
+  for (i = 0u; i < n; ++i)
+    p[i] = (unsigned char)reedkiln_gen_draw(g, UCHAR_MAX);
+  if (g->describe != NULL) {
+    reedkiln_out_puts(g->describe, " <");
+    for (i = 0u; i < n; ++i) {
+      char hex[4];
+      hex[0] = ' ';
+      hex[1] = digits[(p[i]>>4)&15u];
+      hex[2] = digits[p[i]&15u];
+      hex[3] = 0;
+      reedkiln_out_puts(g->describe, hex + (i == 0u));
+    }
+    reedkiln_out_puts(g->describe, ">");
+  }
+  return n;
+}
+
+int reedkiln_prop_redirect(void* d) {
+  struct reedkiln_prop_data *const data = (struct reedkiln_prop_data *)d;
+  return (*data->cb)(&data->gen, data->p);
+}
+
+void reedkiln_prop_free(struct reedkiln_prop_data* data) {
+  free(data->gen.choice);
+  free(data->best);
+  free(data->cand);
+  reedkiln_text_free(&data->text);
+  memset(data, 0, sizeof(*data));
+  return;
+}
+
+int reedkiln_prop_trial(struct reedkiln_prop_data* data) {
+  struct reedkiln_worker* const w = reedkiln_worker_get();
+  int res;
+  data->gen.len = 0u;
+  data->gen.overrun_tf = 0;
+  res = reedkiln_run_test(reedkiln_prop_redirect, data);
+  if (w->bail_tf || Reedkiln_Atomic_Get(&w->timeout_tf) == 2u) {
+    /* stop searching and pass the failure on */
+    w->quiet_tf = data->quiet_tf;
+    reedkiln_prop_free(data);
+    reedkiln_fail();
+  }
+  return !(res == Reedkiln_OK || res == Reedkiln_IGNORE
+    || data->gen.overrun_tf);
+}
+
+/**
+ * @brief Try a smaller candidate input.
+ * @param data property state
+ * @param len number of choices in the candidate
+ * @param shorter_tf whether to require fewer choices than before
+ * @return nonzero if the candidate failed and gave a smaller input
+ */
+int reedkiln_prop_shrink_try
+  (struct reedkiln_prop_data* data, size_t len, int shorter_tf)
+{
+  struct reedkiln_gen* const g = &data->gen;
+  size_t i;
+  data->budget -= 1u;
+  g->replay = data->cand;
+  g->replay_len = len;
+  if (!reedkiln_prop_trial(data))
+    return 0;
+  /* keep the input that ran if shorter, or lower at the first difference */
+  if (g->len > data->best_len || (shorter_tf && g->len == data->best_len))
+    return 0;
+  else if (g->len == data->best_len) {
+    for (i = 0u; i < g->len && g->choice[i] == data->best[i]; ++i)
+      continue;
+    if (i == g->len || g->choice[i] > data->best[i])
+      return 0;
+  }
+  memcpy(data->best, g->choice, g->len*sizeof(unsigned long int));
+  data->best_len = g->len;
+  data->shrinks += 1u;
+  return 1;
+}
+
+void reedkiln_prop_shrink(struct reedkiln_prop_data* data) {
+  int improved_tf;
+  do {
+    size_t k, i, j;
+    improved_tf = 0;
+    /* remove runs of choices */
+    for (k = 8u; k > 0u; k /= 2u) {
+      for (i = 0u; i+k <= data->best_len && data->budget > 0u; ) {
+        memcpy(data->cand, data->best, i*sizeof(unsigned long int));
+        memcpy(data->cand+i, data->best+i+k,
+          (data->best_len-i-k)*sizeof(unsigned long int));
+        if (reedkiln_prop_shrink_try(data, data->best_len-k, 1)) {
+          improved_tf = 1;
+          continue;
+        }
+        /* also lower an earlier choice, such as the length of the run */
+        for (j = i; j > 0u && data->best[j-1u] < k; --j)
+          continue;
+        if (j > 0u && data->budget > 0u) {
+          data->cand[j-1u] -= k;
+          if (reedkiln_prop_shrink_try(data, data->best_len-k, 1)) {
+            improved_tf = 1;
+            continue;
+          }
+        }
+        ++i;
+      }
+    }
+    /* lower each choice by bisection */
+    for (i = 0u; i < data->best_len && data->budget > 0u; ++i) {
+      unsigned long int lo = 0u;
+      unsigned long int hi = data->best[i];
+      while (lo < hi && data->budget > 0u) {
+        unsigned long int const mid = lo + (hi-lo)/2u;
+        memcpy(data->cand, data->best,
+          data->best_len*sizeof(unsigned long int));
+        data->cand[i] = mid;
+        if (reedkiln_prop_shrink_try(data, data->best_len, 0)) {
+          improved_tf = 1;
+          if (i >= data->best_len)
+            break;
+          hi = data->best[i];
+        } else lo = mid+1u;
+      }
+    }
+  } while (improved_tf && data->budget > 0u);
+  return;
+}
+
+int reedkiln_prop_check
+  (reedkiln_prop_cb cb, void* p, unsigned long int trials)
+{
+  struct reedkiln_worker* const w = reedkiln_worker_get();
+  struct reedkiln_prop_data data;
+  unsigned long int trial_i;
+  memset(&data, 0, sizeof(data));
+  data.cb = cb;
+  data.p = p;
+  data.quiet_tf = w->quiet_tf;
+  data.budget = Reedkiln_PropShrinks;
+  if (trials == 0u)
+    trials = Reedkiln_PropTrials;
+  w->quiet_tf = 1u;
+  for (trial_i = 0u; trial_i < trials; ++trial_i) {
+    if (reedkiln_prop_trial(&data))
+      break;
+  }
+  if (trial_i >= trials) {
+    w->quiet_tf = data.quiet_tf;
+    reedkiln_prop_free(&data);
+    return Reedkiln_OK;
+  }
+  /* shrink the failing input */
+  data.best_len = data.gen.len;
+  data.best = (unsigned long int*)malloc
+    ((data.best_len ? data.best_len : 1u)*sizeof(unsigned long int));
+  data.cand = (unsigned long int*)malloc
+    ((data.best_len ? data.best_len : 1u)*sizeof(unsigned long int));
+  if (data.best != NULL && data.cand != NULL) {
+    memcpy(data.best, data.gen.choice,
+      data.best_len*sizeof(unsigned long int));
+    reedkiln_prop_shrink(&data);
+    data.gen.replay = data.best;
+    data.gen.replay_len = data.best_len;
+  } else data.gen.replay = NULL;
+  reedkiln_out_puts(&data.text, "counterexample after ");
+  reedkiln_out_ulong(&data.text, trial_i+1u);
+  reedkiln_out_puts(&data.text, (trial_i > 0u) ? " trials" : " trial");
+  reedkiln_out_puts(&data.text, " and ");
+  reedkiln_out_ulong(&data.text, data.shrinks);
+  reedkiln_out_puts(&data.text,
+    (data.shrinks != 1u) ? " shrinks:" : " shrink:");
+  w->quiet_tf = data.quiet_tf;
+  if (data.gen.replay != NULL) {
+    /* replay the smallest failure with diagnostics */
+    data.gen.describe = &data.text;
+    (void)reedkiln_prop_trial(&data);
+    data.gen.describe = NULL;
+  }
+  reedkiln_log_write(data.text.data, data.text.len);
+  reedkiln_prop_free(&data);
+  return Reedkiln_NOT_OK;
+}
+/* END   property */
+
+void reedkiln_set_vtable(struct reedkiln_vtable const* vt) {
+  reedkiln_worker_get()->vtable = *vt;
+  return;
+}
+
+char const* reedkiln_outcome_directive
+  (struct reedkiln_run const* run, size_t test_i, int res)
+{
+  struct reedkiln_entry const* const test = run->t+test_i;
+  if (res == Reedkiln_IGNORE)
+    return " # SKIP at runtime";
+  else if (!(test->flags & Reedkiln_SKIP) && reedkiln_cache_hit(run, test))
+    return " # SKIP cached";
+  else return reedkiln_entry_directive(test);
+}
+
+int reedkiln_entry_skips(struct reedkiln_run const* run, size_t test_i) {
+  struct reedkiln_entry const* const test = run->t+test_i;
+  return ((test->flags & Reedkiln_SKIP)!= 0)
+    || reedkiln_cache_hit(run, test) || reedkiln_journal_hit(run, test_i);
+}
+
+void reedkiln_run_entry
+  ( struct reedkiln_run const* run, struct reedkiln_worker* w,
+    size_t pos, struct reedkiln_outcome* out)
+{
+  size_t const test_i = reedkiln_run_order(run, pos);
+  struct reedkiln_entry const* const test = run->t+test_i;
+  int const skip_tf = reedkiln_entry_skips(run, test_i);
+  int res = 0;
+  out->skip_tf = skip_tf;
+  out->bail_tf = 0;
+  if (!skip_tf) {
+    struct reedkiln_box const* box = test->box;
+    struct reedkiln_timing* const timing = &out->timing;
+    void* box_item = NULL;
+    int box_called = 0;
+    double mark[2];
+    unsigned int late;
+    w->notes = w->capture_tf ? &out->notes : NULL;
+    w->bail_tf = 0u;
+    w->quiet_tf = 0u;
+    w->vtable = run->initial_table;
+    w->bench.samples = 0u;
+    w->alloc_budget[0] = Reedkiln_AllocAny;
+    w->alloc_budget[1] = Reedkiln_AllocAny;
+    w->perf_tf = (run->perf_tf != 0);
+    w->test_name = test->name;
+    w->subtest_count = 0u;
+    out->seed = reedkiln_entry_seed(run, test_i);
+    reedkiln_srand(out->seed);
+    reedkiln_log_reset(w);
+    w->running_tf = 1u;
+    reedkiln_watchdog_arm
+      (w, test_i, test->name, reedkiln_entry_timeout(run, test_i));
+    reedkiln_timing_mark(w, mark);
+    if (w->fixture_box != NULL && w->fixture_box != box) {
+      /* left by a test whose next one went to another worker */
+      reedkiln_fixture_release(w);
+      reedkiln_timing_add(w, &timing->setup_ms, &timing->setup_cpu_ms, mark);
+    }
+    if (box != NULL && w->fixture_box == box) {
+      /* reuse the item from the last test with this box */
+      box_item = w->fixture_item;
+      w->fixture_box = NULL;
+      w->fixture_item = NULL;
+      res = reedkiln_run_test(box->reset, box_item);
+      reedkiln_timing_add(w, &timing->setup_ms, &timing->setup_cpu_ms, mark);
+      box_called = (res != Reedkiln_OK || w->bail_tf) ? 3 : 1;
+    } else if (box != NULL && box->setup != NULL) {
+      res = reedkiln_run_setup(box->setup, run->p, &box_item);
+      reedkiln_timing_add(w, &timing->setup_ms, &timing->setup_cpu_ms, mark);
+      if (w->bail_tf) {
+        (void)reedkiln_watchdog_disarm(w);
+        w->running_tf = 0u;
+        out->bail_tf = 1;
+        out->res = res;
+        return;
+      } else if (res != Reedkiln_OK) {
+        box_called = 2;
+      } else box_called = 1;
+    }
+    if (box_called <= 1) {
+      void* const item = box_called ? box_item : run->p;
+      reedkiln_alloc_begin(w);
+      reedkiln_perf_begin(w);
+      res = (test->flags & Reedkiln_BENCH)
+        ? reedkiln_run_bench(run, w, test->cb, item)
+        : reedkiln_run_test(test->cb, item);
+      reedkiln_subtest_plan(w);
+      reedkiln_perf_end(w, &out->perf);
+      reedkiln_alloc_end(w, &out->allocs);
+      reedkiln_timing_add(w, &timing->test_ms, &timing->test_cpu_ms, mark);
+      if (res == Reedkiln_OK && !w->bail_tf
+      &&  reedkiln_alloc_over(w, &out->allocs))
+      {
+        res = Reedkiln_NOT_OK;
+      }
+    }
+    late = reedkiln_watchdog_disarm(w);
+    if (late == 1u && !w->bail_tf) {
+      /* finished late without reaching a check point */
+      reedkiln_timeout_note(w, reedkiln_entry_timeout(run, test_i));
+      res = Reedkiln_NOT_OK;
+    }
+    if (box_called == 1 && box->reset != NULL && late == 0u && !w->bail_tf
+    &&  reedkiln_run_next_box(run, pos) == box)
+    {
+      /* keep the item for the next test */
+      w->fixture_box = box;
+      w->fixture_item = box_item;
+    } else if ((box_called == 1 || box_called == 3)
+      &&  box->teardown != NULL)
+    {
+      (*box->teardown)(box_item);
+      reedkiln_timing_add
+        (w, &timing->teardown_ms, &timing->teardown_cpu_ms, mark);
+    }
+    w->running_tf = 0u;
+    out->bail_tf = (w->bail_tf != 0u);
+  }
+  out->direct_text = reedkiln_outcome_directive(run, test_i, res);
+  out->res = res;
+  return;
+}
+
+int reedkiln_print_result
+  ( struct reedkiln_run const* run, size_t test_i,
+    struct reedkiln_outcome const* result, struct reedkiln_worker* w)
+{
+  int failed_tf = 0;
+  char const* result_text;
+  /* collect the text for the journal */
+  struct reedkiln_text line = {0};
+  struct reedkiln_text* const t = (run->journal != NULL) ? &line : NULL;
+  if (run->repeat != NULL && !run->repeat->final_tf && !result->bail_tf)
+    return reedkiln_repeat_note(run, test_i, result, w);
+  if (reedkiln_journal_hit(run, test_i)) {
+    struct reedkiln_text const* const text = run->journal->replay+test_i;
+    reedkiln_out_write(NULL, text->data, text->len);
+    reedkiln_out_flush();
+    run->journal->done += 1u;
+    return run->journal->failed[test_i];
+  }
+  if (result->notes.len > 0)
+    reedkiln_out_write(t, result->notes.data, result->notes.len);
+  if (result->bail_tf) {
+    /* a bail out leaves the test unfinished for the journal */
+    if (line.len > 0u)
+      reedkiln_out_write(NULL, line.data, line.len);
+    reedkiln_text_free(&line);
+    reedkiln_out_flush();
+    if (run->repeat != NULL)
+      run->repeat->bail_tf = 1;
+    reedkiln_report_bail(result);
+    return 1;
+  }
+  switch (result->res) {
+  case Reedkiln_OK:
+  case Reedkiln_IGNORE:
+    result_text = "ok "; break;
+  default:
+    failed_tf = !(run->t[test_i].flags & Reedkiln_TODO);
+    result_text = "not ok ";break;
+  }
+  reedkiln_out_puts(t, result_text);
+  reedkiln_out_ulong(t, (unsigned long int)(test_i+1));
+  reedkiln_out_puts(t, " - ");
+  reedkiln_out_puts(t, run->t[test_i].name);
+  reedkiln_out_puts(t, result->direct_text);
+  reedkiln_out_puts(t, "\n");
+  if (run->durations != NULL && !result->skip_tf) {
+    run->durations[test_i] = result->timing.setup_ms
+      + result->timing.test_ms + result->timing.teardown_ms;
+  }
+  reedkiln_cache_note(run, test_i, result);
+  if (result->yaml.len > 0)
+    reedkiln_out_write(t, result->yaml.data, result->yaml.len);
+  else if (w != NULL && !result->skip_tf)
+    reedkiln_yaml_render(run, w, result, t);
+  if (t != NULL) {
+    reedkiln_out_write(NULL, line.data, line.len);
+    reedkiln_journal_note(run, test_i, failed_tf, &line);
+    reedkiln_text_free(&line);
+  }
+  reedkiln_out_flush();
+  reedkiln_report_test(run, test_i, result, w);
+  return failed_tf;
+}
+
+/**
+ * @brief Print a test that a bail out kept from running.
+ * @param run test run configuration
+ * @param test_i index of the test
+ * @note The result stays out of the journal and the reports, so that
+ *   a resumed run still runs the test.
+ */
+void reedkiln_print_unrun(struct reedkiln_run const* run, size_t test_i) {
+  reedkiln_out_puts(NULL, "ok ");
+  reedkiln_out_ulong(NULL, (unsigned long int)(test_i+1u));
+  reedkiln_out_puts(NULL, " - ");
+  reedkiln_out_puts(NULL, run->t[test_i].name);
+  reedkiln_out_puts(NULL, " # SKIP bailed out\n");
+  reedkiln_out_flush();
+  return;
+}
+
+void reedkiln_outcome_free(struct reedkiln_outcome* result) {
+  reedkiln_text_free(&result->notes);
+  reedkiln_text_free(&result->yaml);
+  reedkiln_text_free(&result->message);
+  return;
+}
+
+/* BEGIN journal */
+unsigned long int reedkiln_bin_get32(unsigned char const* b) {
+  return (unsigned long int)b[0] | ((unsigned long int)b[1] << 8)
+    | ((unsigned long int)b[2] << 16) | ((unsigned long int)b[3] << 24);
+}
+
+/**
+ * @brief Continue the check value of a journal record.
+ * @param h check value so far, starting at 0x811c9dc5
+ * @param data bytes to add
+ * @param n number of bytes
+ * @return the new check value
+ */
+unsigned int reedkiln_journal_check
+  (unsigned int h, unsigned char const* data, size_t n)
+{
+  /* FNV-1a */
+  size_t i;
+  for (i = 0u; i < n; ++i)
+    h = (h ^ data[i]) * 0x01000193u;
+  return h;
+}
+
+/**
+ * @brief Hash the names of the selected tests.
+ * @param run test run configuration
+ * @return a hash that changes with the names and their order
+ */
+unsigned int reedkiln_journal_names(struct reedkiln_run const* run) {
+  unsigned int h = 0x811c9dc5u;
+  size_t i;
+  for (i = 0u; i < run->test_count; ++i)
+    h = reedkiln_rand_mix(h ^ reedkiln_name_hash(run->t[i].name));
+  return h;
+}
+
+/**
+ * @brief Write one journal record.
+ * @param f journal file
+ * @param kind 1 for a failed result, 0 for another result, or
+ *   one of the other `Reedkiln_Journal*` kinds
+ * @param test_i index of the test
+ * @param data TAP text of the result
+ * @param n length of the text
+ * @return zero on success, nonzero otherwise
+ * @note The record goes out in one call, so that worker threads
+ *   marking their tests cannot split a result from the main thread.
+ */
+int reedkiln_journal_write
+  ( FILE* f, unsigned int kind, size_t test_i,
+    unsigned char const* data, size_t n)
+{
+  unsigned char* const rec = (unsigned char*)malloc(n+13u);
+  int res = 0;
+  if (rec == NULL)
+    return -1;
+  /* length, check value, then the kind byte, the index and the text */
+  rec[8] = (unsigned char)kind;
+  reedkiln_bin_u32(rec+9, (unsigned long int)test_i);
+  if (n > 0u)
+    memcpy(rec+13, data, n);
+  reedkiln_bin_u32(rec, (unsigned long int)(n+5u));
+  reedkiln_bin_u32(rec+4, reedkiln_journal_check(0x811c9dc5u, rec+8, n+5u));
+  if (fwrite(rec, 1u, n+13u, f) != n+13u || fflush(f) != 0)
+    res = -1;
+  free(rec);
+  return res;
+}
+
+/**
+ * @brief Replay the tests that an earlier run left running as crashed.
+ * @param j journal with the results read so far
+ * @param run test run configuration
+ * @param state last mark of each test in the earlier run
+ * @return zero on success, nonzero otherwise
+ */
+int reedkiln_journal_crashed
+  ( struct reedkiln_journal* j, struct reedkiln_run const* run,
+    unsigned char const* state)
+{
+  size_t test_i;
+  for (test_i = 0u; test_i < run->test_count; ++test_i) {
+    struct reedkiln_text* const text = j->replay+test_i;
+    if (state[test_i] != Reedkiln_JournalStart || text->len > 0u)
+      continue;
+    if (reedkiln_text_reserve(text,
+          strlen(run->t[test_i].name) + Reedkiln_ItoAMax + 24u) != 0)
+    {
+      return -1;
+    }
+    reedkiln_out_puts(text, "not ok ");
+    reedkiln_out_ulong(text, (unsigned long int)(test_i+1u));
+    reedkiln_out_puts(text, " - ");
+    reedkiln_out_puts(text, run->t[test_i].name);
+    reedkiln_out_puts(text, " # crashed\n");
+    j->failed[test_i] = !(run->t[test_i].flags & Reedkiln_TODO);
+    j->replay_count += 1u;
+  }
+  return 0;
+}
+
+/**
+ * @brief Load the results of an earlier run, then start the journal.
+ * @param[out] j journal to fill
+ * @param run test run, whose seed changes to the earlier run's
+ * @param path journal file
+ * @return zero on success, nonzero otherwise
+ * @note A journal for another selection of tests is replaced. Reading
+ *   stops at the first torn or damaged record. A journal that the
+ *   earlier run did not close names the tests it left running, which
+ *   replay as crashed. The journal is then rewritten by way of a
+ *   temporary file, so that a failed rewrite keeps the old results.
+ */
+int reedkiln_journal_open
+  (struct reedkiln_journal* j, struct reedkiln_run* run, char const* path)
+{
+  unsigned char head[16];
+  unsigned int const names = reedkiln_journal_names(run);
+  size_t const count = run->test_count;
+  int closed_tf = 0;
+  int res = 0;
+  size_t i;
+  FILE* f;
+  unsigned char* state;
+  struct reedkiln_text temp_path = {0};
+  j->replay = (struct reedkiln_text*)calloc
+    (count ? count : 1u, sizeof(struct reedkiln_text));
+  j->failed = (unsigned char*)calloc(count ? count : 1u, 1u);
+  if (j->replay == NULL || j->failed == NULL)
+    return -1;
+  state = (unsigned char*)calloc(count ? count : 1u, 1u);
+  if (state == NULL)
+    return -1;
+  f = fopen(path, "rb");
+  if (f != NULL) {
+    if (fread(head, 1u, sizeof(head), f) == sizeof(head)
+    &&  memcmp(head, "RKJ2", 4u) == 0
+    &&  reedkiln_bin_get32(head+8) == (unsigned long int)count
+    &&  reedkiln_bin_get32(head+12) == names)
+    {
+      run->rand_seed = (unsigned int)reedkiln_bin_get32(head+4);
+      while (res == 0) {
+        unsigned char rec[13];
+        struct reedkiln_text* text;
+        size_t len, test_i;
+        if (fread(rec, 1u, sizeof(rec), f) != sizeof(rec))
+          break;
+        len = (size_t)reedkiln_bin_get32(rec);
+        test_i = (size_t)reedkiln_bin_get32(rec+9);
+        if (len < 5u || len > (1ul<<30)
+        ||  rec[8] > Reedkiln_JournalClose || test_i >= count)
+        {
+          break;
+        }
+        if (rec[8] >= Reedkiln_JournalStart) {
+          /* marks carry no text */
+          if (len != 5u || reedkiln_journal_check
+                (0x811c9dc5u, rec+8, 5u) != reedkiln_bin_get32(rec+4))
+          {
+            break;
+          } else if (rec[8] == Reedkiln_JournalClose)
+            closed_tf = 1;
+          else state[test_i] = rec[8];
+          continue;
+        }
+        /* read the text in place, to keep only if the record is whole */
+        text = j->replay+test_i;
+        if (len == 5u || text->len > 0u)
+          break;
+        else if (reedkiln_text_reserve(text, len-5u) != 0) {
+          res = -1;
+          break;
+        } else if (fread(text->data, 1u, len-5u, f) != len-5u
+          ||  reedkiln_journal_check(reedkiln_journal_check
+                (0x811c9dc5u, rec+8, 5u), text->data, len-5u)
+              != reedkiln_bin_get32(rec+4))
+        {
+          break;
+        }
+        text->len = len-5u;
+        j->failed[test_i] = rec[8];
+        j->replay_count += 1u;
+      }
+    }
+    fclose(f);
+  }
+  /* unless the earlier run stopped on its own, a test left running
+   * crashed it */
+  if (res == 0 && !closed_tf)
+    res = reedkiln_journal_crashed(j, run, state);
+  free(state);
+  if (res != 0)
+    return -1;
+  /* rewrite the journal with only the whole results */
+  reedkiln_out_puts(&temp_path, path);
+  reedkiln_out_puts(&temp_path, ".tmp");
+  reedkiln_out_write(&temp_path, "", 1u);
+  if (temp_path.len != strlen(path)+5u) {
+    reedkiln_text_free(&temp_path);
+    return -1;
+  }
+  f = fopen((char const*)temp_path.data, "wb");
+  if (f == NULL) {
+    reedkiln_text_free(&temp_path);
+    return -1;
+  }
+  memcpy(head, "RKJ2", 4u);
+  reedkiln_bin_u32(head+4, run->rand_seed);
+  reedkiln_bin_u32(head+8, (unsigned long int)count);
+  reedkiln_bin_u32(head+12, names);
+  if (fwrite(head, 1u, sizeof(head), f) != sizeof(head))
+    res = -1;
+  for (i = 0u; i < count && res == 0; ++i) {
+    if (j->replay[i].len > 0u
+    &&  reedkiln_journal_write(f, j->failed[i], i,
+          j->replay[i].data, j->replay[i].len) != 0)
+    {
+      res = -1;
+    }
+  }
+  if (fclose(f) != 0 || res != 0) {
+    remove((char const*)temp_path.data);
+    reedkiln_text_free(&temp_path);
+    return -1;
+  }
+  /* some systems refuse to rename over an existing file */
+  if (rename((char const*)temp_path.data, path) != 0
+  &&  (remove(path) != 0
+    || rename((char const*)temp_path.data, path) != 0))
+  {
+    remove((char const*)temp_path.data);
+    reedkiln_text_free(&temp_path);
+    return -1;
+  }
+  reedkiln_text_free(&temp_path);
+  j->f = fopen(path, "ab");
+  return j->f == NULL ? -1 : 0;
+}
+
+int reedkiln_journal_hit(struct reedkiln_run const* run, size_t test_i) {
+  return run->journal != NULL && run->journal->replay != NULL
+    && run->journal->replay[test_i].len > 0u;
+}
+
+/**
+ * @brief Note in the journal that a test is about to run or returned.
+ * @param run test run configuration
+ * @param test_i index of the test
+ * @param kind `Reedkiln_JournalStart` or `Reedkiln_JournalFinish`
+ * @note If the process dies before the journal closes, the next run
+ *   replays a test that started but never returned as crashed instead
+ *   of running it again. Repeated runs keep no such notes, as their
+ *   results come only at the end.
+ */
+void reedkiln_journal_mark
+  (struct reedkiln_run const* run, size_t test_i, unsigned int kind)
+{
+  struct reedkiln_journal* const j = run->journal;
+  if (j == NULL || j->f == NULL || run->repeat != NULL
+  ||  reedkiln_entry_skips(run, test_i))
+  {
+    return;
+  }
+  (void)reedkiln_journal_write(j->f, kind, test_i, NULL, 0u);
+  return;
+}
+
+/**
+ * @brief Add a printed result to the journal.
+ * @param run test run configuration
+ * @param test_i index of the test
+ * @param failed_tf whether the result counts as a failure
+ * @param text TAP text of the result
+ */
+void reedkiln_journal_note
+  ( struct reedkiln_run const* run, size_t test_i, int failed_tf,
+    struct reedkiln_text const* text)
+{
+  struct reedkiln_journal* const j = run->journal;
+  if (j == NULL)
+    return;
+  if (j->f != NULL && reedkiln_journal_write
+        (j->f, failed_tf ? 1u : 0u, test_i, text->data, text->len) != 0)
+  {
+    /* keep the file open for threads that note started tests */
+    j->error_tf = 1;
+  }
+  j->done += 1u;
+  return;
+}
+
+/**
+ * @brief Close the journal.
+ * @param j journal to close
+ * @param path journal file
+ * @param test_count number of selected tests
+ * @return zero on success, nonzero if the journal could not be written
+ * @note Once every selected test has a result, the journal is
+ *   removed, so that the next run starts over. Otherwise it ends with
+ *   a record that tells the next run that no test crashed.
+ */
+int reedkiln_journal_close
+  (struct reedkiln_journal* j, char const* path, size_t test_count)
+{
+  int res = 0;
+  size_t i;
+  if (j->f == NULL)
+    res = -1;
+  else {
+    if (j->done < test_count && !j->error_tf
+    &&  reedkiln_journal_write(j->f, Reedkiln_JournalClose, 0u, NULL, 0u)
+        != 0)
+    {
+      j->error_tf = 1;
+    }
+    if (fclose(j->f) != 0 || j->error_tf)
+      res = -1;
+    else if (j->done >= test_count)
+      remove(path);
+  }
+  j->f = NULL;
+  for (i = 0u; j->replay != NULL && i < test_count; ++i)
+    reedkiln_text_free(j->replay+i);
+  free(j->replay);
+  free(j->failed);
+  j->replay = NULL;
+  j->failed = NULL;
+  j->replay_count = 0u;
+  return res;
+}
+/* END   journal */
+
+/* BEGIN repeat */
+/**
+ * @brief Keep a copy of a test's result for its summary.
+ * @param run test run configuration
+ * @param[out] keep outcome to replace
+ * @param result outcome to copy
+ * @param w worker that ran the test, or NULL if the outcome
+ *   already holds its YAML block and log text
+ */
+void reedkiln_repeat_keep
+  ( struct reedkiln_run const* run, struct reedkiln_outcome* keep,
+    struct reedkiln_outcome const* result, struct reedkiln_worker* w)
+{
+  reedkiln_outcome_free(keep);
+  keep->res = result->res;
+  keep->skip_tf = result->skip_tf;
+  keep->bail_tf = 0;
+  keep->direct_text = result->direct_text;
+  keep->seed = result->seed;
+  keep->timing = result->timing;
+  keep->allocs = result->allocs;
+  keep->perf = result->perf;
+  if (result->notes.len > 0u)
+    reedkiln_out_write(&keep->notes, result->notes.data, result->notes.len);
+  if (result->yaml.len > 0u)
+    reedkiln_out_write(&keep->yaml, result->yaml.data, result->yaml.len);
+  else if (w != NULL && !result->skip_tf)
+    reedkiln_yaml_render(run, w, result, &keep->yaml);
+  if (result->message.len > 0u) {
+    reedkiln_out_write
+      (&keep->message, result->message.data, result->message.len);
+  } else if (w != NULL && !result->skip_tf
+    &&  Reedkiln_Atomic_Get(&w->log.pos) > 0)
+  {
+    reedkiln_log_merge(&w->log, &keep->message, 1);
+  }
+  return;
+}
+
+/**
+ * @brief Add a test's result to its totals instead of printing it.
+ * @param run test run configuration
+ * @param test_i index of the test
+ * @param result outcome of the test
+ * @param w worker that ran the test, or NULL
+ * @return nonzero if the result counts as a failure
+ * @note The first failure of each test prints a comment with the
+ *   random seed that reproduces it.
+ */
+int reedkiln_repeat_note
+  ( struct reedkiln_run const* run, size_t test_i,
+    struct reedkiln_outcome const* result, struct reedkiln_worker* w)
+{
+  struct reedkiln_repeat* const r = run->repeat;
+  struct reedkiln_repeat_stat* const st = r->stats+test_i;
+  int const bad_tf =
+    (result->res != Reedkiln_OK && result->res != Reedkiln_IGNORE);
+  int const failed_tf = bad_tf && !(run->t[test_i].flags & Reedkiln_TODO);
+  if (reedkiln_journal_hit(run, test_i))
+    return 0;
+  if (!result->skip_tf) {
+    double const ms = result->timing.setup_ms
+      + result->timing.test_ms + result->timing.teardown_ms;
+    double const delta = ms - st->mean_ms;
+    st->runs += 1u;
+    st->mean_ms += delta/(double)st->runs;
+    st->m2_ms += delta*(ms - st->mean_ms);
+    if (st->runs == 1u || ms < st->min_ms)
+      st->min_ms = ms;
+    if (st->runs == 1u || ms > st->max_ms)
+      st->max_ms = ms;
+  }
+  if (bad_tf) {
+    st->failures += 1u;
+    if (st->failures == 1u) {
+      char buf[Reedkiln_ItoXMax+8];
+      st->fail_iteration = r->iteration;
+      st->fail_seed = run->rand_seed;
+      reedkiln_repeat_keep(run, r->keep+test_i, result, w);
+      reedkiln_out_puts(NULL, "# ");
+      reedkiln_out_ulong(NULL, (unsigned long int)(test_i+1u));
+      reedkiln_out_puts(NULL, " - ");
+      reedkiln_out_puts(NULL, run->t[test_i].name);
+      reedkiln_out_puts(NULL, " failed in iteration ");
+      reedkiln_out_ulong(NULL, r->iteration);
+      sprintf(buf, "%#x", run->rand_seed);
+      reedkiln_out_puts(NULL, "; reproduce with -s ");
+      reedkiln_out_puts(NULL, buf);
+      reedkiln_out_puts(NULL, "\n");
+      reedkiln_out_flush();
+    }
+  } else if (st->failures == 0u)
+    reedkiln_repeat_keep(run, r->keep+test_i, result, w);
+  if (failed_tf)
+    r->failed_tf = 1;
+  return failed_tf;
+}
+
+/**
+ * @brief Start the next iteration of a repeated run.
+ * @param run test run to reseed
+ * @return nonzero if another iteration should run, zero otherwise
+ */
+int reedkiln_repeat_next(struct reedkiln_run* run) {
+  struct reedkiln_repeat* const r = run->repeat;
+  if (r == NULL || r->bail_tf
+  ||  (r->until_fail_tf && r->failed_tf)
+  ||  (r->count > 0u && r->iteration >= r->count))
+  {
+    return 0;
+  }
+  r->iteration += 1u;
+  /* the first iteration keeps the printed seed; later ones derive theirs */
+  if (r->iteration > 1u) {
+    run->rand_seed = reedkiln_rand_mix(r->base_seed
+      ^ reedkiln_rand_mix((unsigned int)r->iteration*0x9e3779b9u));
+  }
+  return 1;
+}
+
+/**
+ * @brief Print one summary result per test of a repeated run.
+ * @param run test run to finish
+ * @return nonzero if any summary counts as a failure
+ * @note Each summary carries the first failure of its test, if any,
+ *   with counts and wall times across the iterations in its YAML block.
+ */
+int reedkiln_repeat_finish(struct reedkiln_run* run) {
+  struct reedkiln_repeat* const r = run->repeat;
+  int failed_tf = 0;
+  size_t test_i;
+  if (r->bail_tf)
+    return 1;
+  run->rand_seed = r->base_seed;
+  r->final_tf = 1;
+  for (test_i = 0u; test_i < run->test_count; ++test_i) {
+    struct reedkiln_repeat_stat const* const st = r->stats+test_i;
+    struct reedkiln_outcome* const keep = r->keep+test_i;
+    struct reedkiln_text* const y = &keep->yaml;
+    if (st->runs > 0u) {
+      char buf[Reedkiln_ItoXMax+32];
+      if (y->len >= 6u && memcmp(y->data+(y->len-6u), "  ...\n", 6u) == 0)
+        y->len -= 6u;
+      else if (y->len == 0u) {
+        sprintf(buf, "  ---\n  seed: %#x\n", keep->seed);
+        reedkiln_out_puts(y, buf);
+      }
+      reedkiln_out_puts(y, "  repeat:\n    iterations: ");
+      reedkiln_out_ulong(y, r->iteration);
+      reedkiln_out_puts(y, "\n    runs: ");
+      reedkiln_out_ulong(y, st->runs);
+      reedkiln_out_puts(y, "\n    failures: ");
+      reedkiln_out_ulong(y, st->failures);
+      if (st->failures > 0u) {
+        reedkiln_out_puts(y, "\n    first_failure: ");
+        reedkiln_out_ulong(y, st->fail_iteration);
+        sprintf(buf, "\n    failed_random_seed: %#x", st->fail_seed);
+        reedkiln_out_puts(y, buf);
+      }
+      reedkiln_out_puts(y, "\n    wall_ms:\n      min: ");
+      reedkiln_out_double(y, st->min_ms);
+      reedkiln_out_puts(y, "\n      mean: ");
+      reedkiln_out_double(y, st->mean_ms);
+      reedkiln_out_puts(y, "\n      stddev: ");
+      reedkiln_out_double(y, (st->runs > 1u)
+        ? reedkiln_sqrt(st->m2_ms/(double)(st->runs-1u)) : 0.0);
+      reedkiln_out_puts(y, "\n      max: ");
+      reedkiln_out_double(y, st->max_ms);
+      reedkiln_out_puts(y, "\n  ...\n");
+    }
+    if (keep->direct_text == NULL) {
+      /* never ran, as in a test replayed from the journal */
+      keep->skip_tf = 1;
+      keep->direct_text = reedkiln_outcome_directive(run, test_i, keep->res);
+    }
+    if (reedkiln_print_result(run, test_i, keep, NULL))
+      failed_tf = 1;
+  }
+  return failed_tf;
+}
+
+void reedkiln_repeat_free(struct reedkiln_repeat* r, size_t count) {
+  size_t i;
+  if (r->keep != NULL) {
+    for (i = 0u; i < count; ++i)
+      reedkiln_outcome_free(r->keep+i);
+  }
+  free(r->keep);
+  free(r->stats);
+  r->keep = NULL;
+  r->stats = NULL;
+  return;
+}
+/* END   repeat */
+
+/* BEGIN shuffle */
+/**
+ * @brief Draw a new run order from the run's random seed.
+ * @param run test run with order arrays to fill
+ */
+void reedkiln_shuffle(struct reedkiln_run* run) {
+  size_t const count = run->test_count;
+  unsigned int const key = reedkiln_rand_mix(run->rand_seed ^ 0x5f3759dfu);
+  size_t i;
+  for (i = 0u; i < count; ++i)
+    run->order[i] = i;
+  /* Fisher-Yates, with each swap drawn apart from the tests' streams */
+  for (i = count; i > 1u; --i) {
+    size_t const j = (size_t)reedkiln_rand_mix
+      (key ^ reedkiln_rand_mix((unsigned int)i*0x9e3779b9u)) % i;
+    size_t const tmp = run->order[i-1u];
+    run->order[i-1u] = run->order[j];
+    run->order[j] = tmp;
+  }
+  return;
+}
+
+size_t reedkiln_run_order(struct reedkiln_run const* run, size_t pos) {
+  return (run->order != NULL) ? run->order[pos] : pos;
+}
+
+/**
+ * @brief Find the box of the next test to run.
+ * @param run test run configuration
+ * @param pos run position of the current test
+ * @return the box of the first later test that does not skip, or NULL
+ */
+struct reedkiln_box const* reedkiln_run_next_box
+  (struct reedkiln_run const* run, size_t pos)
+{
+  for (++pos; pos < run->test_count; ++pos) {
+    size_t const test_i = reedkiln_run_order(run, pos);
+    if (!reedkiln_entry_skips(run, test_i))
+      return run->t[test_i].box;
+  }
+  return NULL;
+}
+
+/**
+ * @brief Run tests on this thread in the run order.
+ * @param run test run configuration
+ * @param[out] total_res exit code to update on failure
+ * @return zero if the tests ran, nonzero if out of memory
+ * @note Results still print in table order, so each result waits
+ *   for the tests before it in the table. On a bail out, the tests
+ *   before it in the table print first, skipped if they did not run,
+ *   and the tests after it never print.
+ */
+int reedkiln_order_main(struct reedkiln_run const* run, int* total_res) {
+  struct reedkiln_worker* const w = &reedkiln_worker_main;
+  size_t const count = run->test_count;
+  unsigned int const capture_tf = w->capture_tf;
+  struct reedkiln_outcome* results;
+  unsigned char* done;
+  size_t pos;
+  size_t print_i = 0u;
+  size_t bail_i = count;
+  results = (struct reedkiln_outcome*)calloc
+    (count ? count : 1u, sizeof(struct reedkiln_outcome));
+  done = (unsigned char*)calloc(count ? count : 1u, 1u);
+  if (results == NULL || done == NULL) {
+    free(done);
+    free(results);
+    return 1;
+  }
+  w->capture_tf = 1u;
+  for (pos = 0u; pos < count; ++pos) {
+    size_t const test_i = run->order[pos];
+    struct reedkiln_outcome* const result = results+test_i;
+    reedkiln_journal_mark(run, test_i, Reedkiln_JournalStart);
+    reedkiln_run_entry(run, w, pos, result);
+    reedkiln_journal_mark(run, test_i, Reedkiln_JournalFinish);
+    w->notes = NULL;
+    if (!result->skip_tf && !result->bail_tf) {
+      reedkiln_yaml_render(run, w, result, &result->yaml);
+      reedkiln_report_capture(w, result);
+    }
+    done[test_i] = 1u;
+    if (result->bail_tf) {
+      bail_i = test_i;
+      break;
+    }
+    for (; print_i < count && done[print_i]; ++print_i) {
+      if (reedkiln_print_result(run, print_i, results+print_i, NULL))
+        *total_res = EXIT_FAILURE;
+      reedkiln_outcome_free(results+print_i);
+    }
+  }
+  if (bail_i < count) {
+    /* fill in the table up to the bail out, as an unshuffled run would */
+    for (; print_i < bail_i; ++print_i) {
+      if (done[print_i])
+        (void)reedkiln_print_result(run, print_i, results+print_i, NULL);
+      else reedkiln_print_unrun(run, print_i);
+    }
+    (void)reedkiln_print_result(run, bail_i, results+bail_i, NULL);
+    *total_res = EXIT_FAILURE;
+  }
+  for (pos = 0u; pos < count; ++pos)
+    reedkiln_outcome_free(results+pos);
+  w->capture_tf = capture_tf;
+  free(done);
+  free(results);
+  return 0;
+}
+/* END   shuffle */
+
+/* BEGIN subtests */
+/**
+ * @brief Subtest result waiting to print.
+ */
+struct reedkiln_subresult {
+  int res;
+  int bail_tf;
+  /** @brief Diagnostics, result line and YAML block, not yet indented. */
+  struct reedkiln_text text;
+};
+
+/**
+ * @brief Subtests shared between threads.
+ */
+struct reedkiln_subgroup {
+  struct reedkiln_worker* parent;
+  struct reedkiln_entry const* t;
+  void* p;
+  size_t count;
+  /** @brief Number of subtests the parent printed before this group. */
+  unsigned int base;
+  struct reedkiln_subresult* results;
+  Reedkiln_Atomic_tag unsigned int next;
+};
+
+#if defined(Reedkiln_Threads)
+struct reedkiln_subtest_job {
+  struct reedkiln_subgroup* group;
+  thrd_t thread;
+};
+#endif /*Reedkiln_Threads*/
+
+struct reedkiln_worker* reedkiln_subworker_new
+  (struct reedkiln_worker* parent)
+{
+  struct reedkiln_worker* const sub =
+    (struct reedkiln_worker*)malloc(sizeof(struct reedkiln_worker));
+  if (sub == NULL)
+    return NULL;
+  memset(sub, 0, sizeof(struct reedkiln_worker));
+  reedkiln_worker_init(sub, &parent->vtable);
+  sub->parent = parent;
+  return sub;
+}
+
+void reedkiln_subworker_free(struct reedkiln_worker* sub) {
+  reedkiln_log_free(sub);
+  free(sub);
+  return;
+}
+
+void reedkiln_out_indent
+  (struct reedkiln_text* t, unsigned char const* data, size_t n)
+{
+  size_t i = 0u;
+  while (i < n) {
+    size_t end = i;
+    while (end < n && data[end] != '\n')
+      end += 1u;
+    if (end < n)
+      end += 1u;
+    reedkiln_out_puts(t, "    ");
+    reedkiln_out_write(t, data+i, end-i);
+    i = end;
+  }
+  return;
+}
+
+void reedkiln_subtest_plan(struct reedkiln_worker* w) {
+  if (w->subtest_count > 0u && !w->bail_tf) {
+    reedkiln_out_puts(w->notes, "    1..");
+    reedkiln_out_ulong(w->notes, w->subtest_count);
+    reedkiln_out_puts(w->notes, "\n");
+  }
+  return;
+}
+
+/**
+ * @brief Run one subtest and render its result.
+ * @param sub worker to run the subtest on
+ * @param test the subtest
+ * @param p to pass to the callback
+ * @param number subtest number to print
+ * @param[out] out result to fill
+ */
+void reedkiln_subtest_run
+  ( struct reedkiln_worker* sub, struct reedkiln_entry const* test,
+    void* p, unsigned int number, struct reedkiln_subresult* out)
+{
+  struct reedkiln_worker* const parent = sub->parent;
+  struct reedkiln_text notes = {0};
+  unsigned int seed = 0u;
+  int res = Reedkiln_OK;
+  int log_tf = 0;
+  out->bail_tf = 0;
+  if (!(test->flags & Reedkiln_SKIP)) {
+    /* the caller's thread state comes back after the subtest */
+    struct reedkiln_worker* const outer = reedkiln_worker_tls;
+    struct reedkiln_randtls const outer_rand = reedkiln_rand_tls;
+    struct reedkiln_logtls const outer_log = reedkiln_log_tls;
+    reedkiln_worker_tls = sub;
+    sub->notes = &notes;
+    sub->bail_tf = 0u;
+    sub->quiet_tf = parent->quiet_tf;
+    sub->vtable = parent->vtable;
+    sub->test_name = test->name;
+    sub->subtest_count = 0u;
+    seed = reedkiln_test_seed(parent->rand_seed, test->name);
+    reedkiln_srand(seed);
+    reedkiln_log_reset(sub);
+    sub->log.conf = parent->log.conf;
+    sub->running_tf = 1u;
+    res = reedkiln_run_test(test->cb, p);
+    reedkiln_subtest_plan(sub);
+    sub->running_tf = 0u;
+    out->bail_tf = (sub->bail_tf != 0u);
+    log_tf = (Reedkiln_Atomic_Get(&sub->log.pos) > 0);
+    reedkiln_worker_tls = outer;
+    reedkiln_rand_tls = outer_rand;
+    reedkiln_log_tls = outer_log;
+  }
+  out->res = res;
+  if (out->bail_tf) {
+    /* keep only the diagnostics, which end with the bail out */
+    out->text = notes;
+    return;
+  }
+  if (notes.len > 0u)
+    reedkiln_out_write(&out->text, notes.data, notes.len);
+  reedkiln_text_free(&notes);
+  reedkiln_out_puts(&out->text,
+    (res == Reedkiln_OK || res == Reedkiln_IGNORE) ? "ok " : "not ok ");
+  reedkiln_out_ulong(&out->text, number);
+  reedkiln_out_puts(&out->text, " - ");
+  reedkiln_out_puts(&out->text, test->name);
+  reedkiln_out_puts(&out->text, (res == Reedkiln_IGNORE)
+    ? " # SKIP at runtime" : reedkiln_entry_directive(test));
+  reedkiln_out_puts(&out->text, "\n");
+  if (log_tf || (res != Reedkiln_OK && res != Reedkiln_IGNORE)) {
+    char buf[Reedkiln_ItoXMax+8];
+    reedkiln_out_puts(&out->text, "  ---\n");
+    sprintf(buf, "  seed: %#x\n", seed);
+    reedkiln_out_puts(&out->text, buf);
+    if (log_tf) {
+      reedkiln_out_puts(&out->text, "  message: \"");
+      reedkiln_log_merge(&sub->log, &out->text, 0);
+      reedkiln_out_puts(&out->text, "\"\n");
+    }
+    reedkiln_out_puts(&out->text, "  ...\n");
+  }
+  return;
+}
+
+/**
+ * @brief Run subtests from a group until none are left.
+ * @param group subtests to share
+ * @param sub worker for the calling thread
+ */
+void reedkiln_subtest_loop
+  (struct reedkiln_subgroup* group, struct reedkiln_worker* sub)
+{
+  for (;;) {
+    unsigned int const i = Reedkiln_Atomic_Add(&group->next, 1u);
+    if (i >= group->count
+    ||  Reedkiln_Atomic_Get(&reedkiln_bail_status) != Reedkiln_OK)
+    {
+      break;
+    }
+    reedkiln_subtest_run
+      (sub, group->t+i, group->p, group->base+i+1u, group->results+i);
+  }
+  return;
+}
+
+#if defined(Reedkiln_Threads)
+static int reedkiln_subtest_work(void* arg) {
+  struct reedkiln_subtest_job* const job = (struct reedkiln_subtest_job*)arg;
+  struct reedkiln_worker* const sub =
+    reedkiln_subworker_new(job->group->parent);
+  /* without a worker, leave the subtests to the other threads */
+  if (sub == NULL)
+    return -1;
+  reedkiln_subtest_loop(job->group, sub);
+  reedkiln_subworker_free(sub);
+  return 0;
+}
+#endif /*Reedkiln_Threads*/
+
+int reedkiln_subtests
+  (struct reedkiln_entry const* t, void* p, unsigned int jobs)
+{
+  struct reedkiln_worker* const parent = reedkiln_worker_get();
+  struct reedkiln_subgroup group;
+  struct reedkiln_worker* sub;
+  struct reedkiln_subresult const* bail = NULL;
+  int res = Reedkiln_OK;
+  size_t i;
+  reedkiln_timeout_check(parent);
+  group.parent = parent;
+  group.t = t;
+  group.p = p;
+  group.count = reedkiln_entry_count(t);
+  group.base = parent->subtest_count;
+  Reedkiln_Atomic_Put(&group.next, 0u);
+  group.results = (struct reedkiln_subresult*)calloc
+    (group.count ? group.count : 1u, sizeof(struct reedkiln_subresult));
+  sub = reedkiln_subworker_new(parent);
+  if (group.results == NULL || sub == NULL) {
+    free(group.results);
+    free(sub);
+    reedkiln_out_puts(parent->notes, "## cannot allocate the subtests\n");
+    reedkiln_fail();
+  }
+  if (jobs == 0u)
+    jobs = reedkiln_cpu_count();
+  if (jobs > group.count)
+    jobs = (unsigned int)group.count;
+  /* run */{
+#if defined(Reedkiln_Threads)
+    struct reedkiln_subtest_job job[Reedkiln_SubtestJobs];
+    unsigned int started;
+    if (jobs > Reedkiln_SubtestJobs)
+      jobs = Reedkiln_SubtestJobs;
+    /* the calling thread takes part */
+    for (started = 0u; started+1u < jobs; ++started) {
+      job[started].group = &group;
+      if (thrd_create(&job[started].thread, reedkiln_subtest_work,
+            job+started) != thrd_success)
+      {
+        break;
+      }
+    }
+#endif /*Reedkiln_Threads*/
+    reedkiln_subtest_loop(&group, sub);
+#if defined(Reedkiln_Threads)
+    while (started > 0u) {
+      started -= 1u;
+      thrd_join(job[started].thread, NULL);
+    }
+#endif /*Reedkiln_Threads*/
+  }
+  reedkiln_subworker_free(sub);
+  /* print in order, up to the first bail out */
+  for (i = 0u; i < group.count; ++i) {
+    struct reedkiln_subresult const* const r = group.results+i;
+    if (r->bail_tf) {
+      bail = r;
+      break;
+    }
+    if (r->res != Reedkiln_OK && r->res != Reedkiln_IGNORE
+    &&  !(t[i].flags & Reedkiln_TODO))
+    {
+      res = Reedkiln_NOT_OK;
+    }
+    if (parent->quiet_tf)
+      continue;
+    if (parent->subtest_count == 0u) {
+      reedkiln_out_puts(parent->notes, "    # Subtest: ");
+      reedkiln_out_puts(parent->notes, parent->test_name);
+      reedkiln_out_puts(parent->notes, "\n");
+    }
+    parent->subtest_count += 1u;
+    reedkiln_out_indent(parent->notes, r->text.data, r->text.len);
+  }
+  if (bail != NULL) {
+    reedkiln_out_write(parent->notes, bail->text.data, bail->text.len);
+    Reedkiln_Atomic_Put(&parent->next_status, Reedkiln_NOT_OK);
+    parent->bail_tf = 1u;
+  }
+  for (i = 0u; i < group.count; ++i)
+    reedkiln_text_free(&group.results[i].text);
+  free(group.results);
+  if (bail != NULL) {
+    (*parent->vtable.fail_cb)();
+    abort()/* in case the above doesn't work */;
+  }
+  if (res != Reedkiln_OK)
+    Reedkiln_Atomic_Put(&parent->next_status, Reedkiln_NOT_OK);
+  reedkiln_timeout_check(parent);
+  return res;
+}
+
+int reedkiln_subtest(char const* name, reedkiln_cb cb, void* p) {
+  struct reedkiln_entry t[2];
+  memset(t, 0, sizeof(t));
+  t[0].name = name;
+  t[0].cb = cb;
+  return reedkiln_subtests(t, p, 1u);
+}
+/* END   subtests */
+
+/* BEGIN watchdog */
+/**
+ * @brief Find the time limit for a test.
+ * @param run test run configuration
+ * @param test_i index of the test
+ * @return a timeout in milliseconds, or zero for none
+ */
+unsigned long int reedkiln_entry_timeout
+  (struct reedkiln_run const* run, size_t test_i)
+{
+  struct reedkiln_box const* const box = run->t[test_i].box;
+  if (box != NULL && box->timeout_ms > 0u)
+    return box->timeout_ms;
+  else return run->timeout_ms;
+}
+
+int reedkiln_timeouts_used(struct reedkiln_run const* run) {
+  size_t i;
+  if (run->timeout_ms > 0u)
+    return 1;
+  for (i = 0u; i < run->test_count; ++i) {
+    if (reedkiln_entry_timeout(run, i) > 0u)
+      return 1;
+  }
+  return 0;
+}
+
+void reedkiln_timeout_note
+  (struct reedkiln_worker* w, unsigned long int timeout_ms)
+{
+  reedkiln_out_puts(w->notes, "## timeout: test exceeded ");
+  reedkiln_out_ulong(w->notes, timeout_ms);
+  reedkiln_out_puts(w->notes, " ms\n");
+  return;
+}
+
+/**
+ * @brief Fail the current test if the watchdog found it overdue.
+ * @param w the current worker
+ */
+void reedkiln_timeout_check(struct reedkiln_worker* w) {
+  struct reedkiln_worker const* up;
+  /* the test notes the timeout once its subtests return */
+  for (up = w->parent; up != NULL; up = up->parent) {
+    if (Reedkiln_Atomic_Get(&up->timeout_tf) != 0u)
+      reedkiln_fail();
+  }
+  if (Reedkiln_Atomic_Get(&w->timeout_tf) == 1u) {
+    Reedkiln_Atomic_Put(&w->timeout_tf, 2u);
+    reedkiln_timeout_note(w, w->watch.timeout_ms);
+    reedkiln_fail();
+  }
+  return;
+}
+
+#if defined(Reedkiln_Threads)
+/**
+ * @brief Thread that watches running tests for overdue deadlines.
+ */
+struct reedkiln_watchdog {
+  mtx_t lock;
+  cnd_t cond;
+  thrd_t thread;
+  int active_tf;
+  int stop_tf;
+  /** @brief Workers that have run a watched test. */
+  struct reedkiln_worker* list;
+};
+
+static struct reedkiln_watchdog reedkiln_watchdog_state;
+
+/**
+ * @brief Report a test that ignored its deadline, then end the run.
+ * @param w the worker stuck in the test
+ * @note A test that never returns to the library cannot be stopped
+ *   from another thread; use `--fork-workers` to keep going instead.
+ */
+static void reedkiln_watchdog_bail(struct reedkiln_worker const* w) {
+  reedkiln_out_puts(NULL, "Bail out! test ");
+  reedkiln_out_ulong(NULL, (unsigned long int)(w->watch.test_i+1u));
+  reedkiln_out_puts(NULL, " - ");
+  reedkiln_out_puts(NULL, w->watch.name);
+  reedkiln_out_puts(NULL, " is stuck past its timeout of ");
+  reedkiln_out_ulong(NULL, w->watch.timeout_ms);
+  reedkiln_out_puts(NULL, " ms; use --fork-workers to run past it\n");
+  reedkiln_out_flush();
+  _Exit(EXIT_FAILURE);
+}
+
+static int reedkiln_watchdog_work(void* arg) {
+  struct reedkiln_watchdog* const dog = (struct reedkiln_watchdog*)arg;
+  mtx_lock(&dog->lock);
+  while (!dog->stop_tf) {
+    double const now = reedkiln_clock_ns();
+    struct reedkiln_worker* w;
+    struct timespec until;
+    for (w = dog->list; w != NULL; w = w->watch.next) {
+      double const late_ns = now - w->watch.deadline_ns;
+      if (w->watch.deadline_ns <= 0.0 || late_ns < 0.0)
+        continue;
+      if (Reedkiln_Atomic_Get(&w->timeout_tf) == 0u) {
+        Reedkiln_Atomic_Put(&w->timeout_tf, 1u);
+        w->watch.flagged_ns = now;
+      } else {
+        /* allow one more timeout period from the flag, and at least
+         * the grace period on a busy machine, to reach a check point */
+        unsigned long int const grace_ms =
+          (w->watch.timeout_ms > Reedkiln_WatchGrace)
+          ? w->watch.timeout_ms : Reedkiln_WatchGrace;
+        if (now - w->watch.flagged_ns >= grace_ms*1e6)
+          reedkiln_watchdog_bail(w);
+      }
+    }
+    if (timespec_get(&until, TIME_UTC) == 0)
+      break;
+    until.tv_nsec += Reedkiln_WatchPeriod*1000000L;
+    if (until.tv_nsec >= 1000000000L) {
+      until.tv_sec += 1;
+      until.tv_nsec -= 1000000000L;
+    }
+    cnd_timedwait(&dog->cond, &dog->lock, &until);
+  }
+  mtx_unlock(&dog->lock);
+  return 0;
+}
+#endif /*Reedkiln_Threads*/
+
+/**
+ * @brief Start the watchdog thread.
+ * @return zero on success, nonzero if unavailable
+ */
+int reedkiln_watchdog_start(void) {
+#if defined(Reedkiln_Threads)
+  struct reedkiln_watchdog* const dog = &reedkiln_watchdog_state;
+  dog->stop_tf = 0;
+  dog->list = NULL;
+  if (mtx_init(&dog->lock, mtx_plain) != thrd_success)
+    return 1;
+  else if (cnd_init(&dog->cond) != thrd_success) {
+    mtx_destroy(&dog->lock);
+    return 1;
+  } else if (thrd_create(&dog->thread, reedkiln_watchdog_work, dog)
+      != thrd_success)
+  {
+    cnd_destroy(&dog->cond);
+    mtx_destroy(&dog->lock);
+    return 1;
+  }
+  dog->active_tf = 1;
+  return 0;
+#else
+  return 1;
+#endif /*Reedkiln_Threads*/
+}
+
+void reedkiln_watchdog_stop(void) {
+#if defined(Reedkiln_Threads)
+  struct reedkiln_watchdog* const dog = &reedkiln_watchdog_state;
+  if (!dog->active_tf)
+    return;
+  mtx_lock(&dog->lock);
+  dog->stop_tf = 1;
+  cnd_broadcast(&dog->cond);
+  mtx_unlock(&dog->lock);
+  thrd_join(dog->thread, NULL);
+  while (dog->list != NULL) {
+    struct reedkiln_worker* const w = dog->list;
+    dog->list = w->watch.next;
+    w->watch.next = NULL;
+    w->watch.linked_tf = 0u;
+  }
+  cnd_destroy(&dog->cond);
+  mtx_destroy(&dog->lock);
+  dog->active_tf = 0;
+#endif /*Reedkiln_Threads*/
+  return;
+}
+
+/**
+ * @brief Start watching a worker's test.
+ * @param w worker about to run the test
+ * @param test_i index of the test
+ * @param name name of the test
+ * @param timeout_ms time limit, or zero for none
+ */
+void reedkiln_watchdog_arm
+  ( struct reedkiln_worker* w, size_t test_i, char const* name,
+    unsigned long int timeout_ms)
+{
+  Reedkiln_Atomic_Put(&w->timeout_tf, 0u);
+  w->watch.timeout_ms = timeout_ms;
+#if defined(Reedkiln_Threads)
+  if (reedkiln_watchdog_state.active_tf && timeout_ms > 0u) {
+    struct reedkiln_watchdog* const dog = &reedkiln_watchdog_state;
+    mtx_lock(&dog->lock);
+    if (!w->watch.linked_tf) {
+      w->watch.next = dog->list;
+      dog->list = w;
+      w->watch.linked_tf = 1u;
+    }
+    w->watch.test_i = test_i;
+    w->watch.name = name;
+    w->watch.deadline_ns = reedkiln_clock_ns() + timeout_ms*1e6;
+    mtx_unlock(&dog->lock);
+  }
+#else
+  (void)test_i;
+  (void)name;
+#endif /*Reedkiln_Threads*/
+  return;
+}
+
+/**
+ * @brief Stop watching a worker's test.
+ * @param w worker that ran the test
+ * @return one if the test ran past its deadline without being failed
+ */
+unsigned int reedkiln_watchdog_disarm(struct reedkiln_worker* w) {
+  unsigned int late;
+#if defined(Reedkiln_Threads)
+  if (w->watch.linked_tf) {
+    struct reedkiln_watchdog* const dog = &reedkiln_watchdog_state;
+    mtx_lock(&dog->lock);
+    w->watch.deadline_ns = 0.0;
+    late = Reedkiln_Atomic_Xchg(&w->timeout_tf, 0u);
+    mtx_unlock(&dog->lock);
+    return late;
+  }
+#endif /*Reedkiln_Threads*/
+  late = Reedkiln_Atomic_Xchg(&w->timeout_tf, 0u);
+  return late;
+}
+
+/**
+ * @brief Remove a worker from the watchdog before the worker goes away.
+ * @param w worker to remove
+ */
+void reedkiln_watchdog_leave(struct reedkiln_worker* w) {
+#if defined(Reedkiln_Threads)
+  if (w->watch.linked_tf) {
+    struct reedkiln_watchdog* const dog = &reedkiln_watchdog_state;
+    struct reedkiln_worker** link;
+    mtx_lock(&dog->lock);
+    for (link = &dog->list; *link != NULL; link = &(*link)->watch.next) {
+      if (*link == w) {
+        *link = w->watch.next;
+        break;
+      }
+    }
+    w->watch.next = NULL;
+    w->watch.linked_tf = 0u;
+    mtx_unlock(&dog->lock);
+  }
+#else
+  (void)w;
+#endif /*Reedkiln_Threads*/
+  return;
+}
+/* END   watchdog */
+
+#if defined(Reedkiln_Threads)
+/* BEGIN worker pool */
+struct reedkiln_pool {
+  struct reedkiln_run const* run;
+  struct reedkiln_outcome* results;
+  unsigned char* done;
+  size_t next;
+  /** @brief Number of tests taken but not yet done. */
+  size_t running;
+  int stop_tf;
+  /** @brief Whether a worker stopped taking tests after a bail out. */
+  int bail_tf;
+  mtx_t lock;
+  cnd_t cond;
+};
+
+struct reedkiln_pool_thread {
+  struct reedkiln_pool* pool;
+  struct reedkiln_worker worker;
+  thrd_t thread;
+};
+
+static int reedkiln_pool_work(void* arg) {
+  struct reedkiln_pool_thread* const self =
+    (struct reedkiln_pool_thread*)arg;
+  struct reedkiln_pool* const pool = self->pool;
+  reedkiln_worker_tls = &self->worker;
+  for (;;) {
+    size_t pos, test_i;
+    mtx_lock(&pool->lock);
+    if (Reedkiln_Atomic_Get(&reedkiln_bail_status) != Reedkiln_OK) {
+      /* the tests not yet taken will not run */
+      pool->bail_tf = 1;
+      cnd_broadcast(&pool->cond);
+      mtx_unlock(&pool->lock);
+      break;
+    } else if (pool->stop_tf || pool->next >= pool->run->test_count) {
+      mtx_unlock(&pool->lock);
+      break;
+    }
+    pos = pool->next++;
+    pool->running += 1u;
+    test_i = reedkiln_run_order(pool->run, pos);
+    mtx_unlock(&pool->lock);
+    /* run and render */{
+      struct reedkiln_outcome* const result = pool->results+test_i;
+      reedkiln_journal_mark(pool->run, test_i, Reedkiln_JournalStart);
+      reedkiln_run_entry(pool->run, &self->worker, pos, result);
+      reedkiln_journal_mark(pool->run, test_i, Reedkiln_JournalFinish);
+      self->worker.notes = NULL;
+      if (!result->skip_tf && !result->bail_tf) {
+        reedkiln_yaml_render(pool->run, &self->worker, result, &result->yaml);
+        reedkiln_report_capture(&self->worker, result);
+      }
+    }
+    mtx_lock(&pool->lock);
+    pool->done[test_i] = 1u;
+    pool->running -= 1u;
+    cnd_broadcast(&pool->cond);
+    mtx_unlock(&pool->lock);
+  }
+  reedkiln_fixture_release(&self->worker);
+  reedkiln_perf_close(&self->worker);
+  reedkiln_watchdog_leave(&self->worker);
+  reedkiln_worker_tls = NULL;
+  return 0;
+}
+
+/**
+ * @brief Run tests across several threads.
+ * @param run test run configuration
+ * @param jobs number of worker threads
+ * @param[out] total_res exit code to update on failure
+ * @return zero if the tests ran, nonzero if the pool is unavailable
+ */
+static int reedkiln_pool_main
+  (struct reedkiln_run const* run, unsigned int jobs, int* total_res)
+{
+  struct reedkiln_pool pool;
+  struct reedkiln_pool_thread* threads;
+  unsigned int started = 0u;
+  size_t test_i;
+  pool.run = run;
+  pool.next = 0u;
+  pool.running = 0u;
+  pool.stop_tf = 0;
+  pool.bail_tf = 0;
+  pool.results = (struct reedkiln_outcome*)calloc
+    (run->test_count ? run->test_count : 1u, sizeof(struct reedkiln_outcome));
+  pool.done = (unsigned char*)calloc
+    (run->test_count ? run->test_count : 1u, 1u);
+  threads = (struct reedkiln_pool_thread*)calloc
+    (jobs, sizeof(struct reedkiln_pool_thread));
+  if (pool.results == NULL || pool.done == NULL || threads == NULL) {
+    free(threads);
+    free(pool.done);
+    free(pool.results);
+    return 1;
+  }
+  if (mtx_init(&pool.lock, mtx_plain) != thrd_success) {
+    free(threads);
+    free(pool.done);
+    free(pool.results);
+    return 1;
+  } else if (cnd_init(&pool.cond) != thrd_success) {
+    mtx_destroy(&pool.lock);
+    free(threads);
+    free(pool.done);
+    free(pool.results);
+    return 1;
+  }
+  /* the main thread keeps the main worker; other threads must attach */
+  reedkiln_worker_tls = &reedkiln_worker_main;
+  Reedkiln_Atomic_Put(&reedkiln_worker_pool_tf, 1u);
+  for (started = 0u; started < jobs; ++started) {
+    struct reedkiln_pool_thread* const th = threads+started;
+    th->pool = &pool;
+    reedkiln_worker_init(&th->worker, &run->initial_table);
+    if (thrd_create(&th->thread, reedkiln_pool_work, th) != thrd_success)
+      break;
+  }
+  if (started == 0u) {
+    Reedkiln_Atomic_Put(&reedkiln_worker_pool_tf, 0u);
+    reedkiln_worker_tls = NULL;
+    cnd_destroy(&pool.cond);
+    mtx_destroy(&pool.lock);
+    free(threads);
+    free(pool.done);
+    free(pool.results);
+    return 1;
+  }
+  /* print results in table order */
+  for (test_i = 0u; test_i < run->test_count; ++test_i) {
+    struct reedkiln_outcome* const result = pool.results+test_i;
+    int failed_tf;
+    int unrun_tf;
+    mtx_lock(&pool.lock);
+    while (!pool.done[test_i] && !(pool.bail_tf && pool.running == 0u))
+      cnd_wait(&pool.cond, &pool.lock);
+    unrun_tf = !pool.done[test_i];
+    mtx_unlock(&pool.lock);
+    if (unrun_tf) {
+      /* a shuffled run can leave it untaken behind the bail out */
+      reedkiln_print_unrun(run, test_i);
+      continue;
+    }
+    failed_tf = reedkiln_print_result(run, test_i, result, NULL);
+    reedkiln_outcome_free(result);
+    if (failed_tf)
+      *total_res = EXIT_FAILURE;
+    if (result->bail_tf)
+      break;
+  }
+  mtx_lock(&pool.lock);
+  pool.stop_tf = 1;
+  mtx_unlock(&pool.lock);
+  while (started > 0u) {
+    started -= 1u;
+    thrd_join(threads[started].thread, NULL);
+    reedkiln_log_free(&threads[started].worker);
+  }
+  Reedkiln_Atomic_Put(&reedkiln_worker_pool_tf, 0u);
+  reedkiln_worker_tls = NULL;
+  for (; test_i < run->test_count; ++test_i) {
+    reedkiln_outcome_free(pool.results+test_i);
+  }
+  cnd_destroy(&pool.cond);
+  mtx_destroy(&pool.lock);
+  free(threads);
+  free(pool.done);
+  free(pool.results);
+  return 0;
+}
+/* END   worker pool */
+#endif /*Reedkiln_Threads*/
+
+#if defined(Reedkiln_Fork)
+/* BEGIN fork pool */
+/**
+ * @brief State shared between the parent and its child workers.
+ */
+struct reedkiln_fork_shared {
+  Reedkiln_Atomic_tag unsigned int next;
+  Reedkiln_Atomic_tag unsigned int stop;
+  /** @brief One plus the index of each slot's running test, or zero. */
+  Reedkiln_Atomic_tag unsigned int current[1];
+};
+
+struct reedkiln_fork_record {
+  unsigned long int test_i;
+  int res;
+  int skip_tf;
+  int bail_tf;
+  unsigned int seed;
+  struct reedkiln_timing timing;
+  size_t notes_len;
+  size_t yaml_len;
+  size_t message_len;
+};
+
+struct reedkiln_fork_child {
+  pid_t pid;
+  int fd;
+  /** @brief Last seen value of the slot's running test. */
+  unsigned int current;
+  double since_ns;
+  /** @brief Time limit that made the parent kill this child, or zero. */
+  unsigned long int timeout_ms;
+};
+
+static int reedkiln_fork_write(int fd, void const* data, size_t n) {
+  unsigned char const* p = (unsigned char const*)data;
+  while (n > 0u) {
+    ssize_t const res = write(fd, p, n);
+    if (res < 0 && errno == EINTR)
+      continue;
+    else if (res <= 0)
+      return -1;
+    p += res;
+    n -= (size_t)res;
+  }
+  return 0;
+}
+
+static int reedkiln_fork_read(int fd, void* data, size_t n) {
+  unsigned char* p = (unsigned char*)data;
+  while (n > 0u) {
+    ssize_t const res = read(fd, p, n);
+    if (res < 0 && errno == EINTR)
+      continue;
+    else if (res <= 0)
+      return -1;
+    p += res;
+    n -= (size_t)res;
+  }
+  return 0;
+}
+
+static void reedkiln_fork_work
+  ( struct reedkiln_run const* run, struct reedkiln_fork_shared* shared,
+    unsigned int slot, int fd)
+{
+  struct reedkiln_worker* const w = &reedkiln_worker_main;
+  w->capture_tf = 1u;
+  while (!Reedkiln_Atomic_Get(&shared->stop)) {
+    unsigned int const pos = Reedkiln_Atomic_Add(&shared->next, 1u);
+    struct reedkiln_outcome result = {0};
+    struct reedkiln_fork_record record;
+    unsigned int test_i;
+    if (pos >= run->test_count)
+      break;
+    test_i = (unsigned int)reedkiln_run_order(run, pos);
+    Reedkiln_Atomic_Put(&shared->current[slot], test_i+1u);
+    reedkiln_run_entry(run, w, pos, &result);
+    w->notes = NULL;
+    if (!result.skip_tf && !result.bail_tf) {
+      reedkiln_yaml_render(run, w, &result, &result.yaml);
+      reedkiln_report_capture(w, &result);
+    }
+    if (result.bail_tf)
+      Reedkiln_Atomic_Put(&shared->stop, 1u);
+    fflush(NULL);
+    record.test_i = test_i;
+    record.res = result.res;
+    record.skip_tf = result.skip_tf;
+    record.bail_tf = result.bail_tf;
+    record.seed = result.seed;
+    record.timing = result.timing;
+    record.notes_len = result.notes.len;
+    record.yaml_len = result.yaml.len;
+    record.message_len = result.message.len;
+    if (reedkiln_fork_write(fd, &record, sizeof(record)) != 0
+    ||  reedkiln_fork_write(fd, result.notes.data, result.notes.len) != 0
+    ||  reedkiln_fork_write(fd, result.yaml.data, result.yaml.len) != 0
+    ||  reedkiln_fork_write(fd, result.message.data, result.message.len)
+          != 0)
+    {
+      break;
+    }
+    Reedkiln_Atomic_Put(&shared->current[slot], 0u);
+    reedkiln_outcome_free(&result);
+  }
+  reedkiln_fixture_release(w);
+  return;
+}
+
+static int reedkiln_fork_spawn
+  ( struct reedkiln_run const* run, struct reedkiln_fork_shared* shared,
+    unsigned int slot, struct reedkiln_fork_child* child)
+{
+  int fds[2];
+  pid_t pid;
+  if (pipe(fds) != 0)
+    return -1;
+  reedkiln_out_flush();
+  fflush(NULL);
+  pid = fork();
+  if (pid < 0) {
+    close(fds[0]);
+    close(fds[1]);
+    return -1;
+  } else if (pid == 0) {
+    close(fds[0]);
+    reedkiln_fork_work(run, shared, slot, fds[1]);
+    close(fds[1]);
+    _exit(EXIT_SUCCESS);
+  }
+  close(fds[1]);
+  child->pid = pid;
+  child->fd = fds[0];
+  child->current = 0u;
+  child->since_ns = 0.0;
+  child->timeout_ms = 0u;
+  return 0;
+}
+
+/**
+ * @brief Describe how a child worker ended.
+ * @param child the child worker, or NULL if no worker took the test
+ * @param status status from `waitpid`
+ * @param seed random seed for the test
+ * @param[out] t text to receive a YAML block
+ */
+static void reedkiln_fork_describe
+  ( struct reedkiln_fork_child const* child, int status, unsigned int seed,
+    struct reedkiln_text* t)
+{
+  char buf[Reedkiln_ItoXMax+8];
+  reedkiln_out_puts(t, "  ---\n");
+  sprintf(buf, "  seed: %#x\n", seed);
+  reedkiln_out_puts(t, buf);
+  reedkiln_out_puts(t, "  message: \"worker ");
+  if (child == NULL) {
+    reedkiln_out_puts(t, "lost before running the test");
+  } else if (child->timeout_ms > 0u) {
+    reedkiln_out_puts(t, "killed after test exceeded ");
+    reedkiln_out_ulong(t, child->timeout_ms);
+    reedkiln_out_puts(t, " ms");
+  } else if (WIFSIGNALED(status)) {
+    reedkiln_out_puts(t, "terminated by signal ");
+    reedkiln_out_ulong(t, (unsigned long int)WTERMSIG(status));
+  } else if (WIFEXITED(status)) {
+    reedkiln_out_puts(t, "exited with status ");
+    reedkiln_out_ulong(t, (unsigned long int)WEXITSTATUS(status));
+  } else {
+    reedkiln_out_puts(t, "stopped");
+  }
+  reedkiln_out_puts(t, "\"\n  ...\n");
+  return;
+}
+
+/**
+ * @brief Run tests across several child processes.
+ * @param run test run configuration
+ * @param jobs number of child processes
+ * @param[out] total_res exit code to update on failure
+ * @return zero if the tests ran, nonzero if the pool is unavailable
+ */
+static int reedkiln_fork_main
+  (struct reedkiln_run const* run, unsigned int jobs, int* total_res)
+{
+  size_t const shared_size = sizeof(struct reedkiln_fork_shared)
+    + jobs*sizeof(unsigned int);
+  size_t const count = run->test_count;
+  struct reedkiln_fork_shared* shared;
+  struct reedkiln_outcome* results;
+  unsigned char* done;
+  struct reedkiln_fork_child* children;
+  struct pollfd* polls;
+  unsigned int alive = 0u;
+  unsigned int slot;
+  size_t print_i = 0u;
+  int stop_tf = 0;
+  int const wait_ms = reedkiln_timeouts_used(run) ? Reedkiln_WatchPeriod : -1;
+  if (count >= UINT_MAX)
+    return 1;
+  shared = (struct reedkiln_fork_shared*)mmap(NULL, shared_size,
+    PROT_READ|PROT_WRITE, MAP_SHARED|MAP_ANONYMOUS, -1, 0);
+  if (shared == (struct reedkiln_fork_shared*)MAP_FAILED)
+    return 1;
+  memset(shared, 0, shared_size);
+  results = (struct reedkiln_outcome*)calloc
+    (count ? count : 1u, sizeof(struct reedkiln_outcome));
+  done = (unsigned char*)calloc(count ? count : 1u, 1u);
+  children = (struct reedkiln_fork_child*)calloc
+    (jobs, sizeof(struct reedkiln_fork_child));
+  polls = (struct pollfd*)calloc(jobs, sizeof(struct pollfd));
+  if (results == NULL || done == NULL || children == NULL || polls == NULL) {
+    free(polls);
+    free(children);
+    free(done);
+    free(results);
+    munmap(shared, shared_size);
+    return 1;
+  }
+  for (slot = 0u; slot < jobs; ++slot) {
+    children[slot].fd = -1;
+    if (reedkiln_fork_spawn(run, shared, slot, children+slot) == 0)
+      alive += 1u;
+  }
+  if (alive == 0u) {
+    free(polls);
+    free(children);
+    free(done);
+    free(results);
+    munmap(shared, shared_size);
+    return 1;
+  }
+  while (alive > 0u) {
+    unsigned int n = 0u;
+    for (slot = 0u; slot < jobs; ++slot) {
+      polls[slot].fd = children[slot].fd;
+      polls[slot].events = POLLIN;
+      polls[slot].revents = 0;
+    }
+    if (poll(polls, jobs, wait_ms) < 0) {
+      if (errno == EINTR)
+        continue;
+      break;
+    }
+    /* kill children stuck past a test's deadline */
+    if (wait_ms >= 0) {
+      double const now = reedkiln_clock_ns();
+      for (slot = 0u; slot < jobs; ++slot) {
+        struct reedkiln_fork_child* const child = children+slot;
+        unsigned int const current =
+          Reedkiln_Atomic_Get(&shared->current[slot]);
+        if (child->fd < 0 || child->timeout_ms > 0u)
+          continue;
+        else if (current != child->current) {
+          child->current = current;
+          child->since_ns = now;
+        } else if (current > 0u) {
+          unsigned long int const limit =
+            reedkiln_entry_timeout(run, current-1u);
+          if (limit > 0u && now - child->since_ns >= limit*1e6) {
+            kill(child->pid, SIGKILL);
+            child->timeout_ms = limit;
+          }
+        }
       }
-      return EXIT_FAILURE;
-    }
-  }
-  fprintf(stdout,"1..%lu\n", (unsigned long int)test_count);
-  fprintf(stdout,"# random_seed: %#x\n", rand_seed);
-  for (test_i = 0; test_i < test_count; ++test_i) {
-    struct reedkiln_entry const* test = t+test_i;
-    char const* result_text;
-    char const* direct_text = reedkiln_entry_directive(test);
-    int want_skip_tf = (!reedkiln_prefix_match(test->name, testname_prefix));
-    int skip_tf = ((test->flags & Reedkiln_SKIP)!= 0)
-        || want_skip_tf;
-    int res = 0;
-    if (want_skip_tf) {
-      direct_text = " # SKIP by request";
-    } else if (!skip_tf) {
-      struct reedkiln_box const* box = test->box;
-      void* box_item = NULL;
-      int box_called = 0;
-      unsigned int log_index;
-      reedkiln_srand(rand_seed);
-      reedkiln_log_reset();
-      reedkiln_vtable_c = initial_table;
-      if (box != NULL && box->setup != NULL) {
-        res = reedkiln_run_setup(box->setup, p, &box_item);
-        if (reedkiln_bail_status != Reedkiln_OK) {
-          total_res = EXIT_FAILURE;
-          break;
-        } else if (res != Reedkiln_OK) {
-          box_called = 2;
-        } else box_called = 1;
+    }
+    for (slot = 0u; slot < jobs; ++slot) {
+      struct reedkiln_fork_child* const child = children+slot;
+      struct reedkiln_fork_record record;
+      if (child->fd < 0 || polls[slot].revents == 0)
+        continue;
+      n += 1u;
+      if (reedkiln_fork_read(child->fd, &record, sizeof(record)) == 0
+      &&  record.test_i < count)
+      {
+        struct reedkiln_outcome* const result = results+record.test_i;
+        result->res = record.res;
+        result->skip_tf = record.skip_tf;
+        result->bail_tf = record.bail_tf;
+        result->seed = record.seed;
+        result->timing = record.timing;
+        if (reedkiln_text_reserve(&result->notes, record.notes_len) == 0
+        &&  reedkiln_text_reserve(&result->yaml, record.yaml_len) == 0
+        &&  reedkiln_text_reserve(&result->message, record.message_len) == 0
+        &&  reedkiln_fork_read(child->fd, result->notes.data,
+              record.notes_len) == 0
+        &&  reedkiln_fork_read(child->fd, result->yaml.data,
+              record.yaml_len) == 0
+        &&  reedkiln_fork_read(child->fd, result->message.data,
+              record.message_len) == 0)
+        {
+          result->notes.len = record.notes_len;
+          result->yaml.len = record.yaml_len;
+          result->message.len = record.message_len;
+          result->direct_text = reedkiln_outcome_directive
+            (run, record.test_i, record.res);
+          done[record.test_i] = 1u;
+          continue;
+        }
+      }
+      /* child worker ended */{
+        int status = 0;
+        unsigned int const current =
+          Reedkiln_Atomic_Get(&shared->current[slot]);
+        close(child->fd);
+        child->fd = -1;
+        alive -= 1u;
+        while (waitpid(child->pid, &status, 0) < 0 && errno == EINTR)
+          continue;
+        if (current > 0u && !done[current-1u]) {
+          struct reedkiln_outcome* const result = results+(current-1u);
+          result->res = Reedkiln_NOT_OK;
+          result->seed = reedkiln_entry_seed(run, current-1u);
+          result->direct_text =
+            reedkiln_outcome_directive(run, current-1u, Reedkiln_NOT_OK);
+          reedkiln_fork_describe(child, status, result->seed, &result->yaml);
+          done[current-1u] = 1u;
+          Reedkiln_Atomic_Put(&shared->current[slot], 0u);
+        }
+        /* replace the worker while tests remain for it */
+        if (!stop_tf && !Reedkiln_Atomic_Get(&shared->stop)
+        &&  Reedkiln_Atomic_Get(&shared->next) < count
+        &&  reedkiln_fork_spawn(run, shared, slot, child) == 0)
+        {
+          alive += 1u;
+        }
       }
-      if (box_called <= 1)
-        res = reedkiln_run_test(test->cb, box_called ? box_item : p);
-      if (box_called == 1 && box->teardown != NULL) {
-        (*box->teardown)(box_item);
+    }
+    /* print results in table order */
+    for (; !stop_tf && print_i < count && done[print_i]; ++print_i) {
+      struct reedkiln_outcome* const result = results+print_i;
+      if (reedkiln_print_result(run, print_i, result, NULL))
+        *total_res = EXIT_FAILURE;
+      reedkiln_outcome_free(result);
+      if (result->bail_tf) {
+        stop_tf = 1;
+        Reedkiln_Atomic_Put(&shared->stop, 1u);
+        for (slot = 0u; slot < jobs; ++slot) {
+          if (children[slot].fd >= 0)
+            kill(children[slot].pid, SIGKILL);
+        }
       }
     }
-    if (reedkiln_bail_status != Reedkiln_OK) {
-      total_res = EXIT_FAILURE;
+    if (n == 0u && wait_ms < 0)
       break;
+  }
+  for (slot = 0u; slot < jobs; ++slot) {
+    if (children[slot].fd >= 0) {
+      close(children[slot].fd);
+      while (waitpid(children[slot].pid, NULL, 0) < 0 && errno == EINTR)
+        continue;
+    }
+  }
+  /* account for tests that no child finished */
+  for (; !stop_tf && print_i < count; ++print_i) {
+    struct reedkiln_outcome* const result = results+print_i;
+    if (!done[print_i] && Reedkiln_Atomic_Get(&shared->stop)) {
+      /* a child bailed out before any child took this test */
+      reedkiln_print_unrun(run, print_i);
+      continue;
+    } else if (!done[print_i]) {
+      /* never run these in this process, where a crash ends the run */
+      result->res = Reedkiln_NOT_OK;
+      result->seed = reedkiln_entry_seed(run, print_i);
+      result->direct_text =
+        reedkiln_outcome_directive(run, print_i, Reedkiln_NOT_OK);
+      reedkiln_fork_describe(NULL, 0, result->seed, &result->yaml);
     }
-    switch (res) {
-    case 0:
-      result_text = "ok"; break;
-    case Reedkiln_IGNORE:
-      result_text = "ok";
-      direct_text = " # SKIP at runtime";
+    if (reedkiln_print_result(run, print_i, result, NULL))
+      *total_res = EXIT_FAILURE;
+    if (result->bail_tf)
+      stop_tf = 1;
+  }
+  for (print_i = 0u; print_i < count; ++print_i)
+    reedkiln_outcome_free(results+print_i);
+  free(polls);
+  free(children);
+  free(done);
+  free(results);
+  munmap(shared, shared_size);
+  return 0;
+}
+/* END   fork pool */
+#endif /*Reedkiln_Fork*/
+
+void reedkiln_print_slowest(struct reedkiln_run const* run, unsigned int n) {
+  size_t const count = run->test_count;
+  double* const order = (double*)malloc((count ? count : 1u)*sizeof(double));
+  unsigned int rank;
+  if (order == NULL)
+    return;
+  memcpy(order, run->durations, count*sizeof(double));
+  reedkiln_out_puts(NULL, "# slowest tests:\n");
+  for (rank = 0u; rank < n; ++rank) {
+    size_t best = count;
+    size_t i;
+    for (i = 0u; i < count; ++i) {
+      if (order[i] >= 0.0 && (best == count || order[i] > order[best]))
+        best = i;
+    }
+    if (best == count)
       break;
-    default:
-      if (!(test->flags & Reedkiln_TODO))
-        total_res = EXIT_FAILURE;
-      result_text = "not ok";break;
+    reedkiln_out_puts(NULL, "#   ");
+    reedkiln_out_double(NULL, order[best]);
+    reedkiln_out_puts(NULL, " ms  ");
+    reedkiln_out_ulong(NULL, (unsigned long int)(best+1u));
+    reedkiln_out_puts(NULL, " - ");
+    reedkiln_out_puts(NULL, run->t[best].name);
+    reedkiln_out_puts(NULL, "\n");
+    order[best] = -1.0;
+  }
+  free(order);
+  return;
+}
+
+int reedkiln_main
+    (struct reedkiln_entry const* t, int argc, char **argv, void* p)
+{
+  struct reedkiln_run run;
+  size_t test_i;
+  int total_res = EXIT_SUCCESS;
+  unsigned int jobs = 1u;
+  unsigned int fork_jobs = 0u;
+  unsigned int slowest = 0u;
+  char const* output_path = NULL;
+  FILE* output_file = NULL;
+  struct reedkiln_filter filter = { NULL, 0u, NULL, 0u };
+  struct reedkiln_entry* selected = NULL;
+  unsigned long int shard_index = 0u;
+  unsigned long int shard_count = 0u;
+  char const* durations_path = NULL;
+  struct reedkiln_durations durations = { NULL, 0u, 0u };
+  char const* cache_path = NULL;
+  char const* fingerprint_text = NULL;
+  int no_cache_tf = 0;
+  struct reedkiln_cache cache = { {0}, NULL, 0u, 0u, 0, NULL };
+  char const* report_specs[Reedkiln_ReportMax];
+  struct reedkiln_report_file report_files[Reedkiln_ReportMax];
+  unsigned int report_count = 0u;
+  unsigned int report_open = 0u;
+  unsigned int const report_base = reedkiln_reports_state.count;
+  char const* journal_path = NULL;
+  struct reedkiln_journal journal = { NULL, 0, 0u, 0u, NULL, NULL };
+  struct reedkiln_repeat repeat = { 0u, 0, 0u, 0u, 0, 0, 0, NULL, NULL };
+  int repeat_tf = 0;
+  int shuffle_tf = 0;
+  run.t = t;
+  run.test_count = reedkiln_entry_count(t);
+  run.p = p;
+  run.rand_seed = reedkiln_default_seed();
+  run.test_seed = 0u;
+  run.test_seed_tf = 0;
+  run.initial_table = reedkiln_worker_main.vtable;
+  run.bench_time = 0.5;
+  run.timing_tf = 0;
+  run.durations = NULL;
+  run.timeout_ms = 0u;
+  run.cache = NULL;
+  run.allocs_tf = 0;
+  run.perf_tf = 0;
+  run.journal = NULL;
+  run.repeat = NULL;
+  run.order = NULL;
+  reedkiln_bail_status = Reedkiln_OK;
+  filter.include = (struct reedkiln_pattern*)malloc
+    ((argc > 0 ? (size_t)argc : 1u)*2u*sizeof(struct reedkiln_pattern));
+  if (filter.include == NULL) {
+    fputs("cannot allocate test name patterns\n", stderr);
+    goto fail;
+  }
+  filter.exclude = filter.include + (argc > 0 ? argc : 1);
+  /* inspect args */{
+    int argi;
+    int help_tf = 0;
+    for (argi = 1; argi < argc; ++argi) {
+      if (argv[argi][0] == '-') {
+        if (strcmp(argv[argi], "-?") == 0
+        ||  strcmp(argv[argi], "-h") == 0)
+        {
+          help_tf = 1;
+          break;
+        } else if (strcmp(argv[argi], "-l") == 0) {
+          help_tf = 2;
+        } else if (strcmp(argv[argi], "-f") == 0
+        ||  strcmp(argv[argi], "-x") == 0)
+        {
+          int const exclude_tf = (argv[argi][1] == 'x');
+          if (++argi >= argc) {
+            fprintf(stderr, "option \"%s\" requires a pattern\n",
+              argv[argi-1]);
+            help_tf = 1;
+          } else {
+            struct reedkiln_pattern* const pat = exclude_tf
+              ? filter.exclude + filter.exclude_count++
+              : filter.include + filter.include_count++;
+            pat->text = argv[argi];
+            pat->prefix_tf = 0;
+          }
+        } else if (strcmp(argv[argi], "-s") == 0) {
+          if (++argi >= argc) {
+            fputs("option \"-s\" requires a number\n", stderr);
+            help_tf = 1;
+          } else {
+            run.rand_seed = (unsigned int)strtoul(argv[argi], NULL, 0);
+          }
+        } else if (strcmp(argv[argi], "-t") == 0) {
+          if (++argi >= argc) {
+            fputs("option \"-t\" requires a number\n", stderr);
+            help_tf = 1;
+          } else {
+            double const v = strtod(argv[argi], NULL);
+            run.timeout_ms = (v <= 0.0) ? 0u
+              : (v >= ULONG_MAX/1000u ? ULONG_MAX
+              : (unsigned long int)(v*1000.0+0.5));
+          }
+        } else if (strcmp(argv[argi], "-o") == 0) {
+          if (++argi >= argc) {
+            fputs("option \"-o\" requires a path\n", stderr);
+            help_tf = 1;
+          } else {
+            output_path = argv[argi];
+          }
+        } else if (strcmp(argv[argi], "-j") == 0) {
+          if (++argi >= argc) {
+            fputs("option \"-j\" requires a number\n", stderr);
+            help_tf = 1;
+          } else {
+            unsigned long int const n = strtoul(argv[argi], NULL, 0);
+            jobs = (n == 0u) ? 1u : (n > 1024u ? 1024u : (unsigned int)n);
+          }
+        } else if (strcmp(argv[argi], "--bench-time") == 0) {
+          if (++argi >= argc) {
+            fputs("option \"--bench-time\" requires a number\n", stderr);
+            help_tf = 1;
+          } else {
+            double const v = strtod(argv[argi], NULL);
+            run.bench_time = (v > 0.0) ? v : 0.5;
+          }
+        } else if (strcmp(argv[argi], "--slowest") == 0) {
+          if (++argi >= argc) {
+            fputs("option \"--slowest\" requires a number\n", stderr);
+            help_tf = 1;
+          } else {
+            unsigned long int const n = strtoul(argv[argi], NULL, 0);
+            slowest = (n > UINT_MAX ? UINT_MAX : (unsigned int)n);
+          }
+        } else if (strcmp(argv[argi], "--test-seed") == 0) {
+          if (++argi >= argc) {
+            fputs("option \"--test-seed\" requires a number\n", stderr);
+            help_tf = 1;
+          } else {
+            run.test_seed = (unsigned int)strtoul(argv[argi], NULL, 0);
+            run.test_seed_tf = 1;
+          }
+        } else if (strcmp(argv[argi], "--shard") == 0) {
+          if (++argi >= argc) {
+            fputs("option \"--shard\" requires (index)/(count)\n", stderr);
+            help_tf = 1;
+          } else {
+            char* end;
+            shard_index = strtoul(argv[argi], &end, 10);
+            shard_count = (*end == '/') ? strtoul(end+1, &end, 10) : 0u;
+            if (*end != '\0' || shard_index == 0u
+            ||  shard_index > shard_count)
+            {
+              fputs("option \"--shard\" requires (index)/(count)"
+                " with an index from 1 to the count\n", stderr);
+              help_tf = 1;
+            }
+          }
+        } else if (strcmp(argv[argi], "--durations") == 0) {
+          if (++argi >= argc) {
+            fputs("option \"--durations\" requires a path\n", stderr);
+            help_tf = 1;
+          } else {
+            durations_path = argv[argi];
+          }
+        } else if (strcmp(argv[argi], "--cache") == 0) {
+          if (++argi >= argc) {
+            fputs("option \"--cache\" requires a path\n", stderr);
+            help_tf = 1;
+          } else {
+            cache_path = argv[argi];
+          }
+        } else if (strcmp(argv[argi], "--fingerprint") == 0) {
+          if (++argi >= argc) {
+            fputs("option \"--fingerprint\" requires text\n", stderr);
+            help_tf = 1;
+          } else {
+            fingerprint_text = argv[argi];
+          }
+        } else if (strcmp(argv[argi], "--no-cache") == 0) {
+          no_cache_tf = 1;
+        } else if (strcmp(argv[argi], "--timing") == 0) {
+          run.timing_tf = 1;
+        } else if (strcmp(argv[argi], "--allocs") == 0) {
+          run.allocs_tf = 1;
+        } else if (strcmp(argv[argi], "--perf-counters") == 0) {
+          run.perf_tf = 1;
+        } else if (strcmp(argv[argi], "--report") == 0) {
+          if (++argi >= argc) {
+            fputs("option \"--report\" requires a format and path\n",
+              stderr);
+            help_tf = 1;
+          } else if (strncmp(argv[argi], "junit:", 6) != 0
+            &&  strncmp(argv[argi], "jsonl:", 6) != 0
+            &&  strncmp(argv[argi], "binary:", 7) != 0)
+          {
+            fprintf(stderr, "unknown report format in \"%s\"\n",
+              argv[argi]);
+            help_tf = 1;
+          } else if (report_count >= Reedkiln_ReportMax) {
+            fputs("too many reports\n", stderr);
+            help_tf = 1;
+          } else {
+            report_specs[report_count++] = argv[argi];
+          }
+        } else if (strcmp(argv[argi], "--resume") == 0) {
+          if (++argi >= argc) {
+            fputs("option \"--resume\" requires a path\n", stderr);
+            help_tf = 1;
+          } else {
+            journal_path = argv[argi];
+          }
+        } else if (strcmp(argv[argi], "--repeat") == 0) {
+          if (++argi >= argc) {
+            fputs("option \"--repeat\" requires a number\n", stderr);
+            help_tf = 1;
+          } else {
+            unsigned long int const n = strtoul(argv[argi], NULL, 0);
+            repeat.count = (n == 0u) ? 1u : n;
+            repeat_tf = 1;
+          }
+        } else if (strcmp(argv[argi], "--until-fail") == 0) {
+          repeat.until_fail_tf = 1;
+          repeat_tf = 1;
+        } else if (strcmp(argv[argi], "--shuffle") == 0) {
+          shuffle_tf = 1;
+        } else if (strcmp(argv[argi], "--fork-workers") == 0) {
+          if (++argi >= argc) {
+            fputs("option \"--fork-workers\" requires a number\n", stderr);
+            help_tf = 1;
+          } else {
+            unsigned long int const n = strtoul(argv[argi], NULL, 0);
+            fork_jobs = (n > 1024u ? 1024u : (unsigned int)n);
+          }
+        } else {
+          fprintf(stderr,"unknown option \"%s\"\n", argv[argi]);
+          help_tf = 1;
+          break;
+        }
+      } else {
+        struct reedkiln_pattern* const pat =
+          filter.include + filter.include_count++;
+        pat->text = argv[argi];
+        pat->prefix_tf = 1;
+      }
+    }
+    if (help_tf != 1 && durations_path != NULL
+    &&  reedkiln_durations_load(&durations, durations_path) != 0)
+    {
+      fputs("cannot allocate the recorded durations\n", stderr);
+      goto fail;
+    }
+    if (help_tf != 1
+    &&  (filter.include_count > 0u || filter.exclude_count > 0u
+      || shard_count > 0u))
+    {
+      selected = reedkiln_select(t, run.test_count, &filter, &run.test_count);
+      if (selected != NULL && shard_count > 0u) {
+        size_t const kept = reedkiln_shard(selected, run.test_count,
+          shard_index-1u, shard_count, &durations);
+        if (kept == (size_t)-1) {
+          free(selected);
+          selected = NULL;
+        } else run.test_count = kept;
+      }
+      if (selected == NULL) {
+        fputs("cannot allocate the test selection\n", stderr);
+        goto fail;
+      }
+      run.t = selected;
+    }
+    free(filter.include);
+    filter.include = NULL;
+    if (help_tf) {
+      if (help_tf == 2) {
+        size_t i;
+        for (i = 0u; i < run.test_count; ++i) {
+          fprintf(stderr, "%s\n", run.t[i].name);
+        }
+      } else {
+        fputs("usage: %s [option [option ...]] [(prefix)]\n\n"
+          "options:\n"
+          "  -?, -h      print a help message\n"
+          "  -f (glob)   run tests whose names match; may be repeated\n"
+          "  -j (jobs)   run tests on this many threads\n"
+          "  -l          list the selected test names\n"
+          "  -o (path)   write the TAP output to this file\n"
+          "  -s (seed)   set the random seed\n"
+          "  -t (seconds)\n"
+          "              fail tests that run longer than this\n"
+          "  -x (glob)   leave out tests whose names match; may be repeated\n"
+          "  --allocs    add allocation counts to each test's YAML block\n"
+          "  --bench-time (seconds)\n"
+          "              target time to spend on each benchmark\n"
+          "  --cache (path)\n"
+          "              skip tests that passed with the same seed\n"
+          "              and fingerprint, then record this run's passes\n"
+          "  --durations (path)\n"
+          "              balance shards by the wall times in this file,\n"
+          "              then update it with this run's times\n"
+          "  --fingerprint (text)\n"
+          "              key the cache by this text instead of\n"
+          "              the test binary's contents\n"
+          "  --fork-workers (count)\n"
+          "              run tests in this many child processes\n"
+          "  --no-cache  run every test, but still update the cache\n"
+          "  --perf-counters\n"
+          "              add hardware counters to each test's YAML block\n"
+          "  --repeat (count)\n"
+          "              run the selected tests this many times with\n"
+          "              new seeds, then print one result per test\n"
+          "  --report (format):(path)\n"
+          "              also write a junit, jsonl or binary report\n"
+          "              to this file; may be repeated\n"
+          "  --resume (path)\n"
+          "              replay the results in this journal, run the\n"
+          "              other tests and add their results; a test\n"
+          "              that crashed the run replays as crashed\n"
+          "  --shard (index)/(count)\n"
+          "              run only this shard of the selected tests,\n"
+          "              counting from 1\n"
+          "  --shuffle   run the selected tests in an order drawn from\n"
+          "              the random seed; results print in table order\n"
+          "  --slowest (count)\n"
+          "              list this many of the slowest tests at the end\n"
+          "  --test-seed (seed)\n"
+          "              give every selected test this seed, such as\n"
+          "              one from a failed test's YAML block\n"
+          "  --timing    add wall and CPU time to each test's YAML block\n"
+          "  --until-fail\n"
+          "              repeat the selected tests until an iteration\n"
+          "              has a failure, or up to the \"--repeat\" count\n\n"
+          "parameters:\n"
+          "  (prefix)    run tests whose names start with this prefix\n\n"
+          "In a glob, \"*\" matches any text and \"?\" matches one character.\n"
+          "Only the selected tests appear in the plan.\n",
+          stderr);
+      }
+      goto fail;
+    }
+  }
+  if (journal_path != NULL) {
+    run.journal = &journal;
+    if (reedkiln_journal_open(&journal, &run, journal_path) != 0) {
+      fprintf(stderr, "cannot open the journal \"%s\"\n", journal_path);
+      goto fail;
+    }
+  }
+  if (cache_path != NULL) {
+#if defined(__linux__)
+    char const* const binary_path = "/proc/self/exe";
+#else
+    char const* const binary_path = (argc > 0) ? argv[0] : "";
+#endif /*__linux__*/
+    if (reedkiln_cache_fingerprint(&cache, fingerprint_text, binary_path)
+        != 0)
+    {
+      fprintf(stderr, "cannot read \"%s\" for the cache fingerprint;"
+        " use \"--fingerprint\"\n", binary_path);
+    } else if (reedkiln_cache_load(&cache, cache_path) != 0
+      ||  (cache.state = (unsigned char*)calloc
+            (run.test_count ? run.test_count : 1u, 1u)) == NULL)
+    {
+      fputs("cannot allocate the result cache\n", stderr);
+      goto fail;
+    } else {
+      cache.use_tf = !no_cache_tf;
+      run.cache = &cache;
+    }
+  }
+  if (repeat_tf) {
+    size_t const n = run.test_count ? run.test_count : 1u;
+    repeat.base_seed = run.rand_seed;
+    repeat.stats = (struct reedkiln_repeat_stat*)calloc
+      (n, sizeof(struct reedkiln_repeat_stat));
+    repeat.keep = (struct reedkiln_outcome*)calloc
+      (n, sizeof(struct reedkiln_outcome));
+    if (repeat.stats == NULL || repeat.keep == NULL) {
+      fputs("cannot allocate the repeat totals\n", stderr);
+      goto fail;
+    }
+    run.repeat = &repeat;
+  }
+  if (shuffle_tf) {
+    size_t const n = run.test_count ? run.test_count : 1u;
+    run.order = (size_t*)malloc(n*sizeof(size_t));
+    if (run.order == NULL) {
+      fputs("cannot allocate the run order\n", stderr);
+      goto fail;
+    }
+  }
+  /* reports */{
+    char const* const suite =
+      (argc > 0 && argv[0] != NULL) ? argv[0] : "reedkiln";
+    for (; report_open < report_count; ++report_open) {
+      if (reedkiln_report_open(report_files+report_open,
+            report_specs[report_open], suite) != 0)
+      {
+        fprintf(stderr, "cannot open the report \"%s\"\n",
+          report_specs[report_open]);
+        goto fail;
+      }
+    }
+  }
+  if (output_path != NULL) {
+    struct reedkiln_sink sink;
+    output_file = fopen(output_path, "wb");
+    if (output_file == NULL) {
+      fprintf(stderr, "cannot open \"%s\" for output\n", output_path);
+      goto fail;
     }
-    fprintf(stdout, "%s %lu - %s%s\n",
-      result_text, ((unsigned long int)(test_i+1)), t[test_i].name,
-      direct_text);
-    /* render the log */if (!skip_tf) {
-      unsigned int const log_index = reedkiln_log_swap();
-      struct reedkiln_logbuf const* const ptr = reedkiln_log_buffers+log_index;
-      unsigned int const log_pos = Reedkiln_Atomic_Get(&ptr->pos);
-      if (log_pos > 0) {
-        fputs("  ---\n  message: \"", stdout);
-        reedkiln_log_escape(ptr->data, log_pos, stdout);
-        fputs("\"\n  ...\n", stdout);
+    sink.write_cb = &reedkiln_sink_fwrite;
+    sink.flush_cb = &reedkiln_sink_fflush;
+    sink.p = output_file;
+    reedkiln_set_sink(&sink, reedkiln_outbuf.want);
+  }
+  reedkiln_out_puts(NULL, "TAP version 14\n1..");
+  reedkiln_out_ulong(NULL, (unsigned long int)run.test_count);
+  reedkiln_out_puts(NULL, "\n");
+  /* seed */{
+    char buf[32];
+    sprintf(buf, "%#x", run.rand_seed);
+    reedkiln_out_puts(NULL, "# random_seed: ");
+    reedkiln_out_puts(NULL, buf);
+    reedkiln_out_puts(NULL, "\n");
+    if (run.test_seed_tf) {
+      sprintf(buf, "%#x", run.test_seed);
+      reedkiln_out_puts(NULL, "# test_seed: ");
+      reedkiln_out_puts(NULL, buf);
+      reedkiln_out_puts(NULL, "\n");
+    }
+  }
+  if (journal.replay_count > 0u) {
+    reedkiln_out_puts(NULL, "# resuming after ");
+    reedkiln_out_ulong(NULL, (unsigned long int)journal.replay_count);
+    reedkiln_out_puts(NULL, " results from the journal\n");
+  }
+  reedkiln_report_plan(run.test_count, run.rand_seed);
+  if (slowest > 0u || durations_path != NULL) {
+    run.durations = (double*)malloc
+      ((run.test_count ? run.test_count : 1u)*sizeof(double));
+    for (test_i = 0u; run.durations && test_i < run.test_count; ++test_i)
+      run.durations[test_i] = -1.0;
+  }
+  if (run.perf_tf && reedkiln_perf_open(&reedkiln_worker_main) == 0) {
+    reedkiln_out_puts(NULL, "# performance counters unavailable\n");
+    run.perf_tf = 0;
+  }
+#if !defined(Reedkiln_Fork)
+  if (fork_jobs > 0u) {
+    reedkiln_out_puts(NULL, "# fork workers unavailable\n");
+    fork_jobs = 0u;
+  }
+#endif /*Reedkiln_Fork*/
+  reedkiln_alloc_start();
+  /* run the tests */{
+    int watch_tf = 0;
+    /* keep the diagnostics for the reporters, the journal and repeats */
+    if (reedkiln_reports_state.count > 0u || run.journal != NULL
+    ||  run.repeat != NULL)
+    {
+      reedkiln_worker_main.capture_tf = 1u;
+    }
+    (void)reedkiln_repeat_next(&run);
+    do {
+      int done_tf = 0;
+      /* each iteration draws its order from its own seed */
+      if (run.order != NULL)
+        reedkiln_shuffle(&run);
+#if defined(Reedkiln_Fork)
+      if (!done_tf && fork_jobs > 0u) {
+        done_tf = (reedkiln_fork_main(&run, fork_jobs, &total_res) == 0);
+        if (!done_tf) {
+          /* run in this process instead, here and after */
+          reedkiln_out_puts(NULL, "# fork workers unavailable\n");
+          fork_jobs = 0u;
+        }
+      }
+#endif /*Reedkiln_Fork*/
+      if (!done_tf && !watch_tf && reedkiln_timeouts_used(&run)) {
+        watch_tf = 1;
+        if (reedkiln_watchdog_start() != 0) {
+          reedkiln_out_puts(NULL,
+            "# timeouts unavailable without a watchdog thread\n");
+        }
+      }
+#if defined(Reedkiln_Threads)
+      if (!done_tf && jobs > 1u)
+        done_tf = (reedkiln_pool_main(&run, jobs, &total_res) == 0);
+#endif /*Reedkiln_Threads*/
+      if (!done_tf && run.order != NULL) {
+        done_tf = (reedkiln_order_main(&run, &total_res) == 0);
+        if (!done_tf) {
+          /* run in table order instead, here and after */
+          free(run.order);
+          run.order = NULL;
+        }
+      }
+      for (test_i = 0; !done_tf && test_i < run.test_count; ++test_i) {
+        struct reedkiln_outcome result = {0};
+        reedkiln_journal_mark(&run, test_i, Reedkiln_JournalStart);
+        reedkiln_run_entry(&run, &reedkiln_worker_main, test_i, &result);
+        reedkiln_worker_main.notes = NULL;
+        if (reedkiln_print_result
+              (&run, test_i, &result, &reedkiln_worker_main))
+        {
+          total_res = EXIT_FAILURE;
+        }
+        reedkiln_outcome_free(&result);
+        if (result.bail_tf) {
+          total_res = EXIT_FAILURE;
+          break;
+        }
       }
+    } while (reedkiln_repeat_next(&run));
+    if (run.repeat != NULL && reedkiln_repeat_finish(&run))
+      total_res = EXIT_FAILURE;
+    reedkiln_fixture_release(&reedkiln_worker_main);
+    reedkiln_perf_close(&reedkiln_worker_main);
+    reedkiln_watchdog_stop();
+    reedkiln_worker_main.capture_tf = 0u;
+  }
+  reedkiln_alloc_stop();
+  if (run.allocs_tf && !Reedkiln_Atomic_Get(&reedkiln_alloc_hooked)) {
+    reedkiln_out_puts(NULL,
+      "# allocation counts unavailable without the alloc.h hooks\n");
+  }
+  if (run.durations != NULL) {
+    if (Reedkiln_Atomic_Get(&reedkiln_bail_status) == Reedkiln_OK
+    &&  slowest > 0u)
+    {
+      reedkiln_print_slowest(&run, slowest);
+    }
+    if (durations_path != NULL
+    &&  reedkiln_durations_save(&durations, &run, durations_path) != 0)
+    {
+      fprintf(stderr, "cannot write durations to \"%s\"\n",
+        durations_path);
     }
+    free(run.durations);
+  }
+  if (run.cache != NULL
+  &&  reedkiln_cache_save(&cache, &run, cache_path) != 0)
+  {
+    fprintf(stderr, "cannot write the cache to \"%s\"\n", cache_path);
+  }
+  if (run.journal != NULL
+  &&  reedkiln_journal_close(&journal, journal_path, run.test_count) != 0)
+  {
+    fprintf(stderr, "cannot write the journal \"%s\"\n", journal_path);
+  }
+  reedkiln_report_finish();
+  reedkiln_repeat_free(&repeat, run.test_count);
+  free(run.order);
+  if (reedkiln_report_close(report_files, report_count, report_base) != 0)
+    total_res = EXIT_FAILURE;
+  reedkiln_cache_free(&cache);
+  reedkiln_durations_free(&durations);
+  reedkiln_log_free(&reedkiln_worker_main);
+  free(selected);
+  reedkiln_out_flush();
+  if (output_file != NULL) {
+    reedkiln_set_sink(NULL, reedkiln_outbuf.want);
+    if (fclose(output_file) != 0)
+      total_res = EXIT_FAILURE;
   }
   return total_res;
+fail:
+  /* undo the setup done before the failure */
+  (void)reedkiln_report_close(report_files, report_open, report_base);
+  free(run.order);
+  reedkiln_repeat_free(&repeat, 0u);
+  reedkiln_cache_free(&cache);
+  if (run.journal != NULL)
+    (void)reedkiln_journal_close(&journal, journal_path, run.test_count);
+  reedkiln_durations_free(&durations);
+  free(filter.include);
+  free(selected);
+  return EXIT_FAILURE;
 }
@@ -46,16 +46,43 @@ typedef void (*reedkiln_teardown_cb)(void* p);
  * @return a box item on success, NULL otherwise
  */
 typedef void* (*reedkiln_setup_cb)(void*);
+/**
+ * @brief Reset code.
+ * @param p box item left by an earlier test
+ * @return Reedkiln_OK if the item is ready for the next test
+ */
+typedef int (*reedkiln_reset_cb)(void* p);
 
 enum reedkiln_flag {
   Reedkiln_ZERO = 0,
   Reedkiln_TODO = 1,
-  Reedkiln_SKIP = 2
+  Reedkiln_SKIP = 2,
+  /**
+   * @brief Run the callback as a benchmark.
+   * @see reedkiln_bench_count
+   */
+  Reedkiln_BENCH = 4
 };
 
 struct reedkiln_box {
   reedkiln_setup_cb setup;
   reedkiln_teardown_cb teardown;
+  /**
+   * @brief Time limit in milliseconds for setup and test, or zero
+   *   to use the command line default.
+   */
+  unsigned long int timeout_ms;
+  /**
+   * @brief Reset callback, or NULL to set up each test's item anew.
+   * @note With a reset callback, the item lives on across tests
+   *   that share this box. Each such test after the first gets the
+   *   item from the one before, reset instead of set up again. The
+   *   last test before one with another box tears the item down,
+   *   within its own teardown time, as does a reset or a test that
+   *   fails by timeout or bail out. A failed reset fails the test
+   *   without running it.
+   */
+  reedkiln_reset_cb reset;
 };
 typedef struct reedkiln_box reedkiln_box;
 
@@ -100,15 +127,182 @@ struct reedkiln_vtable {
   reedkiln_fail_cb fail_cb;
 };
 
+/**
+ * @brief Finished test, as seen by a reporter.
+ */
+struct reedkiln_report {
+  /** @brief Test number, counting from one as in the TAP output. */
+  reedkiln_size number;
+  char const* name;
+  /** @brief Nonzero for "ok", zero for "not ok". */
+  int ok_tf;
+  /** @brief TAP directive without the leading " # ", or "". */
+  char const* directive;
+  /** @brief Flags from the test entry. */
+  unsigned int flags;
+  /** @brief Random seed given to the test. */
+  unsigned int seed;
+  /** @brief Wall time of setup, test and teardown. */
+  double duration_ms;
+  /** @brief Diagnostic lines, each starting with "#". */
+  char const* notes;
+  reedkiln_size notes_len;
+};
+
+/**
+ * @brief Plan callback.
+ * @param p user data from `reedkiln_add_reporter`
+ * @param count number of tests to report
+ * @param seed random seed of the run
+ */
+typedef void (*reedkiln_plan_cb)
+  (void* p, reedkiln_size count, unsigned int seed);
+/**
+ * @brief Test start callback.
+ * @param p user data from `reedkiln_add_reporter`
+ * @param number test number
+ * @param name test name
+ */
+typedef void (*reedkiln_start_cb)
+  (void* p, reedkiln_size number, char const* name);
+/**
+ * @brief Test log callback.
+ * @param p user data from `reedkiln_add_reporter`
+ * @param number test number
+ * @param text log text of the test, not terminated
+ * @param n length of the text in bytes
+ */
+typedef void (*reedkiln_report_log_cb)
+  (void* p, reedkiln_size number, char const* text, reedkiln_size n);
+/**
+ * @brief Test end callback.
+ * @param p user data from `reedkiln_add_reporter`
+ * @param r result of the test
+ */
+typedef void (*reedkiln_end_cb)(void* p, struct reedkiln_report const* r);
+/**
+ * @brief Bail out callback.
+ * @param p user data from `reedkiln_add_reporter`
+ * @param reason reason given for bailing out, or ""
+ */
+typedef void (*reedkiln_report_bail_cb)(void* p, char const* reason);
+/**
+ * @brief Run end callback.
+ * @param p user data from `reedkiln_add_reporter`
+ */
+typedef void (*reedkiln_finish_cb)(void* p);
+
+/**
+ * @brief Event callbacks for a report format.
+ * @note Any callback may be NULL. Events come from one thread in
+ *   test number order, each test's start, log and end together once
+ *   the test is done.
+ */
+struct reedkiln_reporter {
+  reedkiln_plan_cb plan_cb;
+  reedkiln_start_cb start_cb;
+  reedkiln_report_log_cb log_cb;
+  reedkiln_end_cb end_cb;
+  reedkiln_report_bail_cb bail_cb;
+  reedkiln_finish_cb finish_cb;
+};
+
+/**
+ * @brief Output write callback.
+ * @param p user data from the sink
+ * @param data bytes to write
+ * @param n number of bytes to write
+ * @return zero on success, nonzero on error
+ */
+typedef int (*reedkiln_write_cb)(void* p, void const* data, reedkiln_size n);
+/**
+ * @brief Output flush callback.
+ * @param p user data from the sink
+ * @return zero on success, nonzero on error
+ */
+typedef int (*reedkiln_flush_cb)(void* p);
+
+/**
+ * @brief Destination for TAP output.
+ */
+struct reedkiln_sink {
+  reedkiln_write_cb write_cb;
+  /** @brief Called after each test, or NULL. */
+  reedkiln_flush_cb flush_cb;
+  void* p;
+};
+
 /**
  * @brief Get a random number.
+ * @note Each thread draws from its own stream. The test thread uses
+ *   stream zero; other threads take the next unused stream on their
+ *   first draw unless they pick one with `reedkiln_rand_stream`.
  */
 unsigned int reedkiln_rand(void);
+/**
+ * @brief Select the calling thread's random stream for the current test.
+ * @param id stream number, with zero being the test thread's stream
+ */
+void reedkiln_rand_stream(unsigned int id);
 /**
  * @brief Fill a buffer with random bytes.
  */
 void reedkiln_memrand(void* b, reedkiln_size sz);
 
+/**
+ * @brief Get the number of iterations for a benchmark callback to run.
+ * @return the iteration count for the current sample, or one
+ *   outside of a benchmark
+ */
+reedkiln_size reedkiln_bench_count(void);
+/**
+ * @brief Stop the benchmark clock, such as for per-iteration setup.
+ */
+void reedkiln_bench_pause(void);
+/**
+ * @brief Restart the benchmark clock after `reedkiln_bench_pause`.
+ */
+void reedkiln_bench_resume(void);
+
+/**
+ * @brief Get the test state of the calling thread.
+ * @return a handle for `reedkiln_attach`
+ */
+void* reedkiln_current(void);
+/**
+ * @brief Share a test's state with the calling thread.
+ * @param handle value of `reedkiln_current` from the test's thread,
+ *   or NULL to detach
+ * @note With `-j`, threads that a test starts need this before they
+ *   use the log or the random number generator. A thread that uses
+ *   them without test state aborts the run with a message.
+ */
+void reedkiln_attach(void* handle);
+
+/**
+ * @brief Run a subtest of the current test.
+ * @param name name of the subtest
+ * @param cb subtest callback
+ * @param p to pass to the callback, such as the test's box item
+ * @return Reedkiln_NOT_OK if the subtest failed, Reedkiln_OK otherwise
+ * @note The subtest gets its own failure path, log and random seed.
+ *   Its result prints as a TAP 14 subtest, indented under the current
+ *   test. A failed subtest fails the current test without stopping it.
+ */
+int reedkiln_subtest(char const* name, reedkiln_cb cb, void* p);
+/**
+ * @brief Run a list of subtests of the current test.
+ * @param t array of subtests, ending with a NULL name
+ * @param p to pass to the callbacks
+ * @param jobs most threads to use, or zero for one per CPU
+ * @return Reedkiln_NOT_OK if a subtest failed, Reedkiln_OK otherwise
+ * @note Each subtest runs as if by `reedkiln_subtest`, with its flags
+ *   but without its box, as subtests share the current test's item.
+ *   Results print in order however the threads finish.
+ */
+int reedkiln_subtests
+  (struct reedkiln_entry const* t, void* p, unsigned int jobs);
+
 /**
  * @brief Report a fail if a condition is false (zero).
  * @param val zero to fail, nonzero otherwise
@@ -147,6 +341,27 @@ int reedkiln_main
  */
 void reedkiln_set_vtable(struct reedkiln_vtable const* vt);
 
+/**
+ * @brief Add a reporter to run alongside the TAP output.
+ * @param r event callbacks, which must outlive the test run
+ * @param p user data for the callbacks
+ * @return zero on success, nonzero if there are too many reporters
+ * @note Call before `reedkiln_main`. The `--report` option adds
+ *   the reporters built into the library.
+ */
+int reedkiln_add_reporter(struct reedkiln_reporter const* r, void* p);
+
+/**
+ * @brief Configure the destination for TAP output.
+ * @param sink output callbacks, or NULL for standard output
+ * @param buffer_size bytes to collect between writes, or zero
+ *   for the default
+ * @note Output goes to the sink at the end of each test and
+ *   before a bail out. The `-o` option overrides this sink.
+ */
+void reedkiln_set_sink
+  (struct reedkiln_sink const* sink, reedkiln_size buffer_size);
+
 /**
  * @brief Fail the current test.
  */
@@ -203,10 +418,36 @@ namespace reedkiln {
     static reedkiln_box const* const ptr;
   };
   template <typename t>
-  reedkiln_box const cxx_box<t>::value = { &setup, &teardown };
+  reedkiln_box const cxx_box<t>::value = { &setup, &teardown, 0u, NULL };
   template <typename t>
   reedkiln_box const* const cxx_box<t>::ptr = &cxx_box<t>::value;
 
+  /**
+   * @brief Box that keeps one item for consecutive tests.
+   * @tparam t item type, with a `reset()` member to call between tests
+   * @note An exception from `reset()` fails the test, as a failed
+   *   reset does, instead of passing through the C library.
+   */
+  template <typename t>
+  struct cxx_pool_box : public cxx_box<t> {
+  public:
+    static int reset(void* p) Reedkiln_Noexcept {
+      try {
+        static_cast<t*>(p)->reset();
+      } catch (...) {
+        return Reedkiln_NOT_OK;
+      }
+      return Reedkiln_OK;
+    }
+    static reedkiln_box const value;
+    static reedkiln_box const* const ptr;
+  };
+  template <typename t>
+  reedkiln_box const cxx_pool_box<t>::value =
+    { &cxx_box<t>::setup, &cxx_box<t>::teardown, 0u, &reset };
+  template <typename t>
+  reedkiln_box const* const cxx_pool_box<t>::ptr = &cxx_pool_box<t>::value;
+
 #  if (defined Reedkiln_UseExpect) || (__cplusplus >= 201103L)
   /**
    * @brief Allow the exception and report success.
@@ -342,10 +583,11 @@ namespace reedkiln {
 
   template <typename t, typename... Exceptions>
   reedkiln_box const expect_box<t, Exceptions...>::value =
-    { &expect_box<t, Exceptions...>::setup, &cxx_box<t>::teardown };
+    { &expect_box<t, Exceptions...>::setup, &cxx_box<t>::teardown,
+      0u, NULL };
   template <typename... Exceptions>
   reedkiln_box const expect_box<void, Exceptions...>::value =
-    { &expect_box<void, Exceptions...>::setup, 0 };
+    { &expect_box<void, Exceptions...>::setup, NULL, 0u, NULL };
 #  endif /*Reedkiln_UseExpect*/
 
 
@@ -0,0 +1,292 @@
+# Run a test program and check its output.
+#
+# usage: cmake -DEXE=(program) -DMODE=(check) [-DARGS=(options)]
+#          -P check_run.cmake
+#
+# Checks that take ARGS add those options to each run of the program.
+# Files made by a check start with "reedkiln_check_" and are removed
+# before the check runs, so that earlier runs do not change its result.
+if (NOT EXE OR NOT MODE)
+  message(FATAL_ERROR "usage: cmake -DEXE=... -DMODE=... -P check_run.cmake")
+endif (NOT EXE OR NOT MODE)
+
+# Run the program with the given arguments, keeping its TAP output.
+function(reedkiln_run out)
+  execute_process(COMMAND "${EXE}" ${ARGN}
+    OUTPUT_VARIABLE text RESULT_VARIABLE res ERROR_QUIET TIMEOUT 60)
+  set(${out} "${text}" PARENT_SCOPE)
+  set(${out}_res "${res}" PARENT_SCOPE)
+endfunction(reedkiln_run)
+
+# Fail unless the text in a variable matches a regular expression.
+function(reedkiln_expect var regex what)
+  if (NOT "${${var}}" MATCHES "${regex}")
+    message(FATAL_ERROR "${what}; output was:\n${${var}}")
+  endif (NOT "${${var}}" MATCHES "${regex}")
+endfunction(reedkiln_expect)
+
+# Fail if the text in a variable matches a regular expression.
+function(reedkiln_reject var regex what)
+  if ("${${var}}" MATCHES "${regex}")
+    message(FATAL_ERROR "${what}; output was:\n${${var}}")
+  endif ("${${var}}" MATCHES "${regex}")
+endfunction(reedkiln_reject)
+
+# Fail unless the program exited with this status.
+function(reedkiln_status var want)
+  if (NOT "${${var}_res}" STREQUAL "${want}")
+    message(FATAL_ERROR
+      "exit status ${${var}_res} instead of ${want}; output was:\n${${var}}")
+  endif (NOT "${${var}_res}" STREQUAL "${want}")
+endfunction(reedkiln_status)
+
+# Get the sorted test names from TAP output.
+function(reedkiln_names out var)
+  string(REGEX MATCHALL "\n(not )?ok [0-9]+ - [^\n]*" lines "${${var}}")
+  set(names)
+  foreach (line IN LISTS lines)
+    string(REGEX REPLACE "^\n(not )?ok [0-9]+ - " "" name "${line}")
+    string(REGEX REPLACE " # .*$" "" name "${name}")
+    list(APPEND names "${name}")
+  endforeach (line)
+  list(SORT names)
+  set(${out} "${names}" PARENT_SCOPE)
+endfunction(reedkiln_names)
+
+# Check that the shards of a run hold each of its tests exactly once.
+function(reedkiln_shard_union count)
+  reedkiln_run(full ${ARGN})
+  reedkiln_names(want full)
+  set(got)
+  foreach (i RANGE 1 ${count})
+    reedkiln_run(part --shard "${i}/${count}" ${ARGN})
+    reedkiln_names(names part)
+    list(APPEND got ${names})
+  endforeach (i)
+  list(SORT got)
+  if (NOT "${got}" STREQUAL "${want}")
+    message(FATAL_ERROR "${count} shards ran [${got}] instead of [${want}]")
+  endif (NOT "${got}" STREQUAL "${want}")
+endfunction(reedkiln_shard_union)
+
+if (MODE STREQUAL "cache")
+  set(cache "reedkiln_check_cache.txt")
+  file(REMOVE "${cache}")
+  reedkiln_run(first -s 1 --cache "${cache}" --fingerprint one)
+  reedkiln_status(first 0)
+  reedkiln_reject(first "SKIP cached" "first run used an empty cache")
+  reedkiln_run(second -s 1 --cache "${cache}" --fingerprint one)
+  reedkiln_status(second 0)
+  reedkiln_expect(second "\nok 1 - memrand # SKIP cached\n"
+    "second run did not skip a cached pass")
+  reedkiln_reject(second "todo # SKIP cached"
+    "second run skipped a failing TODO test")
+  reedkiln_run(seed -s 2 --cache "${cache}" --fingerprint one)
+  reedkiln_reject(seed "SKIP cached" "a new seed hit the cache")
+  reedkiln_run(none -s 1 --cache "${cache}" --fingerprint one --no-cache)
+  reedkiln_reject(none "SKIP cached" "--no-cache hit the cache")
+  reedkiln_run(again -s 1 --cache "${cache}" --fingerprint one)
+  reedkiln_expect(again "SKIP cached" "cache lost its passes")
+  reedkiln_run(print -s 1 --cache "${cache}" --fingerprint two)
+  reedkiln_reject(print "SKIP cached" "a new fingerprint hit the cache")
+  file(REMOVE "${cache}")
+elseif (MODE STREQUAL "report")
+  set(base "reedkiln_check_report")
+  file(REMOVE "${base}.xml" "${base}.jsonl" "${base}.bin")
+  reedkiln_run(tap --report "junit:${base}.xml"
+    --report "jsonl:${base}.jsonl" --report "binary:${base}.bin")
+  reedkiln_status(tap 0)
+  string(REGEX MATCHALL "\nok |\nnot ok " tap_results "${tap}")
+  list(LENGTH tap_results count)
+  # JUnit: one test case per result, each with its properties first
+  file(READ "${base}.xml" xml)
+  reedkiln_expect(xml "^<\\?xml [^\n]*\n<testsuites>\n<testsuite [^>]*>\n"
+    "JUnit report lacks its header")
+  reedkiln_expect(xml "</testsuite>\n</testsuites>\n$"
+    "JUnit report is not closed")
+  string(REGEX MATCHALL "<testcase [^>]*>" cases "${xml}")
+  string(REGEX MATCHALL
+    "<testcase [^>]*>\n<properties>\n<property name=\"seed\" value=\"(0x[0-9a-f]+|0)\"/>\n</properties>\n"
+    ordered "${xml}")
+  list(LENGTH cases case_count)
+  list(LENGTH ordered ordered_count)
+  if (NOT case_count EQUAL count OR NOT ordered_count EQUAL count)
+    message(FATAL_ERROR "JUnit report has ${case_count} test cases,"
+      " ${ordered_count} with properties first, for ${count} results")
+  endif (NOT case_count EQUAL count OR NOT ordered_count EQUAL count)
+  reedkiln_expect(xml "name=\"todo\"[^>]*>\n<properties>\n[^\n]*\n</properties>\n<skipped "
+    "JUnit report does not skip the TODO test")
+  # JSON Lines: one object per line, with an end event per result
+  file(STRINGS "${base}.jsonl" lines)
+  set(ends 0)
+  foreach (line IN LISTS lines)
+    if (NOT line MATCHES "^{\"event\":\"[a-z]+\"(,.*)?}$")
+      message(FATAL_ERROR "bad JSON Lines record: ${line}")
+    endif (NOT line MATCHES "^{\"event\":\"[a-z]+\"(,.*)?}$")
+    if (line MATCHES "^{\"event\":\"end\",")
+      math(EXPR ends "${ends}+1")
+    endif (line MATCHES "^{\"event\":\"end\",")
+  endforeach (line)
+  if (NOT ends EQUAL count)
+    message(FATAL_ERROR "JSON Lines report has ${ends} end events"
+      " for ${count} results")
+  endif (NOT ends EQUAL count)
+  # binary: magic and version, then records that end with the file
+  file(READ "${base}.bin" bin HEX)
+  reedkiln_expect(bin "^524b4c4e01000000" "binary report lacks its header")
+  string(LENGTH "${bin}" bin_len)
+  set(pos 16)
+  set(ends 0)
+  while (pos LESS bin_len)
+    math(EXPR len_pos "${pos}+2")
+    string(SUBSTRING "${bin}" ${pos} 2 kind)
+    # little-endian record length
+    set(len 0)
+    foreach (i 3 2 1 0)
+      math(EXPR at "${len_pos}+${i}*2")
+      string(SUBSTRING "${bin}" ${at} 2 byte)
+      foreach (digit_i 0 1)
+        string(SUBSTRING "${byte}" ${digit_i} 1 digit)
+        string(FIND "0123456789abcdef" "${digit}" digit)
+        math(EXPR len "${len}*16+${digit}")
+      endforeach (digit_i)
+    endforeach (i)
+    if (kind STREQUAL "04")
+      math(EXPR ends "${ends}+1")
+    endif (kind STREQUAL "04")
+    math(EXPR pos "${len_pos}+8+${len}*2")
+  endwhile (pos LESS bin_len)
+  if (NOT pos EQUAL bin_len OR NOT ends EQUAL count)
+    message(FATAL_ERROR "binary report has ${ends} end records"
+      " for ${count} results, or a torn record")
+  endif (NOT pos EQUAL bin_len OR NOT ends EQUAL count)
+  file(REMOVE "${base}.xml" "${base}.jsonl" "${base}.bin")
+elseif (MODE STREQUAL "shard")
+  foreach (count 1 2 3 9 12)
+    reedkiln_shard_union(${count})
+  endforeach (count)
+  # a shard may come up empty, which still passes
+  reedkiln_run(over --shard 10/10)
+  reedkiln_status(over 0)
+  reedkiln_expect(over "^TAP version 14\n1\\.\\.0\n" "empty shard lacks its plan")
+elseif (MODE STREQUAL "shard_durations")
+  set(durations "reedkiln_check_shard.durations")
+  file(REMOVE "${durations}")
+  # record the wall times, then balance shards by them
+  reedkiln_run(record --durations "${durations}")
+  reedkiln_status(record 0)
+  foreach (count 2 3)
+    reedkiln_shard_union(${count} --durations "${durations}")
+  endforeach (count)
+  file(REMOVE "${durations}")
+elseif (MODE STREQUAL "repeat")
+  # with --until-fail, the first failure ends the run
+  reedkiln_run(until -s 2 --repeat 12 --until-fail)
+  reedkiln_reject(until_res "^0$" "failing run passed")
+  set(note "\n# 1 - flaky failed in iteration ([0-9]+); reproduce with -s (0x[0-9a-f]+)\n")
+  reedkiln_expect(until "${note}" "no note of the first failure")
+  string(REGEX MATCH "${note}" found "${until}")
+  set(iteration "${CMAKE_MATCH_1}")
+  set(seed "${CMAKE_MATCH_2}")
+  if (NOT iteration LESS 12)
+    message(FATAL_ERROR "--until-fail went on past its first failure")
+  endif (NOT iteration LESS 12)
+  reedkiln_expect(until "\nnot ok 1 - flaky\n  ---\n  seed: 0x[0-9a-f]+\n  repeat:\n    iterations: ${iteration}\n    runs: ${iteration}\n    failures: 1\n    first_failure: ${iteration}\n    failed_random_seed: ${seed}\n    wall_ms:\n      min: [0-9.]+\n      mean: [0-9.]+\n      stddev: [0-9.]+\n      max: [0-9.]+\n  \\.\\.\\.\n"
+    "repeat statistics do not match the first failure")
+  reedkiln_expect(until "\nok 2 - steady\n  ---\n  seed: 0x[0-9a-f]+\n  repeat:\n    iterations: ${iteration}\n    runs: ${iteration}\n    failures: 0\n    wall_ms:\n"
+    "passing test lacks its repeat statistics")
+  # the noted seed reproduces the failure on its own
+  reedkiln_run(again -s "${seed}")
+  reedkiln_expect(again "\nnot ok 1 - flaky\n" "noted seed did not fail")
+  # so does the test's own seed, whatever the run's seed
+  string(REGEX MATCH "\nnot ok 1 - flaky\n  ---\n  seed: (0x[0-9a-f]+)\n"
+    found "${until}")
+  set(test_seed "${CMAKE_MATCH_1}")
+  reedkiln_run(own -s 5 --test-seed "${test_seed}" flaky)
+  reedkiln_expect(own "\n# test_seed: ${test_seed}\nnot ok 1 - flaky\n  ---\n  seed: ${test_seed}\n"
+    "test seed did not reproduce the failure")
+  # without --until-fail, every iteration runs
+  foreach (jobs 1 2)
+    reedkiln_run(all -s 2 --repeat 12 -j ${jobs})
+    reedkiln_expect(all "${note}" "repeat with ${jobs} jobs lost its note")
+    reedkiln_expect(all "\nnot ok 1 - flaky\n[^.]*\n    iterations: 12\n    runs: 12\n    failures: [1-9][0-9]*\n    first_failure: ${iteration}\n"
+      "repeat with ${jobs} jobs stopped early")
+  endforeach (jobs)
+elseif (MODE STREQUAL "shuffle")
+  # a shuffle moves only the run order, never the results or their order
+  foreach (args "-s;1" "-s;1;-j;2;--shard;1/2")
+    reedkiln_run(plain ${args})
+    reedkiln_run(mixed ${args} --shuffle)
+    reedkiln_run(again ${args} --shuffle)
+    if (NOT plain STREQUAL mixed OR NOT mixed STREQUAL again)
+      message(FATAL_ERROR "shuffled run with ${args} changed its output:\n"
+        "${plain}\n--- shuffled:\n${mixed}\n--- again:\n${again}")
+    endif (NOT plain STREQUAL mixed OR NOT mixed STREQUAL again)
+  endforeach (args)
+elseif (MODE STREQUAL "shuffle_bail")
+  # every test before the bail out prints, in order, before the bail out;
+  # those the bail out kept from running print as skipped
+  separate_arguments(args UNIX_COMMAND "${ARGS}")
+  set(waited 0)
+  foreach (seed RANGE 1 12)
+    reedkiln_run(tap -s ${seed} --shuffle ${args})
+    reedkiln_reject(tap_res "^0$" "bail out with seed ${seed} passed")
+    reedkiln_expect(tap "\n# random_seed: 0x[0-9a-f]+\nok 1 - alpha( # SKIP bailed out)?\nok 2 - beta( # SKIP bailed out)?\nBail out![^\n]*\n$"
+      "bail out with seed ${seed} printed out of order")
+    if (tap MATCHES "\nok 1 - alpha # SKIP bailed out\nok 2 - beta\n")
+      set(waited 1)
+    endif (tap MATCHES "\nok 1 - alpha # SKIP bailed out\nok 2 - beta\n")
+  endforeach (seed)
+  # only a serial run fixes which tests finish before the bail out
+  if (NOT waited AND NOT args)
+    message(FATAL_ERROR "no seed left a finished test waiting to print")
+  endif (NOT waited AND NOT args)
+elseif (MODE STREQUAL "output")
+  # the output file gets the same TAP that standard output would
+  set(tap "reedkiln_check_output.tap")
+  file(REMOVE "${tap}")
+  reedkiln_run(stdout -s 1)
+  reedkiln_run(quiet -s 1 -o "${tap}")
+  reedkiln_status(quiet "${stdout_res}")
+  if (NOT EXISTS "${tap}")
+    message(FATAL_ERROR "option \"-o\" did not write ${tap}")
+  endif (NOT EXISTS "${tap}")
+  file(READ "${tap}" written)
+  reedkiln_expect(stdout "^TAP version 14\n1\\.\\.9\n"
+    "standard output lacks the TAP header")
+  if (NOT written STREQUAL stdout)
+    message(FATAL_ERROR "${tap} differs from standard output:\n"
+      "${written}\n--- standard output:\n${stdout}")
+  endif (NOT written STREQUAL stdout)
+  reedkiln_expect(quiet "^$" "option \"-o\" also wrote to standard output")
+  file(REMOVE "${tap}")
+elseif (MODE STREQUAL "stray")
+  # a thread without test state stops a parallel run with a message
+  execute_process(COMMAND "${EXE}" -j 2 -f threads/stray
+    OUTPUT_VARIABLE out ERROR_VARIABLE err RESULT_VARIABLE res)
+  reedkiln_reject(res "^0$" "stray thread did not stop the run")
+  reedkiln_expect(err "a thread used the test state without .reedkiln_attach."
+    "stray thread stopped the run without a message")
+  # the output so far reaches the sink before the process ends
+  reedkiln_expect(out "^TAP version 14\n1\\.\\.1\n.*\nBail out! [^\n]*\n$"
+    "stray thread lost the buffered output")
+elseif (MODE STREQUAL "resume_crash")
+  set(journal "reedkiln_check_resume.journal")
+  file(REMOVE "${journal}")
+  # each run dies in the next crashing test, which the journal names
+  reedkiln_run(first --resume "${journal}")
+  reedkiln_reject(first_res "^[01]$" "crashing test did not stop the run")
+  reedkiln_run(second --resume "${journal}")
+  reedkiln_reject(second_res "^[01]$" "second crash did not stop the run")
+  reedkiln_expect(second "\nnot ok 1 - abort # crashed\nok 2 - after\n"
+    "crashed test did not replay from the journal")
+  reedkiln_run(third --resume "${journal}")
+  reedkiln_status(third 0)
+  reedkiln_expect(third "\n# resuming after 3 results from the journal\nnot ok 1 - abort # crashed\nok 2 - after\nnot ok 3 - signal # crashed\nok 4 - zeta\n"
+    "crashed tests did not replay in order")
+  if (EXISTS "${journal}")
+    message(FATAL_ERROR "journal kept after the last test")
+  endif (EXISTS "${journal}")
+else (MODE STREQUAL "cache")
+  message(FATAL_ERROR "unknown check \"${MODE}\"")
+endif (MODE STREQUAL "cache")
@@ -0,0 +1,131 @@
+/* SPDX-License-Identifier: Unlicense */
+#define Reedkiln_AllocMain
+#include "../alloc.h"
+#include <stdlib.h>
+#include <string.h>
+
+
+int test_budget(void*);
+int test_budget_over(void*);
+int test_count(void*);
+int test_hot_path(void*);
+int test_leak(void*);
+int test_realloc(void*);
+int test_zeta(void*);
+
+struct reedkiln_entry tests[] = {
+  { "count", test_count },
+  { "realloc", test_realloc },
+  { "leak", test_leak },
+  { "budget", test_budget },
+  { "budget/over", test_budget_over, Reedkiln_TODO },
+  { "hot_path", test_hot_path },
+  { "zeta", test_zeta },
+  { NULL, NULL }
+};
+
+static void* leaked = NULL;
+
+/* test counts of allocations and bytes */
+int test_count(void* p) {
+  struct reedkiln_allocs counts;
+  void* a = malloc(10);
+  void* b = malloc(20);
+  void* c = calloc(3, 10);
+  reedkiln_assert(a != NULL && b != NULL && c != NULL);
+  free(b);
+  if (reedkiln_alloc_count(&counts) != 0) {
+    free(a);
+    free(c);
+    return Reedkiln_IGNORE;
+  }
+  reedkiln_assert(counts.allocs == 3u && counts.bytes == 60u);
+  reedkiln_assert(counts.live_bytes == 40u && counts.peak_bytes == 60u);
+  free(a);
+  free(c);
+  reedkiln_assert(reedkiln_alloc_count(&counts) == 0);
+  reedkiln_assert(counts.live_bytes == 0u);
+  return Reedkiln_OK;
+}
+
+/* test that realloc counts as a new allocation */
+int test_realloc(void* p) {
+  struct reedkiln_allocs counts;
+  char* a = (char*)malloc(8);
+  reedkiln_assert(a != NULL);
+  memset(a, 1, 8);
+  a = (char*)realloc(a, 4096);
+  reedkiln_assert(a != NULL && a[7] == 1);
+  if (reedkiln_alloc_count(&counts) != 0) {
+    free(a);
+    return Reedkiln_IGNORE;
+  }
+  reedkiln_assert(counts.allocs == 2u && counts.live_bytes == 4096u);
+  free(a);
+  return Reedkiln_OK;
+}
+
+/* test a block kept past the end of the test */
+int test_leak(void* p) {
+  leaked = malloc(16);
+  reedkiln_assert(leaked != NULL);
+  return Reedkiln_OK;
+}
+
+/* test a budget that holds */
+int test_budget(void* p) {
+  void* a;
+  if (reedkiln_alloc_budget(1u, 64u) != 0)
+    return Reedkiln_IGNORE;
+  a = malloc(64);
+  reedkiln_assert(a != NULL);
+  free(a);
+  return Reedkiln_OK;
+}
+
+/* test a budget that breaks */
+int test_budget_over(void* p) {
+  void* a;
+  void* b;
+  if (reedkiln_alloc_budget(1u, Reedkiln_AllocAny) != 0)
+    return Reedkiln_NOT_OK;
+  a = malloc(1);
+  b = malloc(1);
+  free(a);
+  free(b);
+  return Reedkiln_OK;
+}
+
+/* test a region that should not allocate */
+int test_hot_path(void* p) {
+  struct reedkiln_allocs before;
+  struct reedkiln_allocs after;
+  char buf[32];
+  void* a = malloc(32);
+  if (reedkiln_alloc_count(&before) != 0) {
+    free(a);
+    return Reedkiln_IGNORE;
+  }
+  memset(buf, 0, sizeof(buf));
+  reedkiln_assert(a != NULL);
+  memcpy(a, buf, sizeof(buf));
+  reedkiln_assert(reedkiln_alloc_count(&after) == 0);
+  reedkiln_assert(after.allocs == before.allocs);
+  free(a);
+  return Reedkiln_OK;
+}
+
+/* last test to run */
+int test_zeta(void* p) {
+  struct reedkiln_allocs counts;
+  /* freeing another test's block does not count here */
+  free(leaked);
+  leaked = NULL;
+  if (reedkiln_alloc_count(&counts) == 0)
+    reedkiln_assert(counts.live_bytes == 0u);
+  return Reedkiln_OK;
+}
+
+int main(int argc, char **argv) {
+  return reedkiln_main(tests, argc, argv, NULL);
+}
@@ -0,0 +1,84 @@
+#include "../reedkiln.h"
+#include "../arena.h"
+
+int test_plain(void*);
+int test_recycle(void*);
+int test_overflow(void*);
+int test_resource(void*);
+int test_zeta(void*);
+
+#if (defined Reedkiln_UseArena)
+#include <vector>
+
+struct pmr_fixture {
+  std::pmr::vector<int> values;
+  explicit pmr_fixture(std::pmr::memory_resource* r) : values(r) {}
+};
+typedef reedkiln::arena_box<pmr_fixture, 4096u> fixture_box;
+typedef reedkiln::arena_box<int> plain_box;
+
+struct reedkiln_entry tests[] = {
+  { "resource", test_resource, 0, fixture_box::ptr },
+  { "recycle", test_recycle, 0, fixture_box::ptr },
+  { "overflow", test_overflow, 0, fixture_box::ptr },
+  { "plain", test_plain, 0, plain_box::ptr },
+  { "zeta", test_zeta },
+  { NULL, NULL }
+};
+
+static void* last_item = nullptr;
+
+/* test that the item allocates from its arena */
+int test_resource(void* p) {
+  pmr_fixture& f = *static_cast<pmr_fixture*>(p);
+  reedkiln_assert(f.values.get_allocator().resource()
+    == fixture_box::resource(p));
+  f.values.assign(100u, 7);
+  last_item = p;
+  return Reedkiln_OK;
+}
+
+/* test that the next test gets the same memory back */
+int test_recycle(void* p) {
+  pmr_fixture& f = *static_cast<pmr_fixture*>(p);
+  reedkiln_assert(f.values.empty());
+  reedkiln_assert(last_item == nullptr || last_item == p);
+  return Reedkiln_OK;
+}
+
+/* test growth past the arena */
+int test_overflow(void* p) {
+  pmr_fixture& f = *static_cast<pmr_fixture*>(p);
+  int i;
+  for (i = 0; i < 10000; ++i)
+    f.values.push_back(i);
+  reedkiln_assert(f.values.size() == 10000u && f.values[9999] == 9999);
+  return Reedkiln_OK;
+}
+
+/* test a type without an allocator */
+int test_plain(void* p) {
+  reedkiln_assert(*static_cast<int*>(p) == 0);
+  return Reedkiln_OK;
+}
+#else
+struct reedkiln_entry tests[] = {
+  { "resource", test_resource },
+  { "zeta", test_zeta },
+  { NULL, NULL }
+};
+
+/* placeholder without std::pmr */
+int test_resource(void* p) {
+  return Reedkiln_IGNORE;
+}
+#endif /*Reedkiln_UseArena*/
+
+/* last test to run */
+int test_zeta(void* p) {
+  return Reedkiln_OK;
+}
+
+int main(int argc, char **argv) {
+  return reedkiln::cxx_main(tests, argc, argv, nullptr);
+}
@@ -5,6 +5,8 @@
 #include <stdlib.h>
 
 
+int test_alpha(void*);
+int test_beta(void*);
 int test_setup_fail(void*);
 int test_zeta(void*);
 
@@ -14,12 +16,22 @@ void teardown_bad(void*);
 struct reedkiln_box const box_bad = { setup_bad, teardown_bad };
 
 struct reedkiln_entry tests[] = {
+  { "alpha", test_alpha },
+  { "beta", test_beta },
   { "setup_fail", test_setup_fail, Reedkiln_TODO, &box_bad },
   { "zeta", test_zeta },
   { NULL, NULL }
 };
 
 
+/* tests that a shuffled run may leave until after the bail out */
+int test_alpha(void* p) {
+  return Reedkiln_OK;
+}
+int test_beta(void* p) {
+  return Reedkiln_OK;
+}
+
 /* test failed setup and bail out support */
 void* setup_bad(void* p) {
   unsigned int* num = NULL;
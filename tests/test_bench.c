@@ -0,0 +1,86 @@
+/* SPDX-License-Identifier: Unlicense */
+#include "../reedkiln.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+
+int test_bench_count(void*);
+int test_bench_memrand(void*);
+int test_bench_pause(void*);
+int test_bench_sum(void*);
+int test_zeta(void*);
+
+void* setup_buffer(void*);
+void teardown_buffer(void*);
+
+struct reedkiln_box const box_buffer = { setup_buffer, teardown_buffer };
+
+struct reedkiln_entry tests[] = {
+  { "bench_count", test_bench_count },
+  { "bench/memrand", test_bench_memrand, Reedkiln_BENCH, &box_buffer },
+  { "bench/pause", test_bench_pause, Reedkiln_BENCH, &box_buffer },
+  { "bench/sum", test_bench_sum, Reedkiln_BENCH, &box_buffer },
+  { "zeta", test_zeta },
+  { NULL, NULL }
+};
+
+
+/* test setup and teardown */
+void* setup_buffer(void* p) {
+  return calloc(64, 1);
+}
+void teardown_buffer(void* box) {
+  free(box);
+  return;
+}
+
+/* test the iteration count outside of a benchmark */
+int test_bench_count(void* p) {
+  reedkiln_assert(reedkiln_bench_count() == 1);
+  return Reedkiln_OK;
+}
+
+/* benchmark random buffer generation */
+int test_bench_memrand(void* box) {
+  reedkiln_size i;
+  reedkiln_size const n = reedkiln_bench_count();
+  for (i = 0; i < n; ++i)
+    reedkiln_memrand(box, 64);
+  return Reedkiln_OK;
+}
+
+/* benchmark with untimed per-iteration setup */
+int test_bench_pause(void* box) {
+  unsigned char* const buf = (unsigned char*)box;
+  reedkiln_size i;
+  reedkiln_size const n = reedkiln_bench_count();
+  unsigned int total = 0;
+  for (i = 0; i < n; ++i) {
+    reedkiln_bench_pause();
+    reedkiln_memrand(buf, 64);
+    reedkiln_bench_resume();
+    total += buf[i%64];
+  }
+  return total == 0 && n > 256 ? Reedkiln_NOT_OK : Reedkiln_OK;
+}
+
+/* benchmark a simple summation */
+int test_bench_sum(void* box) {
+  unsigned char volatile* const buf = (unsigned char volatile*)box;
+  reedkiln_size i;
+  reedkiln_size const n = reedkiln_bench_count();
+  for (i = 0; i < n; ++i)
+    buf[0] = (unsigned char)(buf[0] + buf[(i+1)%64]);
+  return Reedkiln_OK;
+}
+
+/* last test to run */
+int test_zeta(void* p) {
+  return Reedkiln_OK;
+}
+
+
+int main(int argc, char **argv) {
+  return reedkiln_main(tests, argc, argv, NULL);
+}
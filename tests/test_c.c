@@ -7,6 +7,7 @@
 
 int test_ignore(void*);
 int test_memrand(void*);
+int test_memrand_large(void*);
 int test_rand(void*);
 int test_setup(void*);
 int test_skip(void*);
@@ -21,6 +22,7 @@ struct reedkiln_box const box_one = { setup_one, teardown_one };
 
 struct reedkiln_entry tests[] = {
   { "memrand", test_memrand },
+  { "memrand/large", test_memrand_large },
   { "rand", test_rand },
   { "setup", test_setup, Reedkiln_TODO, &box_one },
   { "skip", test_skip, Reedkiln_SKIP },
@@ -47,6 +49,26 @@ int test_memrand(void* p) {
     reedkiln_fail();
   return Reedkiln_OK;
 }
+/* test a fill big enough to split across threads */
+int test_memrand_large(void* p) {
+  size_t const sz = ((size_t)24<<20) + 3u;
+  size_t counts[256] = {0};
+  size_t i;
+  unsigned char* const v = (unsigned char*)malloc(sz);
+  if (v == NULL)
+    return Reedkiln_IGNORE;
+  memset(v, 0, sz);
+  reedkiln_memrand(v, sz);
+  for (i = 0u; i < sz; ++i)
+    counts[v[i]] += 1u;
+  free(v);
+  /* each byte value should come up near sz/256 times */
+  for (i = 0u; i < 256u; ++i) {
+    if (counts[i] < sz/256u - sz/2560u || counts[i] > sz/256u + sz/2560u)
+      reedkiln_fail();
+  }
+  return Reedkiln_OK;
+}
 /* test resilience of random number generator */
 int test_rand(void* p) {
   unsigned int v = reedkiln_rand();
@@ -5,6 +5,7 @@
 #include <iostream>
 #include <iomanip>
 #include <cstring>
+#include <stdexcept>
 
 class free_box {
 private:
@@ -42,6 +43,20 @@ public:
     return *this;
   }
 };
+struct pooled_text {
+  std::string text;
+  int uses;
+  pooled_text() : uses(0) {}
+  void reset() {
+    text.clear();
+  }
+};
+struct stuck_text {
+  std::string text;
+  void reset() {
+    throw std::runtime_error("cannot reset");
+  }
+};
 class seven_checker {
 private:
   int x;
@@ -59,6 +74,9 @@ int test_cxx_wlog(void*);
 int test_cxx_log_numbers(void*);
 int test_cxx_setup(void*);
 int test_cxx_setupfail(void*);
+int test_cxx_pool(void*);
+int test_cxx_pool_reuse(void*);
+int test_cxx_pool_stuck(void*);
 int test_memrand(void*);
 int test_rand(void*);
 int test_skip(void*);
@@ -78,6 +96,14 @@ struct reedkiln_entry tests[] = {
     reedkiln::cxx_box<std::string>::ptr },
   { "cxx/setupfail", test_cxx_setupfail, Reedkiln_TODO,
     reedkiln::cxx_box<std::string>::ptr },
+  { "cxx/pool", test_cxx_pool, 0,
+    reedkiln::cxx_pool_box<pooled_text>::ptr },
+  { "cxx/pool/reuse", test_cxx_pool_reuse, 0,
+    reedkiln::cxx_pool_box<pooled_text>::ptr },
+  { "cxx/pool/stuck", test_cxx_pool_stuck, 0,
+    reedkiln::cxx_pool_box<stuck_text>::ptr },
+  { "cxx/pool/stuck/reset", test_cxx_pool_stuck, Reedkiln_TODO,
+    reedkiln::cxx_pool_box<stuck_text>::ptr },
   { "memrand", test_memrand },
   { "rand", test_rand },
   { "skip", test_skip, Reedkiln_SKIP },
@@ -143,6 +169,28 @@ int test_cxx_setupfail(void* p) {
   reedkiln_fail();
   return Reedkiln_OK;
 }
+/* test first use of a pooled box */
+int test_cxx_pool(void* p) {
+  pooled_text &box = *static_cast<pooled_text*>(p);
+  reedkiln_assert(box.text.empty());
+  box.text = "hello";
+  box.uses += 1;
+  return Reedkiln_OK;
+}
+/* test reuse of a pooled box after reset */
+int test_cxx_pool_reuse(void* p) {
+  pooled_text &box = *static_cast<pooled_text*>(p);
+  reedkiln_assert(box.text.empty());
+  reedkiln_assert(box.uses == 1);
+  return Reedkiln_OK;
+}
+/* test that a throwing reset fails the next test instead of escaping */
+int test_cxx_pool_stuck(void* p) {
+  stuck_text &box = *static_cast<stuck_text*>(p);
+  reedkiln_assert(box.text.empty());
+  box.text = "stuck";
+  return Reedkiln_OK;
+}
 
 /* test resilience of random number generator */
 int test_memrand(void* p) {
@@ -0,0 +1,152 @@
+/* SPDX-License-Identifier: Unlicense */
+#include "../reedkiln.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#if (defined __STDC_VERSION__) && (__STDC_VERSION__ >= 201112L) \
+  && !(defined __STDC_NO_ATOMICS__)
+#  include <stdatomic.h>
+typedef atomic_int fixture_count;
+#  define fixture_count_add(c, n) atomic_fetch_add(&(c), (n))
+#  define fixture_count_get(c) atomic_load(&(c))
+#else
+typedef int fixture_count;
+#  define fixture_count_add(c, n) ((c) += (n))
+#  define fixture_count_get(c) (c)
+#endif /*__STDC_VERSION__*/
+
+
+struct fixture {
+  int value;
+  /** @brief Tests that used this item so far. */
+  int uses;
+  /** @brief Resets of this item so far. */
+  int resets;
+};
+
+int test_again(void*);
+int test_fail(void*);
+int test_first(void*);
+int test_other(void*);
+int test_reuse(void*);
+int test_zeta(void*);
+
+void* setup_fixture(void*);
+int reset_fixture(void*);
+void teardown_fixture(void*);
+static void use_fixture(struct fixture* f, int value);
+
+struct reedkiln_box const box_pool =
+  { setup_fixture, teardown_fixture, 0u, reset_fixture };
+struct reedkiln_box const box_plain = { setup_fixture, teardown_fixture };
+
+struct reedkiln_entry tests[] = {
+  { "pool/first", test_first, 0, &box_pool },
+  { "pool/reuse", test_reuse, 0, &box_pool },
+  { "pool/fail", test_fail, Reedkiln_TODO, &box_pool },
+  { "pool/skip", test_zeta, Reedkiln_SKIP, &box_plain },
+  { "pool/after_fail", test_reuse, 0, &box_pool },
+  { "other", test_other, 0, &box_plain },
+  { "pool/again", test_again, 0, &box_pool },
+  { "zeta", test_zeta },
+  { NULL, NULL }
+};
+
+/* totals across the run, checked once all items are torn down */
+static fixture_count setups = 0;
+static fixture_count teardowns = 0;
+static fixture_count uses = 0;
+
+void* setup_fixture(void* p) {
+  struct fixture* const f = (struct fixture*)malloc(sizeof(struct fixture));
+  reedkiln_assert(f != NULL);
+  f->value = 0;
+  f->uses = 0;
+  f->resets = 0;
+  fixture_count_add(setups, 1);
+  return f;
+}
+
+int reset_fixture(void* p) {
+  struct fixture* const f = (struct fixture*)p;
+  f->value = 0;
+  f->resets += 1;
+  return Reedkiln_OK;
+}
+
+void teardown_fixture(void* p) {
+  struct fixture* const f = (struct fixture*)p;
+  clock_t const start = clock();
+  fixture_count_add(uses, f->uses);
+  fixture_count_add(teardowns, 1);
+  free(f);
+  /* slow enough to show in the teardown time of the last user */
+  while (clock() - start < CLOCKS_PER_SEC/400)
+    continue;
+}
+
+/* check that an item comes fresh or reset, then use it */
+static
+void use_fixture(struct fixture* f, int value) {
+  reedkiln_assert(f->value == 0);
+  reedkiln_assert(f->resets == f->uses);
+  f->uses += 1;
+  f->value = value;
+}
+
+/* test the first use of a pooled box */
+int test_first(void* p) {
+  use_fixture((struct fixture*)p, 5);
+  return Reedkiln_OK;
+}
+
+/* test that the next entry gets the same item, reset */
+int test_reuse(void* p) {
+  use_fixture((struct fixture*)p, 7);
+  return Reedkiln_OK;
+}
+
+/* test that a failed test keeps the item for reset */
+int test_fail(void* p) {
+  use_fixture((struct fixture*)p, 9);
+  reedkiln_fail();
+  return Reedkiln_OK;
+}
+
+/* test that a box without a reset gets a new item */
+int test_other(void* p) {
+  struct fixture* const f = (struct fixture*)p;
+  reedkiln_assert(f->uses == 0 && f->resets == 0);
+  use_fixture(f, 3);
+  return Reedkiln_OK;
+}
+
+/* test that the pooled box starts over after another box */
+int test_again(void* p) {
+  use_fixture((struct fixture*)p, 11);
+  return Reedkiln_OK;
+}
+
+/* last test to run */
+int test_zeta(void* p) {
+  return Reedkiln_OK;
+}
+
+int main(int argc, char **argv) {
+  int const res = reedkiln_main(tests, argc, argv, NULL);
+  int const count = fixture_count_get(setups);
+  if (res != EXIT_SUCCESS)
+    return res;
+  else if (count != fixture_count_get(teardowns)) {
+    fprintf(stderr, "%d items set up, but %d torn down\n",
+      count, (int)fixture_count_get(teardowns));
+    return EXIT_FAILURE;
+  } else if (argc <= 1 && (count != 3 || fixture_count_get(uses) != 6)) {
+    /* in table order, each group of pooled tests shares one item */
+    fprintf(stderr, "%d items set up for %d uses, instead of 3 for 6\n",
+      count, (int)fixture_count_get(uses));
+    return EXIT_FAILURE;
+  }
+  return res;
+}
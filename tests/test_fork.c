@@ -0,0 +1,47 @@
+/* SPDX-License-Identifier: Unlicense */
+#include "../reedkiln.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+
+
+int test_abort(void*);
+int test_signal(void*);
+int test_after(void*);
+int test_zeta(void*);
+
+struct reedkiln_entry tests[] = {
+  { "abort", test_abort, Reedkiln_TODO },
+  { "after", test_after },
+  { "signal", test_signal, Reedkiln_TODO },
+  { "zeta", test_zeta },
+  { NULL, NULL }
+};
+
+
+/* test recovery from a worker abort */
+int test_abort(void* p) {
+  abort();
+  /* [[unreachable]] */return Reedkiln_OK;
+}
+
+/* test that work continues after a crashed worker */
+int test_after(void* p) {
+  return Reedkiln_OK;
+}
+
+/* test recovery from a worker killed by a signal */
+int test_signal(void* p) {
+  raise(SIGSEGV);
+  /* [[unreachable]] */return Reedkiln_OK;
+}
+
+/* last test to run */
+int test_zeta(void* p) {
+  return Reedkiln_OK;
+}
+
+
+int main(int argc, char **argv) {
+  return reedkiln_main(tests, argc, argv, NULL);
+}
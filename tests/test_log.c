@@ -0,0 +1,132 @@
+/* SPDX-License-Identifier: Unlicense */
+#include "../reedkiln.h"
+#include "../log.h"
+#include <string.h>
+#if (defined __STDC_VERSION__) && (__STDC_VERSION__ >= 201112L) \
+    && (!defined __STDC_NO_THREADS__)
+#  include <threads.h>
+#  define Reedkiln_TestThreads
+#endif /*__STDC_NO_THREADS__*/
+
+
+int test_default(void*);
+int test_grow(void*);
+int test_grow_printf(void*);
+int test_spill(void*);
+int test_after(void*);
+int test_threads(void*);
+int test_zeta(void*);
+
+struct reedkiln_entry tests[] = {
+  { "default", test_default },
+  { "grow", test_grow },
+  { "grow/printf", test_grow_printf },
+  { "spill", test_spill },
+  { "after", test_after },
+  { "threads", test_threads },
+  { "zeta", test_zeta },
+  { NULL, NULL }
+};
+
+/* test the default truncation */
+int test_default(void* p) {
+  char str[200];
+  memset(str, '.', sizeof(str));
+  reedkiln_assert(reedkiln_log_write(str, sizeof(str)) == 128u);
+  reedkiln_assert(reedkiln_log_write(str, sizeof(str)) == 0u);
+  return Reedkiln_OK;
+}
+
+/* test writes across several chunks */
+int test_grow(void* p) {
+  char str[100];
+  int i;
+  reedkiln_log_configure(4096u, 0u);
+  for (i = 0; i < 40; ++i) {
+    memset(str, 'a'+(i%26), sizeof(str));
+    reedkiln_assert(reedkiln_log_write(str, sizeof(str)) == sizeof(str));
+  }
+  reedkiln_assert(reedkiln_log_write(str, sizeof(str)) == 96u);
+  return Reedkiln_OK;
+}
+
+/* test formatted writes across chunk boundaries */
+int test_grow_printf(void* p) {
+  int i;
+  reedkiln_log_configure(2048u, 0u);
+  for (i = 0; i < 100; ++i) {
+    reedkiln_assert(reedkiln_log_printf("[%i]", i) == (i < 10 ? 4u : 5u));
+  }
+  return Reedkiln_OK;
+}
+
+/* test storage past the spill threshold */
+int test_spill(void* p) {
+  char str[1000];
+  int i;
+  reedkiln_log_configure(65536u, 1024u);
+  for (i = 0; i < 60; ++i) {
+    memset(str, 'A'+(i%26), sizeof(str));
+    reedkiln_assert(reedkiln_log_write(str, sizeof(str)) == sizeof(str));
+  }
+  return Reedkiln_OK;
+}
+
+/* test that configuration in a test ends with that test */
+int test_after(void* p) {
+  char str[200];
+  memset(str, '-', sizeof(str));
+  reedkiln_assert(reedkiln_log_write(str, sizeof(str)) == 128u);
+  return Reedkiln_OK;
+}
+
+#if (defined Reedkiln_TestThreads)
+struct log_thread_arg {
+  int id;
+  void* handle;
+};
+
+static int log_thread(void* arg) {
+  struct log_thread_arg const* const a = (struct log_thread_arg const*)arg;
+  int const id = a->id;
+  int i;
+  reedkiln_attach(a->handle);
+  for (i = 0; i < 20; ++i) {
+    if (reedkiln_log_printf("<%i:%i>", id, i) != (i < 10 ? 6u : 7u))
+      return 1;
+  }
+  return 0;
+}
+#endif /*Reedkiln_TestThreads*/
+
+/* test writes from several threads */
+int test_threads(void* p) {
+#if (defined Reedkiln_TestThreads)
+  thrd_t th[20];
+  struct log_thread_arg args[20];
+  int res[20];
+  int i;
+  reedkiln_log_configure(8192u, 0u);
+  for (i = 0; i < 20; ++i) {
+    args[i].id = i%10;
+    args[i].handle = reedkiln_current();
+    reedkiln_assert(thrd_create(th+i, log_thread, args+i) == thrd_success);
+  }
+  for (i = 0; i < 20; ++i)
+    thrd_join(th[i], res+i);
+  for (i = 0; i < 20; ++i)
+    reedkiln_assert(res[i] == 0);
+  return Reedkiln_OK;
+#else
+  return Reedkiln_IGNORE;
+#endif /*Reedkiln_TestThreads*/
+}
+
+/* last test to run */
+int test_zeta(void* p) {
+  return Reedkiln_OK;
+}
+
+int main(int argc, char **argv) {
+  return reedkiln_main(tests, argc, argv, NULL);
+}
@@ -0,0 +1,123 @@
+/* SPDX-License-Identifier: Unlicense */
+#include "../reedkiln.h"
+#include "../prop.h"
+#include <string.h>
+
+
+int test_holds(void*);
+int test_discard(void*);
+int test_uint_shrink(void*);
+int test_int_shrink(void*);
+int test_bytes_shrink(void*);
+int test_report(void*);
+int test_zeta(void*);
+
+struct reedkiln_entry tests[] = {
+  { "holds", test_holds },
+  { "discard", test_discard },
+  { "shrink/uint", test_uint_shrink },
+  { "shrink/int", test_int_shrink },
+  { "shrink/bytes", test_bytes_shrink },
+  { "report", test_report, Reedkiln_TODO },
+  { "zeta", test_zeta },
+  { NULL, NULL }
+};
+
+struct prop_last {
+  long int v;
+  size_t len;
+  unsigned char bytes[64];
+};
+
+static int prop_in_range(struct reedkiln_gen* g, void* p) {
+  long int const v = reedkiln_gen_int(g, -20, 30);
+  return (v >= -20 && v <= 30) ? Reedkiln_OK : Reedkiln_NOT_OK;
+}
+
+static int prop_odd_only(struct reedkiln_gen* g, void* p) {
+  unsigned long int const v = reedkiln_gen_uint(g, 1000u);
+  if (v%2u == 0u)
+    return Reedkiln_IGNORE;
+  reedkiln_assert(v%2u == 1u);
+  return Reedkiln_OK;
+}
+
+static int prop_small_uint(struct reedkiln_gen* g, void* p) {
+  struct prop_last* const last = (struct prop_last*)p;
+  last->v = (long int)reedkiln_gen_uint(g, 1000000u);
+  return last->v < 1000 ? Reedkiln_OK : Reedkiln_NOT_OK;
+}
+
+static int prop_above_int(struct reedkiln_gen* g, void* p) {
+  struct prop_last* const last = (struct prop_last*)p;
+  last->v = reedkiln_gen_int(g, -1000, 1000);
+  return last->v >= -50 ? Reedkiln_OK : Reedkiln_NOT_OK;
+}
+
+static int prop_ascii(struct reedkiln_gen* g, void* p) {
+  struct prop_last* const last = (struct prop_last*)p;
+  size_t i;
+  last->len = reedkiln_gen_bytes(g, last->bytes, sizeof(last->bytes));
+  for (i = 0u; i < last->len; ++i)
+    reedkiln_assert(last->bytes[i] < 0x80u);
+  return Reedkiln_OK;
+}
+
+static int prop_sum(struct reedkiln_gen* g, void* p) {
+  unsigned long int const a = reedkiln_gen_uint(g, 100u);
+  unsigned long int const b = reedkiln_gen_uint(g, 100u);
+  reedkiln_assert(a+b < 150u);
+  return Reedkiln_OK;
+}
+
+/* test a property that always holds */
+int test_holds(void* p) {
+  return reedkiln_prop_check(prop_in_range, NULL, 0u);
+}
+
+/* test that discarded inputs do not fail */
+int test_discard(void* p) {
+  return reedkiln_prop_check(prop_odd_only, NULL, 200u);
+}
+
+/* test shrinking an unsigned integer to the boundary */
+int test_uint_shrink(void* p) {
+  struct prop_last last = {0};
+  reedkiln_assert(reedkiln_prop_check(prop_small_uint, &last, 0u)
+    == Reedkiln_NOT_OK);
+  reedkiln_assert(last.v == 1000);
+  return Reedkiln_OK;
+}
+
+/* test shrinking a signed integer toward zero */
+int test_int_shrink(void* p) {
+  struct prop_last last = {0};
+  reedkiln_assert(reedkiln_prop_check(prop_above_int, &last, 0u)
+    == Reedkiln_NOT_OK);
+  reedkiln_assert(last.v == -51);
+  return Reedkiln_OK;
+}
+
+/* test shrinking a byte string */
+int test_bytes_shrink(void* p) {
+  struct prop_last last = {0};
+  reedkiln_assert(reedkiln_prop_check(prop_ascii, &last, 0u)
+    == Reedkiln_NOT_OK);
+  reedkiln_assert(last.len == 1u);
+  reedkiln_assert(last.bytes[0] == 0x80u);
+  return Reedkiln_OK;
+}
+
+/* test the report of a counterexample */
+int test_report(void* p) {
+  return reedkiln_prop_check(prop_sum, NULL, 0u);
+}
+
+/* last test to run */
+int test_zeta(void* p) {
+  return Reedkiln_OK;
+}
+
+int main(int argc, char **argv) {
+  return reedkiln_main(tests, argc, argv, NULL);
+}
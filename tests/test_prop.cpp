@@ -0,0 +1,68 @@
+#include "../reedkiln.h"
+#include "../prop.h"
+#include <algorithm>
+#include <string>
+#include <vector>
+
+bool reverse_twice(std::vector<int> const& v);
+bool sorted_is_sorted(std::vector<unsigned char> v);
+bool no_letter_z(std::string const& s);
+bool sum_in_range(int a, short b);
+int test_no_z(void*);
+int test_zeta(void*);
+
+struct reedkiln_entry tests[] = {
+  { "reverse", reedkiln::property<std::vector<int> const&>
+      ::check<reverse_twice> },
+  { "sorted", reedkiln::property<std::vector<unsigned char> >
+      ::check<sorted_is_sorted, 200u> },
+  { "no_z", test_no_z },
+  { "sum", reedkiln::property<int, short>::check<sum_in_range>,
+      Reedkiln_TODO },
+  { "zeta", test_zeta },
+  { NULL, NULL }
+};
+
+/* reversing twice gives back the same vector */
+bool reverse_twice(std::vector<int> const& v) {
+  std::vector<int> w(v.rbegin(), v.rend());
+  std::reverse(w.begin(), w.end());
+  return v == w;
+}
+
+/* sorting gives a sorted vector */
+bool sorted_is_sorted(std::vector<unsigned char> v) {
+  std::sort(v.begin(), v.end());
+  return std::is_sorted(v.begin(), v.end());
+}
+
+static std::string last_string;
+
+/* strings seldom hold a 'z' */
+bool no_letter_z(std::string const& s) {
+  last_string = s;
+  return s.find('z') == std::string::npos;
+}
+
+/* test shrinking a string to the one byte that matters */
+int test_no_z(void* p) {
+  int const res = reedkiln::property<std::string const&>
+    ::check<no_letter_z, 5000u>(p);
+  reedkiln_assert(res == Reedkiln_NOT_OK);
+  reedkiln_assert(last_string == "z");
+  return Reedkiln_OK;
+}
+
+/* sums stay small, which fails with a shrunk pair */
+bool sum_in_range(int a, short b) {
+  return static_cast<long int>(a) + b < 100000L;
+}
+
+/* last test to run */
+int test_zeta(void* p) {
+  return Reedkiln_OK;
+}
+
+int main(int argc, char **argv) {
+  return reedkiln::cxx_main(tests, argc, argv, 0);
+}
@@ -0,0 +1,136 @@
+/* SPDX-License-Identifier: Unlicense */
+#include "../reedkiln.h"
+#include <string.h>
+#if (defined __STDC_VERSION__) && (__STDC_VERSION__ >= 201112L) \
+    && (!defined __STDC_NO_THREADS__)
+#  include <threads.h>
+#  define Reedkiln_TestThreads
+#endif /*__STDC_NO_THREADS__*/
+
+
+int test_stream(void*);
+int test_threads(void*);
+int test_threads_auto(void*);
+int test_threads_stray(void*);
+int test_zeta(void*);
+
+struct reedkiln_entry tests[] = {
+  { "stream", test_stream },
+  { "threads", test_threads },
+  { "threads/auto", test_threads_auto },
+  { "threads/stray", test_threads_stray },
+  { "zeta", test_zeta },
+  { NULL, NULL }
+};
+
+enum rand_test_const {
+  RandDraws = 1000,
+  RandThreads = 4
+};
+
+/* test that a stream can be replayed */
+int test_stream(void* p) {
+  unsigned int v[RandDraws];
+  int i;
+  for (i = 0; i < RandDraws; ++i)
+    v[i] = reedkiln_rand();
+  reedkiln_rand_stream(0u);
+  for (i = 0; i < RandDraws; ++i)
+    reedkiln_assert(reedkiln_rand() == v[i]);
+  reedkiln_rand_stream(1u);
+  reedkiln_assert(reedkiln_rand() != v[0]);
+  return Reedkiln_OK;
+}
+
+#if (defined Reedkiln_TestThreads)
+struct rand_thread_arg {
+  unsigned int stream;
+  void* handle;
+  unsigned int v[RandDraws];
+};
+
+static int rand_thread(void* arg) {
+  struct rand_thread_arg* const a = (struct rand_thread_arg*)arg;
+  int i;
+  reedkiln_attach(a->handle);
+  if (a->stream > 0u)
+    reedkiln_rand_stream(a->stream);
+  for (i = 0; i < RandDraws; ++i)
+    a->v[i] = reedkiln_rand();
+  return 0;
+}
+
+static void rand_run_threads(struct rand_thread_arg* args, int pick_tf) {
+  thrd_t th[RandThreads];
+  int i;
+  for (i = 0; i < RandThreads; ++i) {
+    args[i].stream = pick_tf ? (unsigned int)(i+1) : 0u;
+    args[i].handle = reedkiln_current();
+    reedkiln_assert(thrd_create(th+i, rand_thread, args+i) == thrd_success);
+  }
+  for (i = 0; i < RandThreads; ++i)
+    thrd_join(th[i], NULL);
+  return;
+}
+#endif /*Reedkiln_TestThreads*/
+
+/* test per-thread streams picked by number */
+int test_threads(void* p) {
+#if (defined Reedkiln_TestThreads)
+  static struct rand_thread_arg args[RandThreads];
+  int i, j;
+  rand_run_threads(args, 1);
+  /* each thread's stream does not depend on the others */
+  for (i = 0; i < RandThreads; ++i) {
+    reedkiln_rand_stream((unsigned int)(i+1));
+    for (j = 0; j < RandDraws; ++j)
+      reedkiln_assert(reedkiln_rand() == args[i].v[j]);
+  }
+  return Reedkiln_OK;
+#else
+  return Reedkiln_IGNORE;
+#endif /*Reedkiln_TestThreads*/
+}
+
+/* test per-thread streams handed out on first draw */
+int test_threads_auto(void* p) {
+#if (defined Reedkiln_TestThreads)
+  static struct rand_thread_arg args[RandThreads];
+  unsigned int const first = reedkiln_rand();
+  int i, j;
+  rand_run_threads(args, 0);
+  for (i = 0; i < RandThreads; ++i) {
+    reedkiln_assert(args[i].v[0] != first);
+    for (j = i+1; j < RandThreads; ++j)
+      reedkiln_assert(memcmp(args[i].v, args[j].v, sizeof(args[i].v)) != 0);
+  }
+  return Reedkiln_OK;
+#else
+  return Reedkiln_IGNORE;
+#endif /*Reedkiln_TestThreads*/
+}
+
+/* test a thread that draws without attaching first */
+int test_threads_stray(void* p) {
+#if (defined Reedkiln_TestThreads)
+  static struct rand_thread_arg arg;
+  thrd_t th;
+  /* a serial run lends it the main worker; -j stops the run instead */
+  arg.stream = 0u;
+  arg.handle = NULL;
+  reedkiln_assert(thrd_create(&th, rand_thread, &arg) == thrd_success);
+  thrd_join(th, NULL);
+  return Reedkiln_OK;
+#else
+  return Reedkiln_IGNORE;
+#endif /*Reedkiln_TestThreads*/
+}
+
+/* last test to run */
+int test_zeta(void* p) {
+  return Reedkiln_OK;
+}
+
+int main(int argc, char **argv) {
+  return reedkiln_main(tests, argc, argv, NULL);
+}
@@ -0,0 +1,31 @@
+/* SPDX-License-Identifier: Unlicense */
+#include "../reedkiln.h"
+#include <stdlib.h>
+
+
+int test_flaky(void*);
+int test_steady(void*);
+
+struct reedkiln_entry tests[] = {
+  { "flaky", test_flaky },
+  { "steady", test_steady },
+  { NULL, NULL }
+};
+
+
+/* test that fails for about one seed in four */
+int test_flaky(void* p) {
+  if ((reedkiln_rand() & 3u) == 0u)
+    reedkiln_fail();
+  return Reedkiln_OK;
+}
+
+/* test that never fails */
+int test_steady(void* p) {
+  return Reedkiln_OK;
+}
+
+
+int main(int argc, char **argv) {
+  return reedkiln_main(tests, argc, argv, NULL);
+}
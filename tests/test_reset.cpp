@@ -67,9 +67,10 @@ int main(int argc, char **argv) {
     std::cout << "ok 2 - out_range\n"
     << "  ---\n"
     << "  message: \"Exception passed through successfully.\"\n"
-    << "  ...\n"
-    << "ok 3 - zeta" << (want_zeta ? "" : " # SKIP by request")
-    << std::endl;
+    << "  ...\n";
+    if (want_zeta)
+      std::cout << "ok 3 - zeta\n";
+    std::cout << std::flush;
     return EXIT_SUCCESS;
   }
 }
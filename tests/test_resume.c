@@ -0,0 +1,93 @@
+/* SPDX-License-Identifier: Unlicense */
+#include "../reedkiln.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+int test_first(void*);
+int test_second(void*);
+int test_todo(void*);
+int test_zeta(void*);
+
+struct reedkiln_entry tests[] = {
+  { "first", test_first },
+  { "todo", test_todo, Reedkiln_TODO },
+  { "second", test_second },
+  { "zeta", test_zeta },
+  { NULL, NULL }
+};
+
+static int bail_tf = 1;
+static int first_runs = 0;
+static int second_runs = 0;
+
+/* count the runs of a test before the bail out */
+int test_first(void* p) {
+  first_runs += 1;
+  return Reedkiln_OK;
+}
+
+/* fail, for the journal to keep */
+int test_todo(void* p) {
+  return Reedkiln_NOT_OK;
+}
+
+/* bail out the first time through */
+int test_second(void* p) {
+  second_runs += 1;
+  if (bail_tf)
+    reedkiln_bail_out("stopping to resume later");
+  return Reedkiln_OK;
+}
+
+/* last test to run */
+int test_zeta(void* p) {
+  return Reedkiln_OK;
+}
+
+int main(int argc, char **argv) {
+  static char const journal_path[] = "reedkiln_test_resume.journal";
+  char* args[6];
+  int res;
+  remove(journal_path);
+  args[0] = (argc > 0) ? argv[0] : "reedkiln_test_resume";
+  args[1] = "--resume";
+  args[2] = (char*)journal_path;
+  args[3] = "-o";
+  args[4] = "reedkiln_test_resume.tap";
+  args[5] = NULL;
+  /* stop partway through */{
+    res = reedkiln_main(tests, 5, args, NULL);
+    if (res != EXIT_FAILURE || first_runs != 1 || second_runs != 1) {
+      fputs("first run did not bail out as expected\n", stderr);
+      return EXIT_FAILURE;
+    }
+  }
+  /* tear the end of the journal */{
+    FILE* const f = fopen(journal_path, "ab");
+    if (f == NULL) {
+      fputs("journal missing after the bail out\n", stderr);
+      return EXIT_FAILURE;
+    }
+    fputs("\x40\0\0\0torn", f);
+    fclose(f);
+  }
+  bail_tf = 0;
+  /* resume at the test that bailed out */{
+    res = reedkiln_main(tests, 3, args, NULL);
+    if (res != EXIT_SUCCESS || first_runs != 1 || second_runs != 2) {
+      fputs("second run did not resume as expected\n", stderr);
+      return EXIT_FAILURE;
+    }
+  }
+  /* the journal goes away once every test has a result */{
+    FILE* const f = fopen(journal_path, "rb");
+    if (f != NULL) {
+      fclose(f);
+      fputs("journal kept after the last test\n", stderr);
+      return EXIT_FAILURE;
+    }
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,153 @@
+/* SPDX-License-Identifier: Unlicense */
+#include "../reedkiln.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+int test_alpha(void*);
+int test_beta(void*);
+int test_gamma(void*);
+int test_delta(void*);
+int test_epsilon(void*);
+int test_zeta(void*);
+static int note_run(int id);
+static int run_shuffled(char const* seed, int out[6]);
+static int check_tap(char const* path);
+
+struct reedkiln_entry tests[] = {
+  { "alpha", test_alpha },
+  { "beta", test_beta },
+  { "gamma", test_gamma },
+  { "delta", test_delta },
+  { "epsilon", test_epsilon },
+  { "zeta", test_zeta },
+  { NULL, NULL }
+};
+
+static char const* program_name = "reedkiln_test_shuffle";
+static int order[6];
+static int order_len = 0;
+
+/* note the order in which the tests run */
+static
+int note_run(int id) {
+  if (order_len < 6)
+    order[order_len] = id;
+  order_len += 1;
+  return Reedkiln_OK;
+}
+
+int test_alpha(void* p) {
+  return note_run(0);
+}
+
+int test_beta(void* p) {
+  return note_run(1);
+}
+
+int test_gamma(void* p) {
+  return note_run(2);
+}
+
+int test_delta(void* p) {
+  return note_run(3);
+}
+
+int test_epsilon(void* p) {
+  return note_run(4);
+}
+
+/* last test in the table, but not always the last to run */
+int test_zeta(void* p) {
+  return note_run(5);
+}
+
+/* run every test once in shuffled order */
+static
+int run_shuffled(char const* seed, int out[6]) {
+  char* args[7];
+  int seen = 0;
+  int i;
+  args[0] = (char*)program_name;
+  args[1] = "--shuffle";
+  args[2] = "-s";
+  args[3] = (char*)seed;
+  args[4] = "-o";
+  args[5] = "reedkiln_test_shuffle.tap";
+  args[6] = NULL;
+  order_len = 0;
+  if (reedkiln_main(tests, 6, args, NULL) != EXIT_SUCCESS || order_len != 6)
+    return -1;
+  for (i = 0; i < 6; ++i) {
+    seen |= (1 << order[i]);
+    out[i] = order[i];
+  }
+  return (seen == 0x3f) ? 0 : -1;
+}
+
+/* results keep their table numbers, in table order */
+static
+int check_tap(char const* path) {
+  char line[256];
+  int next = 1;
+  FILE* const f = fopen(path, "rb");
+  if (f == NULL)
+    return -1;
+  while (fgets(line, sizeof(line), f) != NULL) {
+    if (strncmp(line, "ok ", 3) == 0) {
+      if (atoi(line+3) != next)
+        break;
+      next += 1;
+    }
+  }
+  fclose(f);
+  return (next == 7) ? 0 : -1;
+}
+
+int main(int argc, char **argv) {
+  static char const* const seeds[] = {
+    "1", "2", "3", "4", "5", "6", "7", "8"
+  };
+  int first[6];
+  int again[6];
+  int moved_tf = 0;
+  unsigned int i;
+  if (argc > 0)
+    program_name = argv[0];
+  for (i = 0u; i < sizeof(seeds)/sizeof(seeds[0]); ++i) {
+    int j;
+    if (run_shuffled(seeds[i], first) != 0) {
+      fprintf(stderr, "seed %s did not run each test once\n", seeds[i]);
+      return EXIT_FAILURE;
+    } else if (check_tap("reedkiln_test_shuffle.tap") != 0) {
+      fprintf(stderr, "seed %s printed out of table order\n", seeds[i]);
+      return EXIT_FAILURE;
+    }
+    for (j = 0; j < 6; ++j) {
+      if (first[j] != j)
+        moved_tf = 1;
+    }
+  }
+  if (!moved_tf) {
+    fputs("no seed changed the run order\n", stderr);
+    return EXIT_FAILURE;
+  }
+  /* the same seed gives the same order */{
+    if (run_shuffled("0x2a", first) != 0 || run_shuffled("0x2a", again) != 0
+    ||  memcmp(first, again, sizeof(first)) != 0)
+    {
+      fputs("seed did not reproduce the run order\n", stderr);
+      return EXIT_FAILURE;
+    }
+  }
+  /* a different seed gives a different order */{
+    if (run_shuffled("0x2b", again) != 0
+    ||  memcmp(first, again, sizeof(first)) == 0)
+    {
+      fputs("a new seed kept the run order\n", stderr);
+      return EXIT_FAILURE;
+    }
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,175 @@
+/* SPDX-License-Identifier: Unlicense */
+#include "../reedkiln.h"
+#include "../log.h"
+#include <stdlib.h>
+#include <string.h>
+
+
+enum test_subtest_const {
+  case_count = 64
+};
+
+struct cases {
+  int seen[case_count];
+  unsigned int seeds[case_count];
+};
+
+int test_cases(void*);
+int test_fail(void*);
+int test_nested(void*);
+int test_parallel(void*);
+int test_seed(void*);
+int test_zeta(void*);
+
+int sub_case(void*);
+int sub_fail(void*);
+int sub_ignore(void*);
+int sub_log(void*);
+int sub_nested(void*);
+int sub_pass(void*);
+int sub_seed(void*);
+
+void* setup_cases(void*);
+void teardown_cases(void*);
+
+struct reedkiln_box const box_cases = { setup_cases, teardown_cases };
+
+struct reedkiln_entry tests[] = {
+  { "cases", test_cases, 0, &box_cases },
+  { "fail", test_fail, Reedkiln_TODO },
+  { "nested", test_nested },
+  { "parallel", test_parallel, 0, &box_cases },
+  { "seed", test_seed, 0, &box_cases },
+  { "zeta", test_zeta },
+  { NULL, NULL }
+};
+
+struct reedkiln_entry subs[] = {
+  { "pass", sub_pass },
+  { "log", sub_log },
+  { "ignore", sub_ignore },
+  { "skip", sub_fail, Reedkiln_SKIP },
+  { "todo", sub_fail, Reedkiln_TODO },
+  { NULL, NULL }
+};
+
+void* setup_cases(void* p) {
+  struct cases* const c = (struct cases*)malloc(sizeof(struct cases));
+  reedkiln_assert(c != NULL);
+  memset(c, 0, sizeof(struct cases));
+  return c;
+}
+
+void teardown_cases(void* p) {
+  free(p);
+}
+
+int sub_pass(void* p) {
+  return Reedkiln_OK;
+}
+
+int sub_fail(void* p) {
+  reedkiln_assert(0);
+  return Reedkiln_OK;
+}
+
+int sub_ignore(void* p) {
+  return Reedkiln_IGNORE;
+}
+
+int sub_log(void* p) {
+  reedkiln_log_printf("subtest log");
+  return Reedkiln_OK;
+}
+
+/* mark the next case in the shared item */
+int sub_case(void* p) {
+  struct cases* const c = (struct cases*)p;
+  int i;
+  for (i = 0; i < case_count; ++i) {
+    if (c->seen[i] == 0)
+      break;
+  }
+  reedkiln_assert(i < case_count);
+  c->seen[i] = 1;
+  return Reedkiln_OK;
+}
+
+/* record the first random number of a subtest */
+int sub_seed(void* p) {
+  struct cases* const c = (struct cases*)p;
+  reedkiln_assert(c->seen[0] < case_count);
+  c->seeds[c->seen[0]++] = reedkiln_rand();
+  return Reedkiln_OK;
+}
+
+/* test subtests run one at a time on the parent's item */
+int test_cases(void* p) {
+  struct cases* const c = (struct cases*)p;
+  int i;
+  for (i = 0; i < 10; ++i)
+    reedkiln_assert(reedkiln_subtest("case", sub_case, c) == Reedkiln_OK);
+  for (i = 0; i < case_count; ++i)
+    reedkiln_assert(c->seen[i] == (i < 10));
+  reedkiln_assert(reedkiln_subtests(subs, NULL, 1u) == Reedkiln_OK);
+  return Reedkiln_OK;
+}
+
+/* test that a failed subtest fails the parent but lets it finish */
+int test_fail(void* p) {
+  int after = 0;
+  reedkiln_assert(reedkiln_subtest("fail", sub_fail, NULL)
+    == Reedkiln_NOT_OK);
+  after = 1;
+  reedkiln_assert(reedkiln_subtest("pass", sub_pass, NULL) == Reedkiln_OK);
+  reedkiln_log_printf("after: %i", after);
+  return Reedkiln_OK;
+}
+
+int sub_nested(void* p) {
+  return reedkiln_subtests(subs, p, 1u);
+}
+
+/* test subtests of subtests */
+int test_nested(void* p) {
+  reedkiln_assert(reedkiln_subtest("inner", sub_nested, NULL)
+    == Reedkiln_OK);
+  reedkiln_assert(reedkiln_subtest("after", sub_pass, NULL) == Reedkiln_OK);
+  return Reedkiln_OK;
+}
+
+/* test subtests spread over several threads */
+int test_parallel(void* p) {
+  struct reedkiln_entry list[case_count+1];
+  int i;
+  memset(list, 0, sizeof(list));
+  for (i = 0; i < case_count; ++i) {
+    list[i].name = "case";
+    list[i].cb = sub_pass;
+  }
+  list[case_count/2].cb = sub_log;
+  reedkiln_assert(reedkiln_subtests(list, p, 4u) == Reedkiln_OK);
+  reedkiln_assert(reedkiln_subtests(subs, p, 0u) == Reedkiln_OK);
+  return Reedkiln_OK;
+}
+
+/* test that subtest seeds follow the names */
+int test_seed(void* p) {
+  struct cases* const c = (struct cases*)p;
+  reedkiln_assert(reedkiln_subtest("a", sub_seed, c) == Reedkiln_OK);
+  reedkiln_assert(reedkiln_subtest("b", sub_seed, c) == Reedkiln_OK);
+  reedkiln_assert(reedkiln_subtest("a", sub_seed, c) == Reedkiln_OK);
+  reedkiln_assert(c->seen[0] == 3);
+  reedkiln_assert(c->seeds[0] == c->seeds[2]);
+  reedkiln_assert(c->seeds[0] != c->seeds[1]);
+  return Reedkiln_OK;
+}
+
+/* last test to run */
+int test_zeta(void* p) {
+  return Reedkiln_OK;
+}
+
+int main(int argc, char **argv) {
+  return reedkiln_main(tests, argc, argv, NULL);
+}
@@ -0,0 +1,70 @@
+/* SPDX-License-Identifier: Unlicense */
+#include "../reedkiln.h"
+#include <time.h>
+
+
+int test_check(void*);
+int test_late(void*);
+int test_hang(void*);
+int test_zeta(void*);
+static double wall_ms(void);
+
+struct reedkiln_box const box_short = { NULL, NULL, 50u };
+struct reedkiln_box const box_late = { NULL, NULL, 500u };
+
+struct reedkiln_entry tests[] = {
+  { "coop/check", test_check, Reedkiln_TODO, &box_short },
+  { "coop/late", test_late, Reedkiln_TODO, &box_late },
+  { "hang", test_hang, Reedkiln_TODO, &box_short },
+  { "zeta", test_zeta },
+  { NULL, NULL }
+};
+
+
+/* test failure at a check point after the deadline */
+int test_check(void* p) {
+  for (;;) {
+    (void)reedkiln_rand();
+  }
+  /* [[unreachable]] */return Reedkiln_OK;
+}
+
+/* wall time in milliseconds, as the watchdog measures it */
+static
+double wall_ms(void) {
+#if (defined __STDC_VERSION__) && (__STDC_VERSION__ >= 201112L) \
+  && (defined TIME_UTC)
+  struct timespec ts;
+  if (timespec_get(&ts, TIME_UTC) == TIME_UTC)
+    return ts.tv_sec*1e3 + ts.tv_nsec/1e6;
+#endif /*__STDC_VERSION__*/
+  return clock()*1e3/CLOCKS_PER_SEC;
+}
+
+/* test failure of a test that returns after its deadline */
+int test_late(void* p) {
+  /* halfway between the deadline and the watchdog's bail out */
+  double const start = wall_ms();
+  while (wall_ms() - start < 750.0) {
+    continue;
+  }
+  return Reedkiln_OK;
+}
+
+/* test a test that never reaches a check point */
+int test_hang(void* p) {
+  unsigned int volatile spin = 0u;
+  for (;;) {
+    spin += 1u;
+  }
+  /* [[unreachable]] */return Reedkiln_OK;
+}
+
+/* last test to run */
+int test_zeta(void* p) {
+  return Reedkiln_OK;
+}
+
+int main(int argc, char **argv) {
+  return reedkiln_main(tests, argc, argv, NULL);
+}